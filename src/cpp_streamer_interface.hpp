@@ -7,10 +7,36 @@
 #include <stddef.h>
 #include <string.h>
 #include <map>
+#include <vector>
 
 namespace cpp_streamer
 {
 
+//a view of consecutive packets, the packets are owned by the caller.
+class MediaPacketSpan
+{
+public:
+    MediaPacketSpan(const Media_Packet_Ptr* data, size_t size):data_(data)
+                                                            , size_(size)
+    {
+    }
+    MediaPacketSpan(const std::vector<Media_Packet_Ptr>& pkts):data_(pkts.data())
+                                                            , size_(pkts.size())
+    {
+    }
+
+public:
+    const Media_Packet_Ptr* begin() const { return data_; }
+    const Media_Packet_Ptr* end() const { return data_ + size_; }
+    const Media_Packet_Ptr& operator[](size_t index) const { return data_[index]; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    const Media_Packet_Ptr* data_ = nullptr;
+    size_t size_ = 0;
+};
+
 class StreamerReport
 {
 public:
@@ -39,6 +65,16 @@ public:
     virtual void AddOption(const std::string& key, const std::string& value) = 0;
     virtual void SetReporter(StreamerReport* reporter) = 0;
 
+public:
+    //input several packets in one call, the default adapter loops over SourceData.
+    //return the count of the input packets.
+    virtual int SourceBatch(MediaPacketSpan pkts) {
+        for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+            SourceData(pkt_ptr);
+        }
+        return (int)pkts.size();
+    }
+
 protected:
     Logger* logger_ = nullptr;
     std::string name_;
@@ -40,6 +40,9 @@ FlvDemuxer::FlvDemuxer()
 
 FlvDemuxer::~FlvDemuxer()
 {
+    if (pacing_) {
+        pacing_->Remove(this);
+    }
 }
 
 std::string FlvDemuxer::StreamerName() {
@@ -70,6 +73,28 @@ int FlvDemuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     return InputPacket(pkt_ptr);
 }
 
+int FlvDemuxer::SourceBatch(MediaPacketSpan pkts) {
+    batch_mode_ = true;
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        if (pkt_ptr) {
+            InputPacket(pkt_ptr);
+        }
+    }
+    batch_mode_ = false;
+
+    FlushBatch();
+    return (int)pkts.size();
+}
+
+//the loop is used to pace the output packets for the re option,
+//so the caller thread is not blocked. the pacing is reported to the reporter:
+//"full"(stop the input), "drain"(go on) and "empty"(all the packets are output).
+void FlvDemuxer::StartNetwork(const std::string& url, void* loop_handle) {
+    if (loop_handle) {
+        pacing_ = PacingScheduler::GetScheduler((uv_loop_t*)loop_handle);
+    }
+}
+
 void FlvDemuxer::AddOption(const std::string& key, const std::string& value) {
     auto iter = options_.find(key);
     if (iter == options_.end()) {
@@ -150,7 +175,7 @@ int FlvDemuxer::HandlePacket() {
     int header_len = 0;
 
     output_pkt_ptr->fmt_type_ = MEDIA_FORMAT_RAW;
-    output_pkt_ptr->key_ = key_;
+    output_pkt_ptr->context_ = context_;
     if (tag_type_ == FLV_TAG_AUDIO) {
         header_len = 2;
         output_pkt_ptr->av_type_ = MEDIA_AUDIO_TYPE;
@@ -350,15 +375,15 @@ int FlvDemuxer::DecodeMetaData(uint8_t* data, int data_len, Media_Packet_Ptr pkt
             }
 
             if (item.desc_str_ == "onTextData") {
-                pkt_ptr->metadata_type_ = METADATA_TYPE_ONTEXTDATA;
+                pkt_ptr->Metadata()->metadata_type_ = METADATA_TYPE_ONTEXTDATA;
             } else if (item.desc_str_ == "onCaption") {
-                pkt_ptr->metadata_type_ = METADATA_TYPE_ONCAPTION;
+                pkt_ptr->Metadata()->metadata_type_ = METADATA_TYPE_ONCAPTION;
             } else if (item.desc_str_ == "onCaptionInfo") {
-                pkt_ptr->metadata_type_ = METADATA_TYPE_ONCAPTIONINFO;
+                pkt_ptr->Metadata()->metadata_type_ = METADATA_TYPE_ONCAPTIONINFO;
             } else if (item.desc_str_ == "onMetaData") {
-                pkt_ptr->metadata_type_ = METADATA_TYPE_ONTMETADATA;
+                pkt_ptr->Metadata()->metadata_type_ = METADATA_TYPE_ONTMETADATA;
             } else {
-                pkt_ptr->metadata_type_ = METADATA_TYPE_UNKNOWN;
+                pkt_ptr->Metadata()->metadata_type_ = METADATA_TYPE_UNKNOWN;
                 LogErrorf(logger_, "unknown metadata type:%s", item.desc_str_.c_str());
             }
         } else {
@@ -366,13 +391,13 @@ int FlvDemuxer::DecodeMetaData(uint8_t* data, int data_len, Media_Packet_Ptr pkt
                 for (auto& amf_obj : item.amf_obj_) {
                     std::string key = amf_obj.first;
                     if (amf_obj.second->GetAmfType() == AMF_DATA_TYPE_STRING) {
-                        pkt_ptr->metadata_[key] = amf_obj.second->desc_str_;
+                        pkt_ptr->Metadata()->metadata_[key] = amf_obj.second->desc_str_;
                     } else if (amf_obj.second->GetAmfType() == AMF_DATA_TYPE_NUMBER) {
                         char desc[80];
                         snprintf(desc, sizeof(desc), "%.02f", amf_obj.second->number_);
-                        pkt_ptr->metadata_[key] = std::string(desc);
+                        pkt_ptr->Metadata()->metadata_[key] = std::string(desc);
                     } else if (amf_obj.second->GetAmfType() == AMF_DATA_TYPE_BOOL) {
-                        pkt_ptr->metadata_[key] = amf_obj.second->enable_ ? "true" : "false";
+                        pkt_ptr->Metadata()->metadata_[key] = amf_obj.second->enable_ ? "true" : "false";
                     }
                 }
             }
@@ -385,7 +410,17 @@ int FlvDemuxer::DecodeMetaData(uint8_t* data, int data_len, Media_Packet_Ptr pkt
 
 int FlvDemuxer::SinkData(Media_Packet_Ptr pkt_ptr) {
     if (options_["re"] == "true") {
+        if (pacing_) {
+            if (!pacing_->Push(this, pkt_ptr, waiter_.GetSendMs(pkt_ptr, now_millisec()))) {
+                //the producer should stop the input until "drain"
+                Report("pacing", "full");
+            }
+            return 0;
+        }
         waiter_.Wait(pkt_ptr);
+    } else if (batch_mode_) {
+        batch_pkts_.push_back(pkt_ptr);
+        return 0;
     }
     int ret = 0;
     for (auto& item : sinkers_) {
@@ -394,10 +429,34 @@ int FlvDemuxer::SinkData(Media_Packet_Ptr pkt_ptr) {
     return ret;
 }
 
+void FlvDemuxer::OnPacingOutput(Media_Packet_Ptr pkt_ptr) {
+    for (auto& item : sinkers_) {
+        item.second->SourceData(pkt_ptr);
+    }
+}
+
+void FlvDemuxer::OnPacingDrain() {
+    Report("pacing", "drain");
+}
+
+void FlvDemuxer::OnPacingEmpty() {
+    Report("pacing", "empty");
+}
+
+void FlvDemuxer::FlushBatch() {
+    if (batch_pkts_.empty()) {
+        return;
+    }
+    for (auto& item : sinkers_) {
+        item.second->SourceBatch(batch_pkts_);
+    }
+    batch_pkts_.clear();
+}
+
 int FlvDemuxer::InputPacket(Media_Packet_Ptr pkt_ptr) {
     buffer_.AppendData(pkt_ptr->buffer_ptr_->Data(), pkt_ptr->buffer_ptr_->DataLen());
-    if (key_.empty() && !pkt_ptr->key_.empty()) {
-        key_ = pkt_ptr->key_;
+    if (!context_ && pkt_ptr->context_) {
+        context_ = pkt_ptr->context_;
     }
     int ret = 0;
     do {
@@ -409,7 +468,9 @@ int FlvDemuxer::InputPacket(Media_Packet_Ptr pkt_ptr) {
 
 int FlvDemuxer::InputPacket(const uint8_t* data, size_t data_len, const std::string& key) {
     buffer_.AppendData((char*)data, data_len);
-    key_ = key;
+    if (!context_ || (context_->key_ != key)) {
+        context_ = StreamContext::Intern(key, "", "", "");
+    }
 
     int ret = 0;
     do {
@@ -4,6 +4,7 @@
 #include "cpp_streamer_interface.hpp"
 #include "logger.hpp"
 #include "wait_basedon_timestamp.hpp"
+#include "pacing_scheduler.hpp"
 
 #include <map>
 
@@ -20,7 +21,7 @@ namespace cpp_streamer
 #define FLV_TAG_PRE_SIZE   4
 #define FLV_TAG_HEADER_LEN 11
 
-class FlvDemuxer : CppStreamerInterface
+class FlvDemuxer : CppStreamerInterface, public PacingSinkI
 {
 public:
     FlvDemuxer();
@@ -34,9 +35,15 @@ public:
     virtual int AddSinker(CppStreamerInterface* sinker) override;
     virtual int RemoveSinker(const std::string& name) override;
     virtual int SourceData(Media_Packet_Ptr pkt_ptr) override;
-    virtual void StartNetwork(const std::string& url, void* loop_handle) override {}
+    virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
+
+public:
+    virtual void OnPacingOutput(Media_Packet_Ptr pkt_ptr) override;
+    virtual void OnPacingDrain() override;
+    virtual void OnPacingEmpty() override;
 
 private:
     int InputPacket(Media_Packet_Ptr pkt_ptr);
@@ -45,6 +52,7 @@ private:
     bool HasAudio() {return has_audio_;}
     int HandlePacket();
     int SinkData(Media_Packet_Ptr pkt_ptr);
+    void FlushBatch();
     int DecodeMetaData(uint8_t* data, int len, Media_Packet_Ptr pkt_ptr);
     void Report(const std::string& type, const std::string& value);
 
@@ -53,7 +61,9 @@ private:
 
 private:
     DataBuffer buffer_;
-    std::string key_;
+    StreamContextPtr context_;
+    bool batch_mode_ = false;
+    std::vector<Media_Packet_Ptr> batch_pkts_;
     bool has_video_ = false;
     bool has_audio_ = false;
 
@@ -71,6 +81,7 @@ private:
 
 private:
     WaitBasedOnTimestamp waiter_;
+    PacingScheduler* pacing_ = nullptr;//the re option is paced in the loop if it's set
 };
 
 }
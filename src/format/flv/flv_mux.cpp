@@ -19,6 +19,25 @@ void destroy_flvmux_streamer(void* streamer) {
 
 namespace cpp_streamer
 {
+//return the offset of the start code(0x000001 or 0x00000001) from the pos, or len if not found
+static size_t FindStartCode(const uint8_t* data, size_t len, size_t pos, size_t& code_len) {
+    for (size_t i = pos; i + 3 <= len; i++) {
+        if ((data[i] != 0) || (data[i + 1] != 0)) {
+            continue;
+        }
+        if (data[i + 2] == 0x01) {
+            code_len = 3;
+            return i;
+        }
+        if ((i + 4 <= len) && (data[i + 2] == 0) && (data[i + 3] == 0x01)) {
+            code_len = 4;
+            return i;
+        }
+    }
+    code_len = 0;
+    return len;
+}
+
 #define FLV_MUX_NAME "flvmux"
 
 std::map<std::string, std::string> FlvMuxer::def_options_ = {
@@ -63,6 +82,17 @@ void FlvMuxer::Report(const std::string& type, const std::string& value) {
         report_->OnReport(name_, type, value);
     }
 }
+int FlvMuxer::SourceBatch(MediaPacketSpan pkts) {
+    batch_mode_ = true;
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        SourceData(pkt_ptr);
+    }
+    batch_mode_ = false;
+
+    FlushBatch();
+    return (int)pkts.size();
+}
+
 int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     if (!pkt_ptr) {
         return 0;
@@ -82,6 +112,11 @@ int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
             LogErrorf(logger_, "flv mux input data fail to find nalu start code");
             return -1;
         }
+        size_t code_len = 0;
+        if ((pkt_ptr->codec_type_ == MEDIA_CODEC_H264) &&
+            (FindStartCode(p, len, nalu_type_pos, code_len) < (size_t)len)) {
+            return SourceVideoFrame(pkt_ptr);
+        }
 
         //LogInfoData(logger_, p, nalu_type_pos + 1, "nalu type");
         if (len < (int)sizeof(sps_) && len < (int)sizeof(pps_)) {
@@ -103,24 +138,13 @@ int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
             return -1;
         }
         if (H264_IS_KEYFRAME(p[nalu_type_pos]) || !first_video_) {
-            uint8_t extra_data[1024];
-            int extra_len = 0;
-
-            first_video_ = true;
-
-            get_video_extradata(pps_, pps_len_, sps_, sps_len_,
-                    extra_data, extra_len);
-            LogInfoData(logger_, extra_data, extra_len, "Avcc header");
-
-            Media_Packet_Ptr seq_ptr = std::make_shared<Media_Packet>();
-            seq_ptr->copy_properties(*(pkt_ptr.get()));
-            seq_ptr->is_seq_hdr_ = true;
-            seq_ptr->is_key_frame_ = false;
-            seq_ptr->buffer_ptr_->Reset();
-            seq_ptr->buffer_ptr_->AppendData((char*)extra_data, extra_len);
-            InputPacket(seq_ptr);
+            InputVideoSeqHeader(pkt_ptr);
         }
         int nalu_len = len - nalu_type_pos;
+
+        //the start code is rewritten in place, detach the shared payload first
+        pkt_ptr->MakeWritable();
+        p = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
         if (nalu_type_pos == 3) {
             pkt_ptr->buffer_ptr_->ConsumeData(-1);
             p--;
@@ -131,6 +155,95 @@ int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     return InputPacket(pkt_ptr);
 }
 
+void FlvMuxer::InputVideoSeqHeader(Media_Packet_Ptr pkt_ptr) {
+    uint8_t extra_data[1024];
+    int extra_len = 0;
+
+    first_video_ = true;
+
+    get_video_extradata(pps_, pps_len_, sps_, sps_len_,
+            extra_data, extra_len);
+    LogInfoData(logger_, extra_data, extra_len, "Avcc header");
+
+    Media_Packet_Ptr seq_ptr = make_media_packet(extra_len);
+    seq_ptr->copy_properties(*(pkt_ptr.get()));
+    seq_ptr->is_seq_hdr_ = true;
+    seq_ptr->is_key_frame_ = false;
+    seq_ptr->buffer_ptr_->Reset();
+    seq_ptr->buffer_ptr_->AppendData((char*)extra_data, extra_len);
+    InputPacket(seq_ptr);
+}
+
+//the annexb access unit with more than one nalu(eg: sps+pps+idr from the webrtc pull),
+//the sps/pps are kept for the avcc header, the others are written into one flv tag.
+int FlvMuxer::SourceVideoFrame(Media_Packet_Ptr pkt_ptr) {
+    uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+    size_t len = (size_t)pkt_ptr->buffer_ptr_->DataLen();
+    std::vector<std::pair<size_t, size_t>> nalus;//offset, length
+    size_t code_len = 0;
+    size_t frame_len = 0;
+    bool key_frame = false;
+
+    size_t pos = FindStartCode(p, len, 0, code_len);
+    while (pos < len) {
+        size_t nalu_pos = pos + code_len;
+        size_t next_pos = FindStartCode(p, len, nalu_pos, code_len);
+        size_t nalu_len = next_pos - nalu_pos;
+
+        pos = next_pos;
+        if (nalu_len == 0) {
+            continue;
+        }
+        uint8_t nalu_type = p[nalu_pos];
+        if (H264_IS_AUD(nalu_type)) {
+            continue;
+        }
+        if (H264_IS_SPS(nalu_type) || H264_IS_PPS(nalu_type)) {
+            if (nalu_len > sizeof(sps_)) {
+                LogErrorf(logger_, "flv mux sps/pps length:%lu is too long", nalu_len);
+                continue;
+            }
+            if (H264_IS_SPS(nalu_type)) {
+                memcpy(sps_, p + nalu_pos, nalu_len);
+                sps_len_ = (int)nalu_len;
+            } else {
+                memcpy(pps_, p + nalu_pos, nalu_len);
+                pps_len_ = (int)nalu_len;
+            }
+            continue;
+        }
+        if (H264_IS_KEYFRAME(nalu_type)) {
+            key_frame = true;
+        }
+        nalus.push_back(std::make_pair(nalu_pos, nalu_len));
+        frame_len += 4 + nalu_len;
+    }
+
+    if (nalus.empty()) {
+        return 0;
+    }
+    if (pps_len_ <= 0 || sps_len_ <= 0) {
+        return -1;
+    }
+    if (key_frame || !first_video_) {
+        InputVideoSeqHeader(pkt_ptr);
+    }
+
+    Media_Packet_Ptr frame_ptr = make_media_packet(frame_len);
+    frame_ptr->copy_properties(*(pkt_ptr.get()));
+    frame_ptr->is_seq_hdr_   = false;
+    frame_ptr->is_key_frame_ = key_frame;
+
+    for (auto& nalu : nalus) {
+        uint8_t len_data[4];
+
+        ByteStream::Write4Bytes(len_data, (uint32_t)nalu.second);
+        frame_ptr->buffer_ptr_->AppendData((char*)len_data, sizeof(len_data));
+        frame_ptr->buffer_ptr_->AppendData((char*)p + nalu.first, nalu.second);
+    }
+    return InputPacket(frame_ptr);
+}
+
 void FlvMuxer::StartNetwork(const std::string& url, void* loop_handle) {
 }
 
@@ -299,12 +412,26 @@ void FlvMuxer::OutputPacket(Media_Packet_Ptr pkt_ptr) {
         return;
     }
 
+    if (batch_mode_) {
+        batch_pkts_.push_back(pkt_ptr);
+        return;
+    }
     for (auto& item : sinkers_) {
         item.second->SourceData(pkt_ptr);
     }
     return;
 }
 
+void FlvMuxer::FlushBatch() {
+    if (batch_pkts_.empty()) {
+        return;
+    }
+    for (auto& item : sinkers_) {
+        item.second->SourceBatch(batch_pkts_);
+    }
+    batch_pkts_.clear();
+}
+
 int FlvMuxer::MuxFlvHeader(Media_Packet_Ptr pkt_ptr) {
     uint8_t flag = 0;
     /*|'F'(8)|'L'(8)|'V'(8)|version(8)|TypeFlagsReserved(5)|TypeFlagsAudio(1)|TypeFlagsReserved(1)|TypeFlagsVideo(1)|DataOffset(32)|PreviousTagSize(32)|*/
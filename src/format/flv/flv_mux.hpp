@@ -31,13 +31,17 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
 
 public:
     int InputPacket(Media_Packet_Ptr pkt_ptr);
 
 private:
     int MuxFlvHeader(Media_Packet_Ptr pkt_ptr);
+    int SourceVideoFrame(Media_Packet_Ptr pkt_ptr);
+    void InputVideoSeqHeader(Media_Packet_Ptr pkt_ptr);
     void OutputPacket(Media_Packet_Ptr pkt_ptr);
+    void FlushBatch();
     void Report(const std::string& type, const std::string& value);
 
 private:
@@ -54,6 +58,10 @@ private:
 private:
     bool header_ready_ = false;
 
+private:
+    bool batch_mode_ = false;
+    std::vector<Media_Packet_Ptr> batch_pkts_;
+
 private:
     static std::map<std::string, std::string> def_options_;
 };
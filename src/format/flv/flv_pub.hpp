@@ -63,6 +63,7 @@ inline void flv_audio_asc_decode(char* data, uint8_t& audio_type, uint8_t& sampl
 inline int AddFlvMediaHeader(Media_Packet_Ptr pkt_ptr, Logger* logger) {
     uint8_t* p;
 
+    pkt_ptr->MakeWritable();
     pkt_ptr->fmt_type_ = MEDIA_FORMAT_FLV;
     if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
         p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData(-2);
@@ -63,7 +63,9 @@ MpegtsDemux::MpegtsDemux():_data_total(0)
 }
 
 MpegtsDemux::~MpegtsDemux() {
-
+    if (pacing_) {
+        pacing_->Remove(this);
+    }
 }
 
 std::string MpegtsDemux::StreamerName() {
@@ -100,8 +102,26 @@ int MpegtsDemux::SourceData(Media_Packet_Ptr pkt_ptr) {
     return Decode(pkt_ptr->buffer_ptr_);
 }
 
-void MpegtsDemux::StartNetwork(const std::string& url, void* loop_handle) {
+int MpegtsDemux::SourceBatch(MediaPacketSpan pkts) {
+    batch_mode_ = true;
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        if (pkt_ptr) {
+            Decode(pkt_ptr->buffer_ptr_);
+        }
+    }
+    batch_mode_ = false;
+
+    FlushBatch();
+    return (int)pkts.size();
+}
 
+//the loop is used to pace the output packets for the re option,
+//so the caller thread is not blocked. the pacing is reported to the reporter:
+//"full"(stop the input), "drain"(go on) and "empty"(all the packets are output).
+void MpegtsDemux::StartNetwork(const std::string& url, void* loop_handle) {
+    if (loop_handle) {
+        pacing_ = PacingScheduler::GetScheduler((uv_loop_t*)loop_handle);
+    }
 }
 
 void MpegtsDemux::AddOption(const std::string& key, const std::string& value) {
@@ -545,7 +565,7 @@ void MpegtsDemux::OnCallback(unsigned short pid, uint64_t dts, uint64_t pts) {
                 if (H264_IS_AUD(p[nalu_type_pos])) {
                     continue;
                 }
-                Media_Packet_Ptr output_ptr = std::make_shared<Media_Packet>();
+                Media_Packet_Ptr output_ptr = make_media_packet(nalu_len);
                 output_ptr->copy_properties(*(pkt_ptr.get()));
                 output_ptr->buffer_ptr_->Reset();
 
@@ -585,7 +605,7 @@ void MpegtsDemux::OnCallback(unsigned short pid, uint64_t dts, uint64_t pts) {
                 //LogInfof(logger_, "opus data index:%lu, data_p:%p, len:%lu",
                 //        i, data_p, len);
 
-                Media_Packet_Ptr new_pkt_ptr = std::make_shared<Media_Packet>();
+                Media_Packet_Ptr new_pkt_ptr = make_media_packet(len);
                 new_pkt_ptr->copy_properties(pkt_ptr);
                 new_pkt_ptr->buffer_ptr_->Reset();
                 new_pkt_ptr->buffer_ptr_->AppendData((char*)data_p, len);
@@ -604,7 +624,17 @@ void MpegtsDemux::OnCallback(unsigned short pid, uint64_t dts, uint64_t pts) {
 
 void MpegtsDemux::Output(Media_Packet_Ptr pkt_ptr) {
     if (options_["re"] == "true") {
+        if (pacing_) {
+            if (!pacing_->Push(this, pkt_ptr, waiter_.GetSendMs(pkt_ptr, now_millisec()))) {
+                //the producer should stop the input until "drain"
+                ReportEvent("pacing", "full");
+            }
+            return;
+        }
         waiter_.Wait(pkt_ptr);
+    } else if (batch_mode_) {
+        batch_pkts_.push_back(pkt_ptr);
+        return;
     }
 
     /*
@@ -621,6 +651,30 @@ void MpegtsDemux::Output(Media_Packet_Ptr pkt_ptr) {
     }
 }
 
+void MpegtsDemux::OnPacingOutput(Media_Packet_Ptr pkt_ptr) {
+    for(auto& sinker : sinkers_) {
+        sinker.second->SourceData(pkt_ptr);
+    }
+}
+
+void MpegtsDemux::OnPacingDrain() {
+    ReportEvent("pacing", "drain");
+}
+
+void MpegtsDemux::OnPacingEmpty() {
+    ReportEvent("pacing", "empty");
+}
+
+void MpegtsDemux::FlushBatch() {
+    if (batch_pkts_.empty()) {
+        return;
+    }
+    for(auto& sinker : sinkers_) {
+        sinker.second->SourceBatch(batch_pkts_);
+    }
+    batch_pkts_.clear();
+}
+
 bool MpegtsDemux::IsPmt(unsigned short pid) {
     for (size_t index = 0; index < _pat._pid_vec.size(); index++) {
         if (_pat._pid_vec[index]._program_number != 0) {
@@ -5,6 +5,7 @@
 #include "data_buffer.hpp"
 #include "cpp_streamer_interface.hpp"
 #include "wait_basedon_timestamp.hpp"
+#include "pacing_scheduler.hpp"
 
 #include <string>
 #include <memory>
@@ -18,7 +19,7 @@ void destroy_mpegtsdemux_streamer(void* streamer);
 
 namespace cpp_streamer
 {
-class MpegtsDemux : public CppStreamerInterface
+class MpegtsDemux : public CppStreamerInterface, public PacingSinkI
 {
 public:
     MpegtsDemux();
@@ -35,6 +36,12 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
+
+public:
+    virtual void OnPacingOutput(Media_Packet_Ptr pkt_ptr) override;
+    virtual void OnPacingDrain() override;
+    virtual void OnPacingEmpty() override;
 
 private:
     int DecodeUnit(unsigned char* data_p);
@@ -46,6 +53,7 @@ private:
     void ReportEvent(const std::string& type, const std::string& value);
     int GetMediaInfoByPid(uint16_t pid, MEDIA_PKT_TYPE& media_type, MEDIA_CODEC_TYPE& codec_type);
     void Output(Media_Packet_Ptr pkt_ptr);
+    void FlushBatch();
 
 private:
     PatInfo _pat;
@@ -61,6 +69,11 @@ private:
 
 private:
     WaitBasedOnTimestamp waiter_;
+    PacingScheduler* pacing_ = nullptr;//the re option is paced in the loop if it's set
+
+private:
+    bool batch_mode_ = false;
+    std::vector<Media_Packet_Ptr> batch_pkts_;
 
 private:
     int64_t opus_count_ = 0;
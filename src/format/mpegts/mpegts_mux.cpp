@@ -168,6 +168,19 @@ int MpegtsMux::SourceData(Media_Packet_Ptr pkt_ptr) {
     return InputPacket(pkt_ptr);
 }
 
+int MpegtsMux::SourceBatch(MediaPacketSpan pkts) {
+    batch_mode_ = true;
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        if (pkt_ptr) {
+            InputPacket(pkt_ptr);
+        }
+    }
+    batch_mode_ = false;
+
+    FlushBatch();
+    return (int)pkts.size();
+}
+
 void MpegtsMux::ReportEvent(const std::string& type, const std::string& value) {
     if (report_) {
         report_->OnReport(name_, type, value);
@@ -296,19 +309,25 @@ int MpegtsMux::HandleH264(Media_Packet_Ptr pkt_ptr) {
                 return 0;
             }
         } else {
-            int pos = GetNaluTypePos(data);
-            uint8_t nalu_type = data[pos] & 0x1f;
-            if (H264_IS_PPS(nalu_type)) {
-                pps_len_ = data_len;
-                memcpy(pps_, data, pps_len_);
-                return 0;
+            //the annexb sequence header may carry both the sps and the pps
+            std::vector<std::shared_ptr<DataBuffer>> nalus;
+            if (!AnnexB2Nalus(data, data_len, nalus)) {
+                ReportEvent("error", "annexb to nalus error");
+                return -1;
             }
-            if (H264_IS_SPS(nalu_type)) {
-                sps_len_ = data_len;
-                memcpy(sps_, data, sps_len_);
-                return 0;
+            for (std::shared_ptr<DataBuffer> item : nalus) {
+                uint8_t* nalu_data = (uint8_t*)item->Data();
+                size_t nalu_len = (size_t)item->DataLen();
+                uint8_t nalu_type = nalu_data[GetNaluTypePos(nalu_data)] & 0x1f;
+
+                if (H264_IS_PPS(nalu_type)) {
+                    pps_len_ = nalu_len;
+                    memcpy(pps_, nalu_data, pps_len_);
+                } else if (H264_IS_SPS(nalu_type)) {
+                    sps_len_ = nalu_len;
+                    memcpy(sps_, nalu_data, sps_len_);
+                }
             }
- 
         }
         return 0;
     }
@@ -483,6 +502,7 @@ int MpegtsMux::HandleAudioAac(Media_Packet_Ptr pkt_ptr) {
     //LogInfof(logger_, "audio codec type:%s, aac asc type:%d, aac adts type:%d, sample rate:%d, channel:%d",
     //        codectype_tostring(audio_codec_type_).c_str(), pkt_ptr->aac_asc_type_, adts_type, sample_rate_, channel_);
     //LogInfoData(logger_, adts_data, adts_len, "adts header");
+    pkt_ptr->MakeWritable();
     pkt_ptr->buffer_ptr_->ConsumeData(0 - adts_len);
     uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
     memcpy(p, adts_data, adts_len);
@@ -1004,9 +1024,20 @@ int MpegtsMux::WritePes(Media_Packet_Ptr pkt_ptr) {
 }
 
 void MpegtsMux::TsOutput(Media_Packet_Ptr pkt_ptr, uint8_t* data) {
+    if (batch_mode_) {
+        //one ts packet for all the sinkers in batch mode
+        Media_Packet_Ptr ts_pkt_ptr = make_media_packet(TS_PACKET_SIZE);
+        if (pkt_ptr.get() != nullptr) {
+            ts_pkt_ptr->copy_properties(pkt_ptr);
+        }
+        ts_pkt_ptr->fmt_type_ = MEDIA_FORMAT_MPEGTS;
+        ts_pkt_ptr->buffer_ptr_->AppendData((char*)data, (size_t)TS_PACKET_SIZE);
+        batch_pkts_.push_back(ts_pkt_ptr);
+        return;
+    }
     if (!sinkers_.empty()) {
         for (auto& sinker : sinkers_) {
-            Media_Packet_Ptr ts_pkt_ptr = std::make_shared<Media_Packet>(256);
+            Media_Packet_Ptr ts_pkt_ptr = make_media_packet(TS_PACKET_SIZE);
             if (pkt_ptr.get() != nullptr) {
                 ts_pkt_ptr->copy_properties(pkt_ptr);
             }
@@ -1019,4 +1050,27 @@ void MpegtsMux::TsOutput(Media_Packet_Ptr pkt_ptr, uint8_t* data) {
     return;
 }
 
+void MpegtsMux::FlushBatch() {
+    if (batch_pkts_.empty()) {
+        return;
+    }
+    //each sinker has its own packets as in the single packet output,
+    //the payload is shared, the last sinker takes the original ones
+    size_t index = 0;
+    for (auto& sinker : sinkers_) {
+        index++;
+        if (index == sinkers_.size()) {
+            sinker.second->SourceBatch(batch_pkts_);
+            break;
+        }
+        std::vector<Media_Packet_Ptr> pkts;
+        pkts.reserve(batch_pkts_.size());
+        for (Media_Packet_Ptr& pkt_ptr : batch_pkts_) {
+            pkts.push_back(pkt_ptr->shared_copy());
+        }
+        sinker.second->SourceBatch(pkts);
+    }
+    batch_pkts_.clear();
+}
+
 }
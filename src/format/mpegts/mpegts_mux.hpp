@@ -45,6 +45,7 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
 
 private:
     int WritePat();
@@ -63,6 +64,7 @@ private:
     int HandleVideo(Media_Packet_Ptr pkt_ptr);
     int HandleAudio(Media_Packet_Ptr pkt_ptr);
     void TsOutput(Media_Packet_Ptr pkt_ptr, uint8_t* data);
+    void FlushBatch();
 
     int HandleH264(Media_Packet_Ptr pkt_ptr);
     int HandleH265(Media_Packet_Ptr pkt_ptr);
@@ -133,6 +135,10 @@ private:
     bool ready_          = false;
     bool keyframe_ready_ = false;
     std::queue<Media_Packet_Ptr> wait_queue_;
+
+private:
+    bool batch_mode_ = false;
+    std::vector<Media_Packet_Ptr> batch_pkts_;
 };
 
 }
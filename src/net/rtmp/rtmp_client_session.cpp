@@ -74,7 +74,7 @@ int RtmpClientSession::RtmpWrite(Media_Packet_Ptr pkt_ptr) {
    
     WriteDataByChunkStream(this, csid,
                     pkt_ptr->dts_, type_id,
-                    pkt_ptr->streamid_, this->GetChunkSize(),
+                    pkt_ptr->context_ ? pkt_ptr->context_->streamid_ : 0, this->GetChunkSize(),
                     pkt_ptr->buffer_ptr_, logger_);
 
     return RTMP_OK;
@@ -22,11 +22,6 @@ namespace cpp_streamer
 
 #define RTMP_PUBLISH_NAME "rtmppublish"
 
-void SourceRtmpData(uv_async_t *handle) {
-    RtmpPublish* push = (RtmpPublish*)(handle->data);
-    push->HandleMediaData();
-}
-
 RtmpPublish::RtmpPublish():statics_(MEDIA_STATICS_DEF_INTERVAL)
 
 {
@@ -37,21 +32,16 @@ RtmpPublish::RtmpPublish():statics_(MEDIA_STATICS_DEF_INTERVAL)
 
 RtmpPublish::~RtmpPublish()
 {
+    packet_queue_.Close();
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Remove(this);
+    }
     Release();
 }
 
 Media_Packet_Ptr RtmpPublish::GetMediaPacket() {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    Media_Packet_Ptr pkt_ptr;
-    if (packet_queue_.empty()) {
-        return pkt_ptr;
-    }
-        
-    pkt_ptr = packet_queue_.front();
-    packet_queue_.pop();
-
-    return pkt_ptr;
+    return packet_queue_.Pop();
 }
 
 void RtmpPublish::HandleVideoData(Media_Packet_Ptr pkt_ptr) {
@@ -109,7 +99,7 @@ void RtmpPublish::HandleVideoData(Media_Packet_Ptr pkt_ptr) {
             get_video_extradata(pps_, pps_len_, sps_, sps_len_,
                     extra_data, extra_len);
 
-            Media_Packet_Ptr seq_ptr = std::make_shared<Media_Packet>();
+            Media_Packet_Ptr seq_ptr = make_media_packet(extra_len);
             seq_ptr->copy_properties(*(pkt_ptr.get()));
             seq_ptr->is_seq_hdr_ = true;
             seq_ptr->is_key_frame_ = false;
@@ -125,7 +115,7 @@ void RtmpPublish::HandleVideoData(Media_Packet_Ptr pkt_ptr) {
         ByteStream::Write4Bytes(nalu_len_data, nalu_len);
         p += nalu_type_pos;
 
-        Media_Packet_Ptr video_ptr = std::make_shared<Media_Packet>();
+        Media_Packet_Ptr video_ptr = make_media_packet(sizeof(nalu_len_data) + nalu_len);
         video_ptr->copy_properties(*(pkt_ptr.get()));
         video_ptr->is_seq_hdr_   = false;
         video_ptr->is_key_frame_ = H264_IS_KEYFRAME(p[nalu_type_pos]);
@@ -138,6 +128,7 @@ void RtmpPublish::HandleVideoData(Media_Packet_Ptr pkt_ptr) {
 }
 
 void RtmpPublish::SendVideo(Media_Packet_Ptr pkt_ptr) {
+    pkt_ptr->MakeWritable();
     uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData(-5);
     
     p[0] = 0;
@@ -179,6 +170,7 @@ void RtmpPublish::HandleAudioData(Media_Packet_Ptr pkt_ptr) {
 
     pkt_ptr->fmt_type_ = MEDIA_FORMAT_FLV;
     if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+        pkt_ptr->MakeWritable();
         p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData(-2);
 
         if (pkt_ptr->codec_type_ == MEDIA_CODEC_AAC) {
@@ -203,16 +195,27 @@ void RtmpPublish::HandleAudioData(Media_Packet_Ptr pkt_ptr) {
 
 }
 
-void RtmpPublish::HandleMediaData() {
-    while(true) {
+size_t RtmpPublish::OnScheduleRun(size_t budget) {
+    return HandleMediaData(budget);
+}
+
+bool RtmpPublish::HasScheduleData() {
+    return packet_queue_.Depth() > 0;
+}
+
+size_t RtmpPublish::HandleMediaData(size_t budget) {
+    size_t count = 0;
+
+    while(count < budget) {
         Media_Packet_Ptr pkt_ptr = GetMediaPacket();
         if (!pkt_ptr) {
             break;
         }
+        count++;
 
         if (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) {
             SendRtmp(pkt_ptr);
-            return;
+            continue;
         }
 
         if (pkt_ptr->fmt_type_ == MEDIA_FORMAT_RAW) {
@@ -229,7 +232,7 @@ void RtmpPublish::HandleMediaData() {
         }
 
     }
-    return;
+    return count;
 }
 
 
@@ -276,13 +279,26 @@ int RtmpPublish::RemoveSinker(const std::string& name) {
 }
 
 int RtmpPublish::SourceData(Media_Packet_Ptr pkt_ptr) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    packet_queue_.Push(pkt_ptr->shared_copy());
+
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Notify(this);
+    }
+    return (int)packet_queue_.Depth();
+}
 
-    packet_queue_.push(pkt_ptr);
+int RtmpPublish::SourceBatch(MediaPacketSpan pkts) {
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        packet_queue_.Push(pkt_ptr->shared_copy());
+    }
 
-    async_.data = (void*)this;
-    uv_async_send(&async_);
-    return (int)packet_queue_.size();
+    //one notify for the whole batch
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Notify(this);
+    }
+    return (int)pkts.size();
 }
 
 void RtmpPublish::StartNetwork(const std::string& url, void* loop_handle) {
@@ -292,13 +308,22 @@ void RtmpPublish::StartNetwork(const std::string& url, void* loop_handle) {
         thread_ptr_ = std::make_shared<std::thread>(&RtmpPublish::OnWork, this);
     } else {
         loop_ = (uv_loop_t*)loop_handle;
-        uv_async_init(loop_, &async_, SourceRtmpData);
+        scheduler_ = LoopScheduler::GetScheduler(loop_);
+        if (packet_queue_.Depth() > 0) {
+            scheduler_.load()->Notify(this);
+        }
         Init();
     }
 }
 
 void RtmpPublish::AddOption(const std::string& key, const std::string& value) {
-
+    if (key == "queue_policy") {
+        QUEUE_OVERFLOW_POLICY policy;
+        if (!GetQueuePolicyByString(value, policy)) {
+            CSM_THROW_ERROR("unknown queue policy:%s", value.c_str());
+        }
+        packet_queue_.SetPolicy(policy);
+    }
 }
 
 void RtmpPublish::SetReporter(StreamerReport* reporter) {
@@ -345,7 +370,10 @@ void RtmpPublish::OnClose(int ret_code) {
 void RtmpPublish::OnWork() {
     loop_ = (uv_loop_t*)malloc(sizeof(uv_loop_t));
     uv_loop_init(loop_);
-    uv_async_init(loop_, &async_, SourceRtmpData);
+    scheduler_ = LoopScheduler::GetScheduler(loop_);
+    if (packet_queue_.Depth() > 0) {
+        scheduler_.load()->Notify(this);
+    }
     Init();
 
     while(running_) {
@@ -388,7 +416,9 @@ void RtmpPublish::ReportStatics() {
 
     ss << "\"akbits\":" << statics_.GetAudioKbitRate() << ",";
     ss << "\"aframes\":" << statics_.GetAudioFrameRate() << ",";
-    ss << "\"gop\":" << statics_.GetGop();
+    ss << "\"gop\":" << statics_.GetGop() << ",";
+    ss << "\"queue_depth\":" << packet_queue_.Depth() << ",";
+    ss << "\"queue_drop\":" << packet_queue_.DropCount();
     ss << "}";
 
     ReportEvent("statics", ss.str());
@@ -1,6 +1,8 @@
 #ifndef RTMP_PUBLISH_HPP
 #define RTMP_PUBLISH_HPP
 #include "cpp_streamer_interface.hpp"
+#include "media_packet_queue.hpp"
+#include "loop_scheduler.hpp"
 #include "rtmp_client_session.hpp"
 #include "timeex.hpp"
 #include "media_statics.hpp"
@@ -26,10 +28,8 @@ void* make_rtmppublish_streamer();
 void destroy_rtmppublish_streamer(void* streamer);
 }
 
-class RtmpPublish : public CppStreamerInterface, public RtmpClientCallbackI
+class RtmpPublish : public CppStreamerInterface, public RtmpClientCallbackI, public LoopScheduleTaskI
 {
-friend void SourceRtmpData(uv_async_t *handle);
-
 public:
     RtmpPublish();
     virtual ~RtmpPublish();
@@ -43,6 +43,11 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
+
+public:
+    virtual size_t OnScheduleRun(size_t budget) override;
+    virtual bool HasScheduleData() override;
 
 public:
     virtual void OnMessage(int ret_code, Media_Packet_Ptr pkt_ptr) override;
@@ -60,7 +65,7 @@ private:
     void ReportStatics();
 
     Media_Packet_Ptr GetMediaPacket();
-    void HandleMediaData();
+    size_t HandleMediaData(size_t budget);
     void HandleVideoData(Media_Packet_Ptr pkt_ptr);
     void HandleAudioData(Media_Packet_Ptr pkt_ptr);
     void SendVideo(Media_Packet_Ptr pkt_ptr);
@@ -76,9 +81,8 @@ private:
     bool ready_   = false;
 
 private:
-    std::queue<Media_Packet_Ptr> packet_queue_;
-    std::mutex mutex_;
-    uv_async_t async_;
+    MediaPacketQueue packet_queue_;
+    std::atomic<LoopScheduler*> scheduler_{nullptr};
 
 private:
     RtmpClientSession* client_session_ = nullptr;
@@ -182,10 +182,11 @@ Media_Packet_Ptr RtmpSessionBase::GetMediaPacket(CHUNK_STREAM_PTR cs_ptr) {
     pkt_ptr->buffer_ptr_->Reset();
     pkt_ptr->buffer_ptr_->AppendData(cs_ptr->chunk_data_ptr_->Data(), cs_ptr->chunk_data_ptr_->DataLen());
 
-    pkt_ptr->app_        = req_.app_;
-    pkt_ptr->streamname_ = req_.stream_name_;
-    pkt_ptr->key_        = req_.key_;
-    pkt_ptr->streamid_   = cs_ptr->msg_stream_id_;
+    if (!stream_context_ || (stream_context_->streamid_ != cs_ptr->msg_stream_id_)) {
+        stream_context_ = StreamContext::Intern(req_.key_, "", req_.app_,
+                                            req_.stream_name_, cs_ptr->msg_stream_id_);
+    }
+    pkt_ptr->context_ = stream_context_;
 
     return pkt_ptr;
 }
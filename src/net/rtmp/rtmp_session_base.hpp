@@ -69,6 +69,7 @@ public:
     uint32_t remote_window_acksize_ = 2500000;
     uint32_t ack_received_          = 0;
     RtmpRequest req_;
+    StreamContextPtr stream_context_;
     uint32_t stream_id_ = 1;
     RTMP_SERVER_SESSION_PHASE server_phase_ = initial_phase;
     RTMP_CLIENT_SESSION_PHASE client_phase_ = client_initial_phase;
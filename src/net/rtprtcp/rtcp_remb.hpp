@@ -0,0 +1,152 @@
+#ifndef RTCP_REMB_HPP
+#define RTCP_REMB_HPP
+#include "rtprtcp_pub.hpp"
+#include "rtcp_fb_pub.hpp"
+#include "logger.hpp"
+#include "byte_stream.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <sstream>
+
+namespace cpp_streamer
+{
+/*
+draft-alvestrand-rmcat-remb-03
+    0                   1                   2                   3
+    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |V=2|P| FMT=15  |   PT=206      |             length            |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |                  SSRC of packet sender                        |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |                  SSRC of media source(0)                      |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |  Unique identifier 'R' 'E' 'M' 'B'                            |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |  Num SSRC     | BR Exp    |  BR Mantissa                      |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |   SSRC feedback                                               |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |  ...                                                          |
+*/
+
+#define REMB_MAX_SSRCS 16
+
+class RtcpRemb
+{
+public:
+    RtcpRemb() {
+        memset(this->data, 0, sizeof(this->data));
+        header_ = (RtcpFbCommonHeader*)(this->data);
+        fb_header_ = (RtcpFbHeader*)(header_ + 1);
+
+        //init field...
+        header_->version     = 2;
+        header_->padding     = 0;
+        header_->fmt         = (uint8_t)FB_PS_AFB;
+        header_->packet_type = (uint8_t)RTCP_PSFB;
+        fb_header_->media_ssrc = 0;
+    }
+
+    ~RtcpRemb() {
+    }
+
+    static RtcpRemb* Parse(uint8_t* data, size_t len) {
+        const size_t fixed_len = sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader) + 8;
+        if (len < fixed_len) {
+            return nullptr;
+        }
+        uint8_t* p = data + sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader);
+        if (memcmp(p, "REMB", 4) != 0) {
+            return nullptr;
+        }
+        size_t num_ssrc = p[4];
+        if ((num_ssrc > REMB_MAX_SSRCS) || (len < fixed_len + num_ssrc * 4)) {
+            return nullptr;
+        }
+        RtcpRemb* pkt = new RtcpRemb();
+        memcpy(pkt->data, data, fixed_len + num_ssrc * 4);
+        pkt->header_ = (RtcpFbCommonHeader*)(pkt->data);
+        pkt->fb_header_ = (RtcpFbHeader*)(pkt->header_ + 1);
+
+        uint8_t exp       = (p[5] >> 2) & 0x3f;
+        uint32_t mantissa = ((uint32_t)(p[5] & 0x03) << 16) | ByteStream::Read2Bytes(p + 6);
+        pkt->bitrate_ = (uint64_t)mantissa << exp;
+
+        p += 8;
+        for (size_t i = 0; i < num_ssrc; i++) {
+            pkt->ssrcs_.push_back(ByteStream::Read4Bytes(p));
+            p += 4;
+        }
+        return pkt;
+    }
+
+public:
+    void SetSenderSsrc(uint32_t sender_ssrc) { fb_header_->sender_ssrc = (uint32_t)htonl(sender_ssrc);}
+    uint32_t GetSenderSsrc() { return (uint32_t)ntohl(fb_header_->sender_ssrc); }
+
+    void SetBitrate(uint64_t bitrate) { bitrate_ = bitrate; }
+    uint64_t GetBitrate() { return bitrate_; }
+
+    void AddSsrc(uint32_t ssrc) {
+        if (ssrcs_.size() < REMB_MAX_SSRCS) {
+            ssrcs_.push_back(ssrc);
+        }
+    }
+    const std::vector<uint32_t>& GetSsrcs() { return ssrcs_; }
+
+    //the bitrate is encoded as: mantissa(18bits) * 2^exp(6bits)
+    uint8_t* Serial() {
+        uint8_t* p = this->data + sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader);
+        uint64_t mantissa = bitrate_;
+        uint8_t exp = 0;
+
+        while (mantissa > 0x3ffff) {
+            mantissa >>= 1;
+            exp++;
+        }
+        memcpy(p, "REMB", 4);
+        p[4] = (uint8_t)ssrcs_.size();
+        p[5] = (uint8_t)((exp << 2) | ((mantissa >> 16) & 0x03));
+        ByteStream::Write2Bytes(p + 6, (uint16_t)(mantissa & 0xffff));
+        p += 8;
+        for (uint32_t ssrc : ssrcs_) {
+            ByteStream::Write4Bytes(p, ssrc);
+            p += 4;
+        }
+        header_->length = htons((uint16_t)(GetDataLen() / 4 - 1));
+        return this->data;
+    }
+
+    size_t GetDataLen() {
+        return sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader) + 8 + ssrcs_.size() * 4;
+    }
+
+    std::string Dump() {
+        std::stringstream ss;
+
+        ss << "rtcp remb length:" << this->GetDataLen();
+        ss << ", sender ssrc:" << this->GetSenderSsrc();
+        ss << ", bitrate:" << bitrate_ << ", ssrcs:";
+        for (uint32_t ssrc : ssrcs_) {
+            ss << " " << ssrc;
+        }
+        ss << "\r\n";
+        return ss.str();
+    }
+
+private:
+    uint8_t data[sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader) + 8 + REMB_MAX_SSRCS * 4];
+    RtcpFbCommonHeader* header_ = nullptr;
+    RtcpFbHeader* fb_header_    = nullptr;
+    uint64_t bitrate_ = 0;
+    std::vector<uint32_t> ssrcs_;
+};
+
+}
+
+#endif
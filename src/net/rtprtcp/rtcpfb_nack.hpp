@@ -32,6 +32,9 @@ typedef struct
     uint16_t lost_bitmap;
 } RtcpNackBlock;
 
+//the max blocks in one rtcp nack packet
+#define RTCP_NACK_BLOCKS_MAX 256
+
 class RtcpFbNack
 {
 public:
@@ -73,12 +76,13 @@ public:
 
         for (size_t index = 0; index < seq_vec.size(); index++) {
             uint16_t lost_seq = seq_vec[index];
-            report_seqs.push_back(lost_seq);
 
-            if ((report_seqs[report_seqs.size() - 1] - report_seqs[0]) > 16) {
+            //the seq out of the block range starts a new block
+            if (!report_seqs.empty() && ((uint16_t)(lost_seq - report_seqs[0]) > 16)) {
                 InsertBlock(report_seqs);
                 report_seqs.clear();
             }
+            report_seqs.push_back(lost_seq);
         }
         if (!report_seqs.empty()) {
             InsertBlock(report_seqs);
@@ -92,7 +96,15 @@ public:
 
         for (size_t r = 1; r < report_seqs.size(); r++) {
             uint16_t temp_seq = report_seqs[r];
-            bitmap |= 1 << (16 - (temp_seq - packet_id));
+            bitmap |= 1 << (uint16_t)(temp_seq - packet_id - 1);
+        }
+        InsertBlock(packet_id, bitmap);
+    }
+
+    //bitmap: the bit i is the lost seq packet_id + i + 1
+    void InsertBlock(uint16_t packet_id, uint16_t bitmap) {
+        if (this->data_len + sizeof(RtcpNackBlock) > sizeof(this->data)) {
+            return;
         }
         RtcpNackBlock* block = (RtcpNackBlock*)(this->data + this->data_len);
         block->packet_id   = htons(packet_id);
@@ -0,0 +1,200 @@
+#ifndef RTCP_FEEDBACK_TCC_HPP
+#define RTCP_FEEDBACK_TCC_HPP
+#include "rtprtcp_pub.hpp"
+#include "rtcp_fb_pub.hpp"
+#include "byte_stream.hpp"
+#include "logger.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <arpa/inet.h>
+
+namespace cpp_streamer
+{
+/*
+draft-holmer-rmcat-transport-wide-cc-extensions-01
+        0                   1                   2                   3
+        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+header |V=2|P|  FMT=15 |    PT=205     |           length              |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                     SSRC of packet sender                     |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                      SSRC of media source                     |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |      base sequence number     |      packet status count      |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                 reference time                | fb pkt. count |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |          packet chunk         |         packet chunk          |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       .                                                               .
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |         packet chunk          |  recv delta   |  recv delta   |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       .                                                               .
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+*/
+
+//reference time unit: 64ms, receive delta unit: 250us
+#define TCC_REF_TIME_UNIT_US  64000
+#define TCC_DELTA_UNIT_US     250
+
+typedef enum
+{
+    TCC_NOT_RECEIVED   = 0,
+    TCC_SMALL_DELTA    = 1,
+    TCC_LARGE_DELTA    = 2,
+    TCC_RESERVED_DELTA = 3
+} TCC_PACKET_STATUS;
+
+typedef struct TccPacketStatusS
+{
+    uint16_t seq;
+    bool received;
+    int64_t arrival_offset_us;//the arrival time from the reference time
+} TccPacketStatus;
+
+class RtcpFbTcc
+{
+public:
+    RtcpFbTcc()
+    {
+    }
+    ~RtcpFbTcc()
+    {
+    }
+
+public:
+    static RtcpFbTcc* Parse(uint8_t* data, size_t len) {
+        const size_t fixed_len = sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader) + 8;
+        if (len < fixed_len) {
+            CSM_THROW_ERROR("rtcp tcc feedback len(%lu) is too short", len);
+        }
+        RtcpFbTcc* pkt = new RtcpFbTcc();
+        if (!pkt->Decode(data, len)) {
+            delete pkt;
+            CSM_THROW_ERROR("rtcp tcc feedback len(%lu) is broken", len);
+        }
+        return pkt;
+    }
+
+public:
+    uint32_t GetSenderSsrc() { return sender_ssrc_; }
+    uint32_t GetMediaSsrc() { return media_ssrc_; }
+    uint16_t GetBaseSeq() { return base_seq_; }
+    uint16_t GetStatusCount() { return status_count_; }
+    uint32_t GetReferenceTime() { return ref_time_; }//24bits, 64ms unit
+    uint8_t GetFbPktCount() { return fb_pkt_count_; }
+    const std::vector<TccPacketStatus>& GetPacketStatus() { return packets_; }
+
+    std::string Dump() {
+        std::stringstream ss;
+        size_t received = 0;
+
+        for (const TccPacketStatus& status : packets_) {
+            if (status.received) {
+                received++;
+            }
+        }
+        ss << "rtcp fb tcc: sender ssrc=" << sender_ssrc_ << ", media ssrc=" << media_ssrc_
+           << ", base seq:" << base_seq_ << ", status count:" << status_count_
+           << ", reference time:" << ref_time_ << ", fb pkt count:" << (int)fb_pkt_count_
+           << ", received:" << received << "\r\n";
+        return ss.str();
+    }
+
+private:
+    bool Decode(uint8_t* data, size_t len) {
+        RtcpFbHeader* fb_header = (RtcpFbHeader*)(data + sizeof(RtcpFbCommonHeader));
+        uint8_t* p   = (uint8_t*)(fb_header + 1);
+        uint8_t* end = data + len;
+
+        sender_ssrc_  = ntohl(fb_header->sender_ssrc);
+        media_ssrc_   = ntohl(fb_header->media_ssrc);
+        base_seq_     = ByteStream::Read2Bytes(p);
+        status_count_ = ByteStream::Read2Bytes(p + 2);
+        ref_time_     = ByteStream::Read3Bytes(p + 4);
+        fb_pkt_count_ = p[7];
+        p += 8;
+
+        //packet chunks: the status of every packet
+        std::vector<uint8_t> symbols;
+        symbols.reserve(status_count_);
+        while (symbols.size() < status_count_) {
+            if (p + 2 > end) {
+                return false;
+            }
+            uint16_t chunk = ByteStream::Read2Bytes(p);
+            p += 2;
+
+            if ((chunk & 0x8000) == 0) {
+                //run length chunk: |T=0|S(2)|run length(13)|
+                uint8_t symbol  = (chunk >> 13) & 0x03;
+                size_t run_len  = chunk & 0x1fff;
+                for (size_t i = 0; (i < run_len) && (symbols.size() < status_count_); i++) {
+                    symbols.push_back(symbol);
+                }
+            } else if ((chunk & 0x4000) == 0) {
+                //status vector chunk: |T=1|S=0|14 one bit symbols|
+                for (int i = 13; (i >= 0) && (symbols.size() < status_count_); i--) {
+                    symbols.push_back((chunk >> i) & 0x01);
+                }
+            } else {
+                //status vector chunk: |T=1|S=1|7 two bits symbols|
+                for (int i = 6; (i >= 0) && (symbols.size() < status_count_); i--) {
+                    symbols.push_back((chunk >> (i * 2)) & 0x03);
+                }
+            }
+        }
+
+        //receive deltas of the received packets
+        int64_t arrival_offset_us = 0;
+        uint16_t seq = base_seq_;
+
+        packets_.clear();
+        packets_.reserve(symbols.size());
+        for (uint8_t symbol : symbols) {
+            TccPacketStatus status;
+            status.seq               = seq++;
+            status.received          = false;
+            status.arrival_offset_us = 0;
+
+            if (symbol == TCC_SMALL_DELTA) {
+                if (p + 1 > end) {
+                    return false;
+                }
+                arrival_offset_us += (int64_t)p[0] * TCC_DELTA_UNIT_US;
+                p += 1;
+                status.received = true;
+            } else if (symbol == TCC_LARGE_DELTA) {
+                if (p + 2 > end) {
+                    return false;
+                }
+                arrival_offset_us += (int64_t)(int16_t)ByteStream::Read2Bytes(p) * TCC_DELTA_UNIT_US;
+                p += 2;
+                status.received = true;
+            } else if (symbol == TCC_RESERVED_DELTA) {
+                return false;
+            }
+            status.arrival_offset_us = arrival_offset_us;
+            packets_.push_back(status);
+        }
+        return true;
+    }
+
+private:
+    uint32_t sender_ssrc_  = 0;
+    uint32_t media_ssrc_   = 0;
+    uint16_t base_seq_     = 0;
+    uint16_t status_count_ = 0;
+    uint32_t ref_time_     = 0;
+    uint8_t fb_pkt_count_  = 0;
+    std::vector<TccPacketStatus> packets_;
+};
+
+}
+#endif
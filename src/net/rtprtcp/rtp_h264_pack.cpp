@@ -74,6 +74,59 @@ std::vector<RtpPacket*> GenerateFuAPackets(uint8_t* nalu, size_t nalu_size, Head
     return packets;
 }
 
+RtpFramePayloads_Ptr PacketizeH264Nalu(const uint8_t* nalu, size_t nalu_size) {
+    RtpFramePayloads_Ptr payloads_ptr = std::make_shared<RtpFramePayloads>();
+
+    if (nalu_size <= kPayloadMaxSize) {
+        RtpPayloadItem item;
+
+        item.data   = nalu;
+        item.len    = nalu_size;
+        item.marker = true;
+        payloads_ptr->items_.push_back(item);
+        return payloads_ptr;
+    }
+
+    std::vector<int> fragment_sizes = SplitNalu(nalu_size - kNalHeaderSize);
+    uint8_t nalu_header     = nalu[0];
+    const uint8_t* fragment = nalu + kNalHeaderSize;
+
+    payloads_ptr->items_.resize(fragment_sizes.size());
+    for (size_t i = 0; i < fragment_sizes.size(); ++i) {
+        RtpPayloadItem& item = payloads_ptr->items_[i];
+        bool last = (i == (fragment_sizes.size() - 1));
+
+        // S | E | R | 5 bit type.
+        item.header[0]  = (nalu_header & (kFBit | kNriMask)) | NaluType::kFuA;
+        item.header[1]  = (i == 0 ? kSBit : 0) | (last ? kEBit : 0) | (nalu_header & kTypeMask);
+        item.header_len = kFuAHeaderSize;
+        item.data       = fragment;
+        item.len        = fragment_sizes[i];
+        item.marker     = last;
+
+        fragment += fragment_sizes[i];
+    }
+    return payloads_ptr;
+}
+
+RtpFramePayloads_Ptr GetH264FramePayloads(Media_Packet_Ptr pkt_ptr, const uint8_t* nalu, size_t nalu_size) {
+    Media_Packet_Attachment_Ptr attachment_ptr = pkt_ptr->GetAttachment();
+    RtpFramePayloads_Ptr payloads_ptr = std::dynamic_pointer_cast<RtpFramePayloads>(attachment_ptr);
+
+    if (payloads_ptr) {
+        return payloads_ptr;
+    }
+    payloads_ptr = PacketizeH264Nalu(nalu, nalu_size);
+    if (attachment_ptr) {
+        //the packet carries another kind of attachment, don't replace it
+        return payloads_ptr;
+    }
+    attachment_ptr = pkt_ptr->SetAttachment(payloads_ptr);
+
+    RtpFramePayloads_Ptr attached_ptr = std::dynamic_pointer_cast<RtpFramePayloads>(attachment_ptr);
+    return attached_ptr ? attached_ptr : payloads_ptr;
+}
+
 std::vector<int> SplitNalu(int payload_len) {
     std::vector<int> payload_sizes;
     size_t payload_left = payload_len;
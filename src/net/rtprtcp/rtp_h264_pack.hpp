@@ -3,6 +3,7 @@
 #include "net/rtprtcp/rtp_packet.hpp"
 #include "format/h264_h265_header.hpp"
 #include "rtp_pack.hpp"
+#include "media_packet.hpp"
 
 #include <vector>
 #include <map>
@@ -48,6 +49,42 @@ std::vector<RtpPacket*> GenerateFuAPackets(uint8_t* data, size_t len, HeaderExte
 
 std::vector<int> SplitNalu(int payload_len);
 
+//one rtp payload of a frame: the fu-a header(if any) and the nalu fragment,
+//which refers to the payload of the media packet.
+class RtpPayloadItem
+{
+public:
+    size_t Length() const { return header_len + len; }
+    void CopyTo(uint8_t* payload) const {
+        memcpy(payload, header, header_len);
+        memcpy(payload + header_len, data, len);
+    }
+
+public:
+    uint8_t header[kFuAHeaderSize];
+    size_t header_len   = 0;
+    const uint8_t* data = nullptr;
+    size_t len          = 0;
+    bool marker         = false;
+};
+
+//the rtp payloads of one h264 frame, packetized once and shared by all the send streams
+//which send the same media packet, each of them only writes the rtp header.
+class RtpFramePayloads : public Media_Packet_Attachment
+{
+public:
+    std::vector<RtpPayloadItem> items_;
+};
+
+typedef std::shared_ptr<RtpFramePayloads> RtpFramePayloads_Ptr;
+
+//single nalu packet or fu-a fragments of the nalu(without start code)
+RtpFramePayloads_Ptr PacketizeH264Nalu(const uint8_t* nalu, size_t nalu_size);
+
+//the payloads attached to the packet, nalu is in the payload of the packet.
+//it's packetized and attached by the first caller.
+RtpFramePayloads_Ptr GetH264FramePayloads(Media_Packet_Ptr pkt_ptr, const uint8_t* nalu, size_t nalu_size);
+
 }
 
 #endif
@@ -7,11 +7,16 @@
 #include <sstream>
 #include <cstring>
 #include <assert.h>
+#include <new>
 
 namespace cpp_streamer
 {
 
 RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len) {
+    return Parse(data, len, nullptr);
+}
+
+RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len, void* storage) {
     RtpCommonHeader* header = (RtpCommonHeader*)data;
     HeaderExtension* ext = nullptr;
     uint8_t* p = (uint8_t*)(header + 1);
@@ -54,6 +59,9 @@ RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len) {
         }
     }
 
+    if (storage) {
+        return new (storage) RtpPacket(header, ext, payload, payload_len, pad_len, len);
+    }
     RtpPacket* pkt = new RtpPacket(header, ext, payload, payload_len, pad_len, len);
 
     return pkt;
@@ -75,7 +83,7 @@ RtpPacket::RtpPacket(RtpCommonHeader* header, HeaderExtension* ext,
 
     this->local_ms    = (int64_t)now_millisec();
 
-    this->ParseExt();
+    this->CheckExt();
     this->need_delete = false;
 }
 
@@ -108,6 +116,23 @@ RtpPacket* RtpPacket::Clone(uint8_t* buffer) {
     
     new_pkt->mid_extension_id_ = this->mid_extension_id_;
     new_pkt->abs_time_extension_id_ = this->abs_time_extension_id_;
+    new_pkt->tcc_extension_id_ = this->tcc_extension_id_;
+
+    return new_pkt;
+}
+
+RtpPacket* RtpPacket::Clone(uint8_t* buffer, void* storage) {
+    assert(this->GetDataLength() <= RTP_PACKET_MAX_SIZE);
+    memcpy(buffer, this->GetData(), this->GetDataLength());
+
+    RtpPacket* new_pkt = RtpPacket::Parse(buffer, this->GetDataLength(), storage);
+
+    new_pkt->need_delete = false;
+    new_pkt->local_ms    = this->local_ms;
+    new_pkt->mid_extension_id_ = this->mid_extension_id_;
+    new_pkt->abs_time_extension_id_ = this->abs_time_extension_id_;
+    new_pkt->tcc_extension_id_ = this->tcc_extension_id_;
+    new_pkt->logger_ = this->logger_;
 
     return new_pkt;
 }
@@ -134,31 +159,26 @@ std::string RtpPacket::Dump() {
     }
 
     if (this->HasExtension()) {
-        if (!this->onebyte_ext_map_.empty()) {
-            ss <<  "  rtp onebyte extension:" << "\r\n";
-            for (auto item : this->onebyte_ext_map_) {
-                OnebyteExtension* item_ext = item.second;
-                ss << "    id:" << (int)item.first << ", length:" << (int)(item_ext->len) << "\r\n";
-                if (item.first == mid_extension_id_) {
-                    std::string mid_str((char*)(item_ext->value), (int)item_ext->len + 1);
-                    ss << "      mid:" << mid_str << "\r\n";
-                } else if (item.first == abs_time_extension_id_) {
-                    uint32_t abs_time_24bits = ByteStream::Read3Bytes(item_ext->value);
-                    double send_ms = abs_time_to_ms(abs_time_24bits);
-                    ss << "      abs time:" << send_ms << "\r\n";
-                }
+        ParseExt();
+        ss << (HasOnebyteExt(this->ext) ? "  rtp onebyte extension:" : "  rtp twobytes extension:") << "\r\n";
+        for (uint8_t i = 0; i < this->ext_count_; i++) {
+            uint8_t id = this->ext_ids_[i];
+            uint8_t len = 0;
+            uint8_t* value = GetExtension(id, len);
+
+            ss << "    id:" << (int)id << ", length:" << (int)len << "\r\n";
+            if (value == nullptr) {
+                continue;
             }
-        }
-
-        if (!this->twobytes_ext_map_.empty()) {
-            ss << "  rtp twobytes extension:" << "\r\n";
-            for ( auto item : this->twobytes_ext_map_) {
-                TwobytesExtension* item_ext = item.second;
-                ss << "    id:" << (int)item.first << ", length:" << (int)item_ext->len << "\r\n";
-                if (item.first == mid_extension_id_) {
-                    std::string mid_str((char*)(item_ext->value), (int)item_ext->len + 1);
-                    ss << "      mid:" << mid_str << "\r\n";
-                }
+            if (id == mid_extension_id_) {
+                std::string mid_str((char*)value, (int)len);
+                ss << "      mid:" << mid_str << "\r\n";
+            } else if ((id == abs_time_extension_id_) && (len >= 3)) {
+                uint32_t abs_time_24bits = ByteStream::Read3Bytes(value);
+                double send_ms = abs_time_to_ms(abs_time_24bits);
+                ss << "      abs time:" << send_ms << "\r\n";
+            } else if ((id == tcc_extension_id_) && (len >= 2)) {
+                ss << "      tcc seq:" << ByteStream::Read2Bytes(value) << "\r\n";
             }
         }
     }
@@ -189,23 +209,58 @@ uint8_t* RtpPacket::GetExtValue(HeaderExtension* rtp_ext) {
     return rtp_ext->value;
 }
 
-void RtpPacket::ParseExt() {
+void RtpPacket::CheckExt() {
     if ((this->header->extension == 0) || (this->ext == nullptr)) {
         return;
     }
 
-    //base on rfc5285
+    //base on rfc5285, the elements are parsed when they are accessed
+    if (!HasOnebyteExt(this->ext) && !HasTwobytesExt(this->ext)) {
+        CSM_THROW_ERROR("the rtp extension id(%02x) error", this->ext->id);
+    }
+}
+
+void RtpPacket::ParseExt() {
+    if (this->ext_parsed_) {
+        return;
+    }
+    this->ext_parsed_ = true;
+
+    if ((this->header->extension == 0) || (this->ext == nullptr)) {
+        return;
+    }
+    //a broken element ends the parsing, the elements before it are kept
     if (HasOnebyteExt(this->ext)) {
         ParseOnebyteExt();
     } else if (HasTwobytesExt(this->ext)) {
         ParseTwobytesExt();
-    } else {
-        CSM_THROW_ERROR("the rtp extension id(%02x) error", this->ext->id);
     }
 }
 
+void RtpPacket::AddExtElement(uint8_t id, uint8_t* element) {
+    if (this->ext_count_ >= RTP_EXT_SLOT_MAX) {
+        return;
+    }
+    this->ext_ids_[this->ext_count_]     = id;
+    this->ext_offsets_[this->ext_count_] = (uint16_t)(element - (uint8_t*)(this->ext));
+    this->ext_count_++;
+    this->ext_bitmap_[id >> 6] |= ((uint64_t)1 << (id & 0x3f));
+}
+
+uint8_t* RtpPacket::FindExtElement(uint8_t id) {
+    ParseExt();
+    if ((this->ext_bitmap_[id >> 6] & ((uint64_t)1 << (id & 0x3f))) == 0) {
+        return nullptr;
+    }
+    for (uint8_t i = 0; i < this->ext_count_; i++) {
+        if (this->ext_ids_[i] == id) {
+            return (uint8_t*)(this->ext) + this->ext_offsets_[i];
+        }
+    }
+    return nullptr;
+}
+
 void RtpPacket::ParseOnebyteExt() {
-    onebyte_ext_map_.clear();
 
     uint8_t* ext_start = (uint8_t*)(this->ext) + 4;//skip id(16bits) + length(16bits)
     uint8_t* ext_end   = ext_start + GetExtLength(this->ext);
@@ -233,12 +288,12 @@ void RtpPacket::ParseOnebyteExt() {
 
         if (id != 0) {
             if (p + 1 + len > ext_end) {
-                CSM_THROW_ERROR("rtp extension length(%d) is not enough in one byte extension mode.",
+                LogWarnf(logger_, "rtp extension length(%d) is not enough in one byte extension mode.",
                     GetExtLength(this->ext));
                 break;
             }
 
-            onebyte_ext_map_[id] = (OnebyteExtension*)p;
+            AddExtElement(id, p);
             p += (1 + len);
         }
         else {
@@ -253,8 +308,6 @@ void RtpPacket::ParseOnebyteExt() {
 }
 
 void RtpPacket::ParseTwobytesExt() {
-    twobytes_ext_map_.clear();
-
     uint8_t* ext_start = (uint8_t*)(this->ext) + 4;//skip id(16bits) + length(16bits)
     uint8_t* ext_end   = ext_start + GetExtLength(this->ext);
     uint8_t* p         = ext_start;
@@ -281,13 +334,13 @@ void RtpPacket::ParseTwobytesExt() {
 
         if (id != 0) {
             if (p + 2 + len > ext_end) {
-                CSM_THROW_ERROR("rtp extension length(%d) is not enough in two bytes extension mode.",
+                LogWarnf(logger_, "rtp extension length(%d) is not enough in two bytes extension mode.",
                     GetExtLength(this->ext));
                 break;
             }
 
-            // Store the Two-Bytes extension element in the map.
-            twobytes_ext_map_[id] = (TwobytesExtension*)p;
+            // Store the Two-Bytes extension element in the table.
+            AddExtElement(id, p);
 
             p += (2 + len);
         } else {
@@ -316,21 +369,19 @@ bool RtpPacket::HasTwobytesExt(HeaderExtension* rtp_ext) {
 }
 
 uint8_t* RtpPacket::GetExtension(uint8_t id, uint8_t& len) {
+    if (this->ext == nullptr) {
+        return nullptr;
+    }
+    uint8_t* element = FindExtElement(id);
+    if (element == nullptr) {
+        return nullptr;
+    }
     if (HasOnebyteExt(this->ext)) {
-        auto iter = onebyte_ext_map_.find(id);
-        if (iter == onebyte_ext_map_.end()) {
-            return nullptr;
-        }
-
-        OnebyteExtension* ext_data = iter->second;
+        OnebyteExtension* ext_data = (OnebyteExtension*)element;
         len = ext_data->len + 1;
         return ext_data->value;
     } else if (HasTwobytesExt(this->ext)) {
-        auto iter = twobytes_ext_map_.find(id);
-        if (iter == twobytes_ext_map_.end()) {
-            return nullptr;
-        }
-        TwobytesExtension* ext_data = iter->second;
+        TwobytesExtension* ext_data = (TwobytesExtension*)element;
         len = ext_data->len;
         if (len == 0) {
             return nullptr;
@@ -408,30 +459,50 @@ bool RtpPacket::UpdateAbsTime(uint32_t abs_time_24bits) {
     return UpdateExtensionLength(abs_time_extension_id_, 3);
 }
 
+bool RtpPacket::ReadTccSeq(uint16_t& tcc_seq) {
+    uint8_t extern_len = 0;
+    uint8_t* extern_value = GetExtension(this->tcc_extension_id_, extern_len);
+
+    if ((extern_value == nullptr) || (extern_len < 2)) {
+        return false;
+    }
+    tcc_seq = ByteStream::Read2Bytes(extern_value);
+
+    return true;
+}
+
+bool RtpPacket::UpdateTccSeq(uint16_t tcc_seq) {
+    uint8_t extern_len = 0;
+    uint8_t* extern_value = GetExtension(this->tcc_extension_id_, extern_len);
+
+    if ((extern_value == nullptr) || (extern_len < 2)) {
+        LogErrorf(logger_, "The rtp packet has not extern tcc id:%d", this->tcc_extension_id_);
+        return false;
+    }
+    ByteStream::Write2Bytes(extern_value, tcc_seq);
+
+    return true;
+}
+
 bool RtpPacket::UpdateExtensionLength(uint8_t id, uint8_t len) {
     if (len == 0) {
         LogErrorf(logger_, "update extension length error: len must not be zero.");
         return false;
     }
+    uint8_t* element = (this->ext == nullptr) ? nullptr : FindExtElement(id);
+    if (element == nullptr) {
+        LogErrorf(logger_, "fail to get id:%d from the ext table.", id);
+        return false;
+    }
     if (HasOnebyteExt(this->ext)) {
-        auto iter = this->onebyte_ext_map_.find(id);
-        if (iter == this->onebyte_ext_map_.end()) {
-            LogErrorf(logger_, "fail to get id:%d from the onebyte ext map.", id);
-            return false;
-        }
-        auto* extension = iter->second;
+        OnebyteExtension* extension = (OnebyteExtension*)element;
         uint8_t current_len = extension->len + 1;
         if (len < current_len) {
             memset(extension->value + len, 0, current_len - len);
         }
         extension->len = len - 1;
     } else if (HasTwobytesExt(this->ext)) {
-        auto iter = this->twobytes_ext_map_.find(id);
-        if (iter == this->twobytes_ext_map_.end()) {
-            LogErrorf(logger_, "fail to get id:%d from the twobytes ext map.", id);
-            return false;
-        }
-        auto* extension = iter->second;
+        TwobytesExtension* extension = (TwobytesExtension*)element;
         uint8_t current_len = extension->len;
         if (len < current_len) {
             memset(extension->value + len, 0, current_len - len);
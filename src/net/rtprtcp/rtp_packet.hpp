@@ -5,13 +5,14 @@
 #include <stddef.h>
 #include <string>
 #include <arpa/inet.h>
-#include <map>
 
 namespace cpp_streamer
 {
 class Logger;
 
 #define RTP_SEQ_MOD (1<<16)
+//max extension elements in the table of one packet, the rest are ignored
+#define RTP_EXT_SLOT_MAX 16
 
 typedef struct HeaderExtensionS
 {
@@ -97,12 +98,19 @@ public:
     void SetAbsTimeExtensionId(uint8_t id) { abs_time_extension_id_ = id; }
     uint8_t GetAbsTimeExtensionId() { return abs_time_extension_id_; }
 
+    void SetTccExtensionId(uint8_t id) { tcc_extension_id_ = id; }
+    uint8_t GetTccExtensionId() { return tcc_extension_id_; }
+
     bool UpdateMid(uint8_t mid);
     bool ReadMid(uint8_t& mid);
 
     bool ReadAbsTime(uint32_t& abs_time_24bits);
     bool UpdateAbsTime(uint32_t abs_time_24bits);
 
+    //transport-wide sequence number
+    bool ReadTccSeq(uint16_t& tcc_seq);
+    bool UpdateTccSeq(uint16_t tcc_seq);
+
     void SetNeedDelete(bool flag) { this->need_delete = flag; }
     bool GetNeedDelete() { return this->need_delete; }
     void EnableDebug() { debug_enable = true; }
@@ -120,11 +128,18 @@ public:
 public:
     static RtpPacket* Parse(uint8_t* data, size_t len);
     RtpPacket* Clone(uint8_t* buffer = nullptr);
+    //construct the packet in the storage(sizeof(RtpPacket)) without allocating,
+    //it's released by ~RtpPacket() instead of delete, see RtpPacketHolder.
+    static RtpPacket* Parse(uint8_t* data, size_t len, void* storage);
+    RtpPacket* Clone(uint8_t* buffer, void* storage);
 
 private:
+    void CheckExt();
     void ParseExt();
     void ParseOnebyteExt();
     void ParseTwobytesExt();
+    void AddExtElement(uint8_t id, uint8_t* element);
+    uint8_t* FindExtElement(uint8_t id);
     uint16_t GetExtId(HeaderExtension* rtp_ext);
     uint16_t GetExtLength(HeaderExtension* rtp_ext);
     uint8_t* GetExtValue(HeaderExtension* rtp_ext);
@@ -149,15 +164,58 @@ private:
 private:
     uint8_t mid_extension_id_      = 0;
     uint8_t abs_time_extension_id_ = 0;
+    uint8_t tcc_extension_id_      = 0;
 
-private:
-    std::map<uint8_t, OnebyteExtension*>  onebyte_ext_map_;
-    std::map<uint8_t, TwobytesExtension*> twobytes_ext_map_;
+private://extension table, it's parsed at the first access of the extensions
+    bool ext_parsed_   = false;
+    uint8_t ext_count_ = 0;
+    uint64_t ext_bitmap_[4] = {0, 0, 0, 0};//bit of the element id
+    uint8_t ext_ids_[RTP_EXT_SLOT_MAX];
+    uint16_t ext_offsets_[RTP_EXT_SLOT_MAX];//element offset from the extension header
 
 private:
     Logger* logger_ = nullptr;
 };
 
+//the rtp packet object in its own storage, eg: on the stack or in a pooled object.
+class RtpPacketHolder
+{
+public:
+    RtpPacketHolder() {
+    }
+    ~RtpPacketHolder() {
+        Reset();
+    }
+
+public:
+    RtpPacket* Parse(uint8_t* data, size_t len) {
+        Reset();
+        pkt_ = RtpPacket::Parse(data, len, storage_);
+        return pkt_;
+    }
+    RtpPacket* Clone(RtpPacket* input_pkt, uint8_t* buffer) {
+        Reset();
+        pkt_ = input_pkt->Clone(buffer, storage_);
+        return pkt_;
+    }
+    RtpPacket* Get() { return pkt_; }
+
+    void Reset() {
+        if (pkt_) {
+            pkt_->~RtpPacket();
+            pkt_ = nullptr;
+        }
+    }
+
+private:
+    RtpPacketHolder(const RtpPacketHolder&) = delete;
+    RtpPacketHolder& operator=(const RtpPacketHolder&) = delete;
+
+private:
+    RtpPacket* pkt_ = nullptr;
+    alignas(RtpPacket) uint8_t storage_[sizeof(RtpPacket)];
+};
+
 }
 
 #endif
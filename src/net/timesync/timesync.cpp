@@ -49,21 +49,47 @@ int TimeSync::RemoveSinker(const std::string& name) {
 }
 
 int TimeSync::SourceData(Media_Packet_Ptr pkt_ptr) {
+    //dts/pts are rewritten, so work on a header copy which shares the payload
     if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
-        HandleVideoPacket(pkt_ptr);
+        HandleVideoPacket(pkt_ptr->shared_copy());
     } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
-        HandleAudioPacket(pkt_ptr);
+        HandleAudioPacket(pkt_ptr->shared_copy());
     }
     return 0;
 }
 
+int TimeSync::SourceBatch(MediaPacketSpan pkts) {
+    batch_mode_ = true;
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        SourceData(pkt_ptr);
+    }
+    batch_mode_ = false;
+
+    FlushBatch();
+    return (int)pkts.size();
+}
+
 void TimeSync::OutputPacket(Media_Packet_Ptr pkt_ptr) {
     //LogInfof(logger_, "output packet:%s", pkt_ptr->Dump().c_str());
-    for (auto sinker : sinkers_) {
+    if (batch_mode_) {
+        batch_pkts_.push_back(pkt_ptr);
+        return;
+    }
+    for (auto& sinker : sinkers_) {
         sinker.second->SourceData(pkt_ptr);
     }
 }
 
+void TimeSync::FlushBatch() {
+    if (batch_pkts_.empty()) {
+        return;
+    }
+    for (auto& sinker : sinkers_) {
+        sinker.second->SourceBatch(batch_pkts_);
+    }
+    batch_pkts_.clear();
+}
+
 void TimeSync::HandleVideoPacket(Media_Packet_Ptr pkt_ptr) {
     int64_t dts = pkt_ptr->dts_;
     int64_t pts = pkt_ptr->pts_;
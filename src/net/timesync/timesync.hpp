@@ -27,11 +27,13 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
 
 private:
     void HandleVideoPacket(Media_Packet_Ptr pkt_ptr);
     void HandleAudioPacket(Media_Packet_Ptr pkt_ptr);
     void OutputPacket(Media_Packet_Ptr pkt_ptr);
+    void FlushBatch();
 
 private:
     int64_t base_video_pkt_dts_ = -1;
@@ -44,6 +46,10 @@ private:
     int64_t base_audio_pkt_dts_ = -1;
     int64_t last_audio_pkt_dts_ = -1;
     int64_t audio_dts_ = -1;
+
+private:
+    bool batch_mode_ = false;
+    std::vector<Media_Packet_Ptr> batch_pkts_;
 };
 
 }
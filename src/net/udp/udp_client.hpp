@@ -13,12 +13,17 @@ public:
     UdpClient(uv_loop_t* loop, UdpSessionCallbackI* cb,
             Logger* logger,
             const char* ipaddr_sz = nullptr,
-            uint16_t port = 0):UdpSessionBase(loop, 
+            uint16_t port = 0,
+            bool batch_mode = false):UdpSessionBase(loop, 
                                             cb, 
                                             logger)
     {
         struct sockaddr_in recv_addr;
-        uv_udp_init(loop, &udp_handle_);
+        if (batch_mode) {
+            uv_udp_init_ex(loop, &udp_handle_, AF_INET | UV_UDP_RECVMMSG);
+        } else {
+            uv_udp_init(loop, &udp_handle_);
+        }
 
         if (ipaddr_sz == nullptr) {
             uv_ip4_addr("0.0.0.0", port, &recv_addr);
@@ -28,6 +33,9 @@ public:
         uv_udp_bind(&udp_handle_, (const struct sockaddr *)&recv_addr, UV_UDP_REUSEADDR);
 
         udp_handle_.data = this;
+        if (batch_mode) {
+            EnableBatchMode();
+        }
     }
     ~UdpClient()
     {
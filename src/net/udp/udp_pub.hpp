@@ -3,25 +3,57 @@
 #include "logger.hpp"
 #include "data_buffer.hpp"
 #include "ipaddress.hpp"
+#include "buffer_pool.hpp"
 #include <sstream>
 #include <memory>
 #include <string>
 #include <stdint.h>
 #include <iostream>
 #include <queue>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <uv.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
 namespace cpp_streamer
 {
 
 #define UDP_DATA_BUFFER_MAX (10*1024)
 
+//batch mode: the datagrams written in one loop iteration are sent by one sendmmsg,
+//and the datagrams are read by recvmmsg into the receive ring.
+#define UDP_SEND_BATCH_MAX     64
+#define UDP_SEND_ARENA_SIZE    (UDP_SEND_BATCH_MAX * 1500)
+#define UDP_RECV_MMSG_SLOTS    16
+#define UDP_RECV_MMSG_SLOT_SIZE (64*1024)//libuv reads one datagram into each 64KB chunk
+
+//udp gso limits of one send buffer
+#define UDP_GSO_SEGMENTS_MAX   64
+#define UDP_GSO_BYTES_MAX      (63*1024)
+#if defined(__linux__)
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+//the send request and its datagram are in one pooled block:
+//[UdpReqInfo][datagram], the block is returned to the pool in the send callback.
 typedef struct UdpReqInfoS
 {
     uv_udp_send_t handle;
     uv_buf_t buf;
     char ip[16];
     uint16_t port;
+    struct sockaddr_in addr;
+    size_t block_size;
 } UdpReqInfo;
 
 class UdpServer;
@@ -35,6 +67,68 @@ inline void UdpReadCallback(uv_udp_t* handle,
                     const struct sockaddr* addr,
                     unsigned flags);
 inline void UdpSendCallback(uv_udp_send_t* req, int status);
+inline void UdpFlushPrepareCallback(uv_prepare_t* handle);
+inline void UdpFlushCheckCallback(uv_check_t* handle);
+inline void UdpFlushHandleCloseCallback(uv_handle_t* handle);
+
+//the recvmmsg receive ring of one loop: the datagrams are read into it and handed
+//to the read callback synchronously before the next read, so all the batch mode
+//sessions in the loop share one ring. it's freed when the last session releases it.
+class UdpRecvRing
+{
+public:
+    static char* Acquire(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetRingsMutex());
+        UdpRecvRing& ring = GetRings()[loop];
+
+        if (!ring.data_) {
+            ring.data_.reset(new char[Size()]);
+        }
+        ring.ref_count_++;
+        return ring.data_.get();
+    }
+
+    static void Release(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetRingsMutex());
+        std::map<uv_loop_t*, UdpRecvRing>& rings = GetRings();
+
+        auto iter = rings.find(loop);
+        if (iter == rings.end()) {
+            return;
+        }
+        if (--iter->second.ref_count_ == 0) {
+            rings.erase(iter);
+        }
+    }
+
+    //the ring bytes of one session in the loop
+    static size_t GetShareSize(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetRingsMutex());
+        std::map<uv_loop_t*, UdpRecvRing>& rings = GetRings();
+
+        auto iter = rings.find(loop);
+        if ((iter == rings.end()) || (iter->second.ref_count_ == 0)) {
+            return 0;
+        }
+        return Size() / iter->second.ref_count_;
+    }
+
+    static size_t Size() { return UDP_RECV_MMSG_SLOTS * UDP_RECV_MMSG_SLOT_SIZE; }
+
+private:
+    static std::mutex& GetRingsMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+    static std::map<uv_loop_t*, UdpRecvRing>& GetRings() {
+        static std::map<uv_loop_t*, UdpRecvRing> s_rings;
+        return s_rings;
+    }
+
+private:
+    std::unique_ptr<char[]> data_;
+    size_t ref_count_ = 0;
+};
 
 class UdpTuple
 {
@@ -79,6 +173,8 @@ friend void UdpReadCallback(uv_udp_t* handle,
                     const struct sockaddr* addr,
                     unsigned flags);
 friend void UdpSendCallback(uv_udp_send_t* req, int status);
+friend void UdpFlushPrepareCallback(uv_prepare_t* handle);
+friend void UdpFlushCheckCallback(uv_check_t* handle);
 
 public:
     UdpSessionBase(uv_loop_t* loop, 
@@ -90,30 +186,310 @@ public:
     }
     ~UdpSessionBase()
     {
+        CancelWrite();
+        if (flush_prepare_) {
+            //the handles are freed in the close callbacks, after the loop is done with them
+            flush_prepare_->data = nullptr;
+            flush_check_->data   = nullptr;
+            uv_close((uv_handle_t*)flush_prepare_, UdpFlushHandleCloseCallback);
+            uv_close((uv_handle_t*)flush_check_, UdpFlushHandleCloseCallback);
+        }
+        if (batch_mode_) {
+            UdpRecvRing::Release(loop_);
+        }
     }
 
 public:
     uv_loop_t* GetLoop() { return loop_; }
+    bool IsBatchMode() { return batch_mode_; }
 
     void Write(const char* data, size_t len, UdpTuple remote_address) {
-        struct sockaddr_in send_addr;
-        UdpReqInfo* req = (UdpReqInfo*)malloc(sizeof(UdpReqInfo));
-        uv_ip4_addr(remote_address.ip_address.c_str(), remote_address.port, &send_addr);
+        char* slot = ReserveWrite(len, remote_address);
+        memcpy(slot, data, len);
+        CommitWrite(len);
+    }
 
-        req->handle.data = this;
+    //reserve a send slot of max_len bytes, the caller builds the datagram in it
+    //(eg: srtp protect in place) and CommitWrite(len) hands it to the udp layer
+    //without copying. the slot is in the send arena in the batch mode, otherwise
+    //it's a pooled block which is returned to the pool when the send completes.
+    //only one slot can be reserved at a time.
+    char* ReserveWrite(size_t max_len, const UdpTuple& remote_address) {
+        CancelWrite();
+        if (!batch_mode_ || (max_len > UDP_SEND_ARENA_SIZE)) {
+            //keep the order of the queued datagrams
+            FlushSend();
+            reserve_req_ = AllocReq(max_len, remote_address);
+            return reserve_req_->buf.base;
+        }
+        if (!send_arena_) {
+            InitBatchSend();
+        }
+        if ((send_count_ >= UDP_SEND_BATCH_MAX) || (send_arena_used_ + max_len > UDP_SEND_ARENA_SIZE)) {
+            FlushSend();
+        }
+        if ((remote_address.port != last_remote_.port) || (remote_address.ip_address != last_remote_.ip_address)) {
+            last_remote_ = remote_address;
+            uv_ip4_addr(remote_address.ip_address.c_str(), remote_address.port, &last_remote_addr_);
+        }
+        return send_arena_.get() + send_arena_used_;
+    }
+
+    //len must not be larger than the reserved max_len
+    void CommitWrite(size_t len) {
+        if (reserve_req_) {
+            UdpReqInfo* req = reserve_req_;
+            reserve_req_ = nullptr;
+            SendReq(req, len);
+            return;
+        }
+        UdpSendItem& item = send_items_[send_count_++];
+        item.addr    = last_remote_addr_;
+        item.tuple   = last_remote_;
+        item.offset  = send_arena_used_;
+        item.len     = len;
+        send_arena_used_ += len;
+
+        if (!flush_started_) {
+            flush_started_ = true;
+            uv_prepare_start(flush_prepare_, UdpFlushPrepareCallback);
+            uv_check_start(flush_check_, UdpFlushCheckCallback);
+        }
+    }
+
+    //drop the reserved slot which is not committed
+    void CancelWrite() {
+        if (reserve_req_) {
+            FreeReq(reserve_req_);
+            reserve_req_ = nullptr;
+        }
+    }
+
+    //send the queued datagrams, it's called once per loop iteration in the batch mode.
+    void FlushSend() {
+        if (send_count_ == 0) {
+            return;
+        }
+        size_t sent = 0;
+#if defined(__linux__)
+        uv_os_fd_t fd;
+        //keep the order if libuv still has datagrams in its queue
+        if ((uv_fileno((uv_handle_t*)&udp_handle_, &fd) == 0) &&
+            (uv_udp_get_send_queue_count(&udp_handle_) == 0)) {
+            sent = SendMmsg(fd, 0, gso_enable_);
+            if ((sent < send_count_) && gso_enable_ &&
+                ((errno == EIO) || (errno == EINVAL) || (errno == EOPNOTSUPP) || (errno == ENOPROTOOPT))) {
+                LogWarnf(logger_, "udp gso is rejected, errno:%d, fall back to sendmmsg", errno);
+                gso_enable_ = false;
+                sent += SendMmsg(fd, sent, false);
+            }
+        }
+#endif
+        //the rest(eg: EAGAIN) goes to the libuv send queue which waits for writable.
+        for (size_t i = sent; i < send_count_; i++) {
+            WriteDirect(send_arena_.get() + send_items_[i].offset, send_items_[i].len, send_items_[i].tuple);
+        }
+        send_count_ = 0;
+        send_arena_used_ = 0;
+    }
+
+    //linux UDP_SEGMENT: the equal sized datagrams for the same destination, which are
+    //back to back in the send arena, are sent as one buffer with the segment size.
+    //it falls back to the plain sendmmsg when the kernel rejects it.
+    void EnableGso(bool enable) {
+#if defined(__linux__)
+        gso_enable_ = enable;
+#endif
+    }
+    bool IsGsoEnable() { return gso_enable_; }
+
+    int64_t GetSendCallCount() { return sendmmsg_count_; }
+    int64_t GetGsoSendCount() { return gso_send_count_; }
+
+    //the receive buffer, or the share of the loop receive ring in the batch mode,
+    //and the send arena after the first batched write
+    size_t GetMemoryUsage() {
+        size_t usage = sizeof(UdpSessionBase);
+
+        if (recv_buffer_) {
+            usage += UDP_DATA_BUFFER_MAX;
+        }
+        if (batch_mode_) {
+            usage += UdpRecvRing::GetShareSize(loop_);
+        }
+        if (send_arena_) {
+            usage += UDP_SEND_ARENA_SIZE + UDP_SEND_BATCH_MAX * sizeof(UdpSendItem);
+            usage += sizeof(uv_prepare_t) + sizeof(uv_check_t);
+        }
+        return usage;
+    }
+
+protected:
+    //call it in the constructor of the derived class after the udp handle is initialized,
+    //the handle should be initialized with UV_UDP_RECVMMSG for batch receiving.
+    void EnableBatchMode() {
+        if (batch_mode_) {
+            return;
+        }
+        batch_mode_ = true;
+        recv_ring_ = UdpRecvRing::Acquire(loop_);
+    }
 
-        char* new_data = (char*)malloc(len);
-        memcpy(new_data, data, len);
-        req->buf = uv_buf_init(new_data, len);
+    //the send arena and the flush handles are allocated at the first batched write,
+    //the session which only receives does not pay for them.
+    void InitBatchSend() {
+        send_arena_.reset(new char[UDP_SEND_ARENA_SIZE]);
+        send_items_.reset(new UdpSendItem[UDP_SEND_BATCH_MAX]);
+
+        flush_prepare_ = new uv_prepare_t;
+        uv_prepare_init(loop_, flush_prepare_);
+        flush_prepare_->data = this;
+        flush_check_ = new uv_check_t;
+        uv_check_init(loop_, flush_check_);
+        flush_check_->data = this;
+    }
+
+#if defined(__linux__)
+    //send the queued items from the start index, return the count of the items sent.
+    size_t SendMmsg(uv_os_fd_t fd, size_t start, bool gso) {
+        struct mmsghdr msgs[UDP_SEND_BATCH_MAX];
+        struct iovec iovs[UDP_SEND_BATCH_MAX];
+        size_t msg_items[UDP_SEND_BATCH_MAX];
+        char cmsg_bufs[UDP_SEND_BATCH_MAX][CMSG_SPACE(sizeof(uint16_t))];
+        size_t msg_count = 0;
+
+        for (size_t i = start; i < send_count_; msg_count++) {
+            size_t count = gso ? GetGsoCount(i) : 1;
+            size_t len = 0;
+            for (size_t j = i; j < i + count; j++) {
+                len += send_items_[j].len;
+            }
+            struct mmsghdr& msg = msgs[msg_count];
+
+            memset(&msg, 0, sizeof(msg));
+            iovs[msg_count].iov_base = send_arena_.get() + send_items_[i].offset;
+            iovs[msg_count].iov_len  = len;
+            msg.msg_hdr.msg_name    = &send_items_[i].addr;
+            msg.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            msg.msg_hdr.msg_iov     = &iovs[msg_count];
+            msg.msg_hdr.msg_iovlen  = 1;
+            if (count > 1) {
+                msg.msg_hdr.msg_control    = cmsg_bufs[msg_count];
+                msg.msg_hdr.msg_controllen = sizeof(cmsg_bufs[msg_count]);
+
+                struct cmsghdr* cm = CMSG_FIRSTHDR(&msg.msg_hdr);
+                uint16_t segment_size = (uint16_t)send_items_[i].len;
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type  = UDP_SEGMENT;
+                cm->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+                memcpy(CMSG_DATA(cm), &segment_size, sizeof(segment_size));
+                gso_send_count_++;
+            }
+            msg_items[msg_count] = count;
+            i += count;
+        }
+
+        size_t sent_items = 0;
+        size_t sent_msgs  = 0;
+        while (sent_msgs < msg_count) {
+            int ret = sendmmsg(fd, msgs + sent_msgs, msg_count - sent_msgs, 0);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            for (size_t m = sent_msgs; m < sent_msgs + ret; m++) {
+                if (cb_) {
+                    for (size_t i = start + sent_items; i < start + sent_items + msg_items[m]; i++) {
+                        cb_->OnWrite(send_items_[i].len, send_items_[i].tuple);
+                    }
+                }
+                sent_items += msg_items[m];
+            }
+            sent_msgs += ret;
+            sendmmsg_count_++;
+        }
+        return sent_items;
+    }
+
+    //count of the items from the index which can be sent as one gso buffer:
+    //same destination, same size, and only the last one may be shorter.
+    size_t GetGsoCount(size_t index) {
+        UdpSendItem& first = send_items_[index];
+        size_t total = first.len;
+        size_t count = 1;
+
+        if (first.len == 0) {
+            return count;
+        }
+        while ((index + count < send_count_) && (count < UDP_GSO_SEGMENTS_MAX)) {
+            UdpSendItem& next = send_items_[index + count];
+            if ((next.addr.sin_addr.s_addr != first.addr.sin_addr.s_addr) ||
+                (next.addr.sin_port != first.addr.sin_port)) {
+                break;
+            }
+            if ((next.len > first.len) || (total + next.len > UDP_GSO_BYTES_MAX)) {
+                break;
+            }
+            total += next.len;
+            count++;
+            if (next.len < first.len) {
+                break;
+            }
+        }
+        return count;
+    }
+#endif
+
+    void OnFlush() {
+        FlushSend();
+        if (send_count_ == 0) {
+            flush_started_ = false;
+            uv_prepare_stop(flush_prepare_);
+            uv_check_stop(flush_check_);
+        }
+    }
+
+    void WriteDirect(const char* data, size_t len, const UdpTuple& remote_address) {
+        UdpReqInfo* req = AllocReq(len, remote_address);
+
+        memcpy(req->buf.base, data, len);
+        SendReq(req, len);
+    }
+
+    UdpReqInfo* AllocReq(size_t len, const UdpTuple& remote_address) {
+        size_t block_size = 0;
+        char* block = BufferPool::Malloc(sizeof(UdpReqInfo) + len, block_size);
+        UdpReqInfo* req = (UdpReqInfo*)block;
+
+        req->handle.data = this;
+        req->block_size  = block_size;
+        req->buf = uv_buf_init(block + sizeof(UdpReqInfo), len);
 
         memset(req->ip, 0, sizeof(req->ip));
-        memcpy(req->ip, remote_address.ip_address.c_str(), remote_address.ip_address.size());
+        memcpy(req->ip, remote_address.ip_address.c_str(),
+            std::min(remote_address.ip_address.size(), sizeof(req->ip) - 1));
         req->port = remote_address.port;
+        uv_ip4_addr(req->ip, req->port, &req->addr);
+        return req;
+    }
+
+    void FreeReq(UdpReqInfo* req) {
+        BufferPool::Free((char*)req, req->block_size);
+    }
 
-        uv_udp_send((uv_udp_send_t*)req, &udp_handle_, &req->buf, 1,
-                (const struct sockaddr *)&send_addr, UdpSendCallback);
+    void SendReq(UdpReqInfo* req, size_t len) {
+        req->buf.len = len;
+        int ret = uv_udp_send((uv_udp_send_t*)req, &udp_handle_, &req->buf, 1,
+                (const struct sockaddr *)&req->addr, UdpSendCallback);
+        if (ret != 0) {
+            LogErrorf(logger_, "uv_udp_send error:%d", ret);
+            FreeReq(req);
+        }
     }
 
+public:
     void TryRead() {
         int ret = 0;
         ret = uv_udp_recv_start(&udp_handle_, UdpAllocCallback, UdpReadCallback);
@@ -129,7 +505,15 @@ public:
 
 protected:
     void OnAlloc(uv_buf_t* buf) {
-        buf->base = recv_buffer_;
+        if (recv_ring_) {
+            buf->base = recv_ring_;
+            buf->len  = UdpRecvRing::Size();
+            return;
+        }
+        if (!recv_buffer_) {
+            recv_buffer_.reset(new char[UDP_DATA_BUFFER_MAX]);
+        }
+        buf->base = recv_buffer_.get();
         buf->len  = UDP_DATA_BUFFER_MAX;
     }
 
@@ -138,6 +522,10 @@ protected:
             const uv_buf_t* buf,
             const struct sockaddr* addr,
             unsigned flags) {
+        if (flags & UV_UDP_MMSG_FREE) {
+            //the end of one recvmmsg, the receive ring is owned by the loop
+            return;
+        }
         if (cb_) {
             if (nread > 0) {
                 uint16_t remote_port = 0;
@@ -157,13 +545,7 @@ protected:
             if (cb_) {
                 cb_->OnWrite(0, addr);
             }
-            UdpReqInfo* wr = (UdpReqInfo*)req;
-            if (wr) {
-                if (wr->buf.base) {
-                    free(wr->buf.base);
-                }
-                free(wr);
-            }
+            FreeReq((UdpReqInfo*)req);
             return;
         }
         
@@ -173,12 +555,7 @@ protected:
             addr.port       = wr->port;
             cb_->OnWrite(wr->buf.len, addr);
         }
-        if (wr) {
-            if (wr->buf.base) {
-                free(wr->buf.base);
-            }
-            free(wr);
-        }
+        FreeReq(wr);
     }
 
 protected:
@@ -186,9 +563,34 @@ protected:
     UdpSessionCallbackI* cb_ = nullptr;
     Logger* logger_          = nullptr;
     uv_udp_t udp_handle_;
+    UdpReqInfo* reserve_req_ = nullptr;
 
 protected:
-    char recv_buffer_[UDP_DATA_BUFFER_MAX];
+    std::unique_ptr<char[]> recv_buffer_;//allocated at the first read without the receive ring
+
+protected://batch mode
+    class UdpSendItem
+    {
+    public:
+        struct sockaddr_in addr;
+        UdpTuple tuple;
+        size_t offset = 0;
+        size_t len    = 0;
+    };
+    bool batch_mode_    = false;
+    bool flush_started_ = false;
+    uv_prepare_t* flush_prepare_ = nullptr;//flush the writes of timers before polling
+    uv_check_t* flush_check_     = nullptr;//flush the writes of io callbacks after polling
+    char* recv_ring_             = nullptr;//the receive ring of the loop
+    std::unique_ptr<char[]> send_arena_;
+    size_t send_arena_used_ = 0;
+    std::unique_ptr<UdpSendItem[]> send_items_;
+    size_t send_count_ = 0;
+    UdpTuple last_remote_;
+    struct sockaddr_in last_remote_addr_;
+    int64_t sendmmsg_count_ = 0;
+    bool gso_enable_ = false;
+    int64_t gso_send_count_ = 0;
 };
 
 inline void UdpAllocCallback(uv_handle_t* handle,
@@ -218,6 +620,28 @@ inline void UdpSendCallback(uv_udp_send_t* req, int status) {
     }
 }
 
+inline void UdpFlushPrepareCallback(uv_prepare_t* handle) {
+    UdpSessionBase* session = (UdpSessionBase*)handle->data;
+    if (session) {
+        session->OnFlush();
+    }
+}
+
+inline void UdpFlushCheckCallback(uv_check_t* handle) {
+    UdpSessionBase* session = (UdpSessionBase*)handle->data;
+    if (session) {
+        session->OnFlush();
+    }
+}
+
+inline void UdpFlushHandleCloseCallback(uv_handle_t* handle) {
+    if (handle->type == UV_PREPARE) {
+        delete (uv_prepare_t*)handle;
+    } else {
+        delete (uv_check_t*)handle;
+    }
+}
+
 }
 
 #endif //UDP_PUB_HPP
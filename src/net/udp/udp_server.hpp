@@ -11,15 +11,23 @@ public:
     UdpServer(uv_loop_t* loop, 
             uint16_t port, 
             UdpSessionCallbackI* cb, 
-            Logger* logger):UdpSessionBase(loop, 
+            Logger* logger,
+            bool batch_mode = false):UdpSessionBase(loop, 
                                         cb, 
                                         logger)
     {
-        uv_udp_init(loop, &udp_handle_);
+        if (batch_mode) {
+            uv_udp_init_ex(loop, &udp_handle_, AF_INET | UV_UDP_RECVMMSG);
+        } else {
+            uv_udp_init(loop, &udp_handle_);
+        }
         struct sockaddr_in recv_addr;
         uv_ip4_addr("0.0.0.0", port, &recv_addr);
         uv_udp_bind(&udp_handle_, (const struct sockaddr *)&recv_addr, UV_UDP_REUSEADDR);
         udp_handle_.data = this;
+        if (batch_mode) {
+            EnableBatchMode();
+        }
 
         TryRead();
     }
@@ -0,0 +1,305 @@
+#include "delay_based_bwe.hpp"
+
+#include <cmath>
+
+namespace cpp_streamer
+{
+
+DelayBasedBwe::DelayBasedBwe(Logger* logger):logger_(logger)
+{
+}
+
+DelayBasedBwe::~DelayBasedBwe()
+{
+}
+
+void DelayBasedBwe::SetBitrates(int64_t min_bps, int64_t start_bps, int64_t max_bps) {
+    min_bps_     = min_bps;
+    max_bps_     = max_bps;
+    bitrate_bps_ = ClampBitrate(start_bps);
+}
+
+int64_t DelayBasedBwe::ClampBitrate(int64_t bps) {
+    if (bps < min_bps_) {
+        return min_bps_;
+    }
+    if (bps > max_bps_) {
+        return max_bps_;
+    }
+    return bps;
+}
+
+void DelayBasedBwe::StartGroup(int64_t send_us, int64_t arrival_us, size_t len) {
+    current_group_.first_send_us    = send_us;
+    current_group_.last_send_us     = send_us;
+    current_group_.first_arrival_us = arrival_us;
+    current_group_.last_arrival_us  = arrival_us;
+    current_group_.size = len;
+}
+
+void DelayBasedBwe::OnPacket(int64_t send_us, int64_t arrival_us, size_t len, int64_t now_ms) {
+    UpdateIncomingBitrate(len, arrival_us / 1000);
+
+    if (!current_group_.IsValid()) {
+        StartGroup(send_us, arrival_us, len);
+        return;
+    }
+    //the reordered packet of the previous group
+    if (send_us < current_group_.first_send_us) {
+        return;
+    }
+    if (send_us - current_group_.first_send_us <= BWE_BURST_US) {
+        if (send_us > current_group_.last_send_us) {
+            current_group_.last_send_us = send_us;
+        }
+        if (arrival_us > current_group_.last_arrival_us) {
+            current_group_.last_arrival_us = arrival_us;
+        }
+        current_group_.size += len;
+        return;
+    }
+
+    //a new group starts, the delta between the last two complete groups
+    if (prev_group_.IsValid()) {
+        double send_delta_ms    = (double)(current_group_.last_send_us - prev_group_.last_send_us) / 1000.0;
+        double arrival_delta_ms = (double)(current_group_.last_arrival_us - prev_group_.last_arrival_us) / 1000.0;
+
+        if (arrival_delta_ms >= 0.0) {
+            OnGroupDelta(send_delta_ms, arrival_delta_ms, current_group_.last_arrival_us / 1000, now_ms);
+        } else {
+            //the arrival time goes backward, eg: the remote clock is reset
+            LogWarnf(logger_, "bwe arrival time goes backward:%.2f ms, reset the trendline", arrival_delta_ms);
+            ResetTrendline();
+        }
+    }
+    prev_group_ = current_group_;
+    StartGroup(send_us, arrival_us, len);
+}
+
+void DelayBasedBwe::ResetTrendline() {
+    trend_samples_.clear();
+    first_arrival_ms_     = -1;
+    num_deltas_           = 0;
+    accumulated_delay_ms_ = 0.0;
+    smoothed_delay_ms_    = 0.0;
+}
+
+void DelayBasedBwe::OnGroupDelta(double send_delta_ms, double arrival_delta_ms, int64_t arrival_ms, int64_t now_ms) {
+    double delay_delta_ms = arrival_delta_ms - send_delta_ms;
+
+    num_deltas_++;
+    if (num_deltas_ > 1000) {
+        num_deltas_ = 1000;
+    }
+    if (first_arrival_ms_ < 0) {
+        first_arrival_ms_ = arrival_ms;
+    }
+    accumulated_delay_ms_ += delay_delta_ms;
+    smoothed_delay_ms_ = BWE_TRENDLINE_SMOOTH * smoothed_delay_ms_ +
+                        (1.0 - BWE_TRENDLINE_SMOOTH) * accumulated_delay_ms_;
+
+    TrendSample sample;
+    sample.arrival_ms        = (double)(arrival_ms - first_arrival_ms_);
+    sample.smoothed_delay_ms = smoothed_delay_ms_;
+    trend_samples_.push_back(sample);
+    if (trend_samples_.size() > BWE_TRENDLINE_WINDOW) {
+        trend_samples_.pop_front();
+    }
+
+    //the slope of the linear regression of the smoothed delay by the arrival time
+    double trend = prev_trend_;
+    if (trend_samples_.size() == BWE_TRENDLINE_WINDOW) {
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        for (const TrendSample& item : trend_samples_) {
+            sum_x += item.arrival_ms;
+            sum_y += item.smoothed_delay_ms;
+        }
+        double avg_x = sum_x / trend_samples_.size();
+        double avg_y = sum_y / trend_samples_.size();
+        double numerator   = 0.0;
+        double denominator = 0.0;
+        for (const TrendSample& item : trend_samples_) {
+            numerator   += (item.arrival_ms - avg_x) * (item.smoothed_delay_ms - avg_y);
+            denominator += (item.arrival_ms - avg_x) * (item.arrival_ms - avg_x);
+        }
+        if (denominator != 0.0) {
+            trend = numerator / denominator;
+        }
+    }
+    DetectUsage(trend, send_delta_ms, now_ms);
+}
+
+void DelayBasedBwe::DetectUsage(double trend, double ts_delta_ms, int64_t now_ms) {
+    double deltas = (num_deltas_ < 60) ? (double)num_deltas_ : 60.0;
+    double modified_trend = deltas * trend * BWE_TRENDLINE_GAIN;
+
+    trend_ = modified_trend;
+    if (modified_trend > threshold_) {
+        if (time_over_using_ms_ < 0) {
+            time_over_using_ms_ = ts_delta_ms / 2;
+        } else {
+            time_over_using_ms_ += ts_delta_ms;
+        }
+        overuse_counter_++;
+        //overuse lasts more than 10ms and the delay keeps increasing
+        if ((time_over_using_ms_ > 10.0) && (overuse_counter_ > 1) && (trend >= prev_trend_)) {
+            time_over_using_ms_ = 0;
+            overuse_counter_    = 0;
+            usage_              = BWE_OVERUSE;
+        }
+    } else if (modified_trend < -threshold_) {
+        time_over_using_ms_ = -1;
+        overuse_counter_    = 0;
+        usage_              = BWE_UNDERUSE;
+    } else {
+        time_over_using_ms_ = -1;
+        overuse_counter_    = 0;
+        usage_              = BWE_NORMAL;
+    }
+    prev_trend_ = trend;
+    UpdateThreshold(modified_trend, now_ms);
+}
+
+//the adaptive threshold follows the trend slowly when it's in the threshold,
+//and a sudden peak(eg: the wifi burst) is not followed.
+void DelayBasedBwe::UpdateThreshold(double trend, int64_t now_ms) {
+    if (last_threshold_ms_ < 0) {
+        last_threshold_ms_ = now_ms;
+    }
+    double abs_trend = std::fabs(trend);
+    if (abs_trend > threshold_ + 15.0) {
+        last_threshold_ms_ = now_ms;
+        return;
+    }
+    double k = (abs_trend < threshold_) ? 0.039 : 0.0087;
+    int64_t delta_ms = now_ms - last_threshold_ms_;
+    if (delta_ms > 100) {
+        delta_ms = 100;
+    }
+    threshold_ += k * (abs_trend - threshold_) * delta_ms;
+    if (threshold_ < 6.0) {
+        threshold_ = 6.0;
+    } else if (threshold_ > 600.0) {
+        threshold_ = 600.0;
+    }
+    last_threshold_ms_ = now_ms;
+}
+
+void DelayBasedBwe::UpdateIncomingBitrate(size_t len, int64_t arrival_ms) {
+    if (incoming_window_ms_ < 0) {
+        incoming_window_ms_    = arrival_ms;
+        incoming_window_bytes_ = 0;
+    }
+    incoming_window_bytes_ += (int64_t)len;
+
+    int64_t window_ms = arrival_ms - incoming_window_ms_;
+    if (window_ms < BWE_ACKED_WINDOW_MS) {
+        if (window_ms < 0) {
+            incoming_window_ms_    = arrival_ms;
+            incoming_window_bytes_ = (int64_t)len;
+        }
+        return;
+    }
+    int64_t sample_bps = incoming_window_bytes_ * 8 * 1000 / window_ms;
+    if (incoming_bps_ == 0) {
+        incoming_bps_ = sample_bps;
+    } else {
+        incoming_bps_ = (incoming_bps_ * 7 + sample_bps * 3) / 10;
+    }
+    incoming_window_ms_    = arrival_ms;
+    incoming_window_bytes_ = 0;
+}
+
+void DelayBasedBwe::Update(int64_t now_ms) {
+    if (last_rate_update_ms_ < 0) {
+        last_rate_update_ms_ = now_ms;
+    }
+    int64_t delta_ms = now_ms - last_rate_update_ms_;
+    if (delta_ms > 1000) {
+        delta_ms = 1000;
+    }
+    last_rate_update_ms_ = now_ms;
+
+    //the estimate starts from the incoming bitrate if no congestion in the first seconds
+    if (!bitrate_initialized_ && (incoming_bps_ > 0)) {
+        if (first_incoming_ms_ < 0) {
+            first_incoming_ms_ = now_ms;
+        } else if (now_ms - first_incoming_ms_ > BWE_INIT_MS) {
+            if (incoming_bps_ > bitrate_bps_) {
+                bitrate_bps_ = ClampBitrate(incoming_bps_);
+            }
+            bitrate_initialized_ = true;
+        }
+    }
+
+    switch (usage_) {
+        case BWE_OVERUSE:
+        {
+            rate_state_ = BWE_RATE_DECREASE;
+            break;
+        }
+        case BWE_UNDERUSE:
+        {
+            //the queues are draining
+            rate_state_ = BWE_RATE_HOLD;
+            break;
+        }
+        default:
+        {
+            if (rate_state_ != BWE_RATE_INCREASE) {
+                rate_state_ = BWE_RATE_INCREASE;
+                return;
+            }
+            break;
+        }
+    }
+
+    if (rate_state_ == BWE_RATE_DECREASE) {
+        //decrease once in a rtt
+        if ((last_decrease_ms_ > 0) && (now_ms - last_decrease_ms_ < rtt_ms_)) {
+            return;
+        }
+        int64_t base_bps = (incoming_bps_ > 0) ? incoming_bps_ : bitrate_bps_;
+        int64_t new_bps  = base_bps * 85 / 100;
+        if (new_bps < bitrate_bps_) {
+            bitrate_bps_ = ClampBitrate(new_bps);
+        }
+        decrease_bps_        = bitrate_bps_;
+        last_decrease_ms_    = now_ms;
+        bitrate_initialized_ = true;
+        rate_state_          = BWE_RATE_HOLD;
+        usage_               = BWE_NORMAL;
+        return;
+    }
+    if (rate_state_ != BWE_RATE_INCREASE) {
+        return;
+    }
+
+    //it's not increased far over the incoming bitrate
+    if ((incoming_bps_ > 0) && (bitrate_bps_ > incoming_bps_ * 3 / 2 + 10000)) {
+        return;
+    }
+    bool near_max = (decrease_bps_ > 0) &&
+                (bitrate_bps_ < decrease_bps_ * 115 / 100) &&
+                (bitrate_bps_ > decrease_bps_ * 85 / 100);
+    if (near_max) {
+        //additive increase: about one packet per response time
+        double response_ms = (double)(rtt_ms_ + 100);
+        double increase_bps = 1200.0 * 8.0 * 1000.0 / response_ms * delta_ms / 1000.0;
+        if (increase_bps < 1000.0) {
+            increase_bps = 1000.0;
+        }
+        bitrate_bps_ = ClampBitrate(bitrate_bps_ + (int64_t)increase_bps);
+    } else {
+        //multiplicative increase: 8% per second
+        double factor = std::pow(1.08, (double)delta_ms / 1000.0);
+        int64_t increase_bps = (int64_t)((factor - 1.0) * bitrate_bps_);
+        if (increase_bps < 1000) {
+            increase_bps = 1000;
+        }
+        bitrate_bps_ = ClampBitrate(bitrate_bps_ + increase_bps);
+    }
+}
+
+}
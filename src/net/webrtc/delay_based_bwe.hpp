@@ -0,0 +1,154 @@
+#ifndef DELAY_BASED_BWE_HPP
+#define DELAY_BASED_BWE_HPP
+#include "logger.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+
+namespace cpp_streamer
+{
+
+#define BWE_MIN_KBPS          100
+#define BWE_START_KBPS        1000
+#define BWE_MAX_KBPS          (20*1000)
+
+//the packets sent in the burst time are in the same group
+#define BWE_BURST_US          5000
+//trendline filter of the delay variation
+#define BWE_TRENDLINE_WINDOW  20
+#define BWE_TRENDLINE_SMOOTH  0.9
+#define BWE_TRENDLINE_GAIN    4.0
+//the incoming(acked) bitrate window
+#define BWE_ACKED_WINDOW_MS   500
+//the incoming bitrate is taken as the estimate if it's higher after the time
+#define BWE_INIT_MS           5000
+
+typedef enum
+{
+    BWE_NORMAL,
+    BWE_UNDERUSE,
+    BWE_OVERUSE
+} BWE_USAGE;
+
+typedef enum
+{
+    BWE_RATE_HOLD,
+    BWE_RATE_INCREASE,
+    BWE_RATE_DECREASE
+} BWE_RATE_STATE;
+
+inline const char* BweUsageString(BWE_USAGE usage) {
+    switch (usage) {
+        case BWE_UNDERUSE: return "underuse";
+        case BWE_OVERUSE:  return "overuse";
+        default:           return "normal";
+    }
+}
+
+//delay based bandwidth estimation by the send time and the arrival time of
+//the packets: trendline filter of the one way delay variation between the
+//packet groups, adaptive overuse detector and aimd rate control.
+//the send side feeds it by transport-cc feedback, the receive side by
+//abs-send-time.
+class DelayBasedBwe
+{
+public:
+    DelayBasedBwe(Logger* logger);
+    ~DelayBasedBwe();
+
+public:
+    void SetBitrates(int64_t min_bps, int64_t start_bps, int64_t max_bps);
+    void UpdateRtt(int64_t rtt_ms) {
+        if (rtt_ms > 0) {
+            rtt_ms_ = rtt_ms;
+        }
+    }
+
+    //the packets are input in the send order
+    void OnPacket(int64_t send_us, int64_t arrival_us, size_t len, int64_t now_ms);
+    //aimd rate control by the detected usage
+    void Update(int64_t now_ms);
+
+public:
+    int64_t GetBitrate() { return bitrate_bps_; }
+    int64_t GetIncomingBitrate() { return incoming_bps_; }
+    int64_t GetRttMs() { return rtt_ms_; }
+    BWE_USAGE GetUsage() { return usage_; }
+    double GetTrend() { return trend_; }
+    double GetThreshold() { return threshold_; }
+
+private:
+    class PacketGroup
+    {
+    public:
+        bool IsValid() { return first_send_us >= 0; }
+
+    public:
+        int64_t first_send_us    = -1;
+        int64_t last_send_us     = -1;
+        int64_t first_arrival_us = -1;
+        int64_t last_arrival_us  = -1;
+        size_t size = 0;
+    };
+
+    class TrendSample
+    {
+    public:
+        double arrival_ms;
+        double smoothed_delay_ms;
+    };
+
+private:
+    void StartGroup(int64_t send_us, int64_t arrival_us, size_t len);
+    void OnGroupDelta(double send_delta_ms, double arrival_delta_ms, int64_t arrival_ms, int64_t now_ms);
+    void ResetTrendline();
+    void DetectUsage(double trend, double ts_delta_ms, int64_t now_ms);
+    void UpdateThreshold(double trend, int64_t now_ms);
+    void UpdateIncomingBitrate(size_t len, int64_t arrival_ms);
+    int64_t ClampBitrate(int64_t bps);
+
+private:
+    Logger* logger_ = nullptr;
+
+private:
+    int64_t min_bps_     = BWE_MIN_KBPS * 1000;
+    int64_t max_bps_     = BWE_MAX_KBPS * 1000;
+    int64_t bitrate_bps_ = BWE_START_KBPS * 1000;
+    int64_t rtt_ms_      = 200;
+
+private://packet groups and trendline
+    PacketGroup current_group_;
+    PacketGroup prev_group_;
+    std::deque<TrendSample> trend_samples_;
+    int64_t first_arrival_ms_    = -1;
+    int64_t num_deltas_          = 0;
+    double accumulated_delay_ms_ = 0.0;
+    double smoothed_delay_ms_    = 0.0;
+    double trend_                = 0.0;
+    double prev_trend_           = 0.0;
+
+private://overuse detector
+    BWE_USAGE usage_           = BWE_NORMAL;
+    double threshold_          = 12.5;
+    int64_t last_threshold_ms_ = -1;
+    double time_over_using_ms_ = -1.0;
+    int overuse_counter_       = 0;
+
+private://aimd rate control
+    BWE_RATE_STATE rate_state_   = BWE_RATE_HOLD;
+    int64_t last_rate_update_ms_ = -1;
+    int64_t last_decrease_ms_    = -1;
+    int64_t decrease_bps_        = -1;//the bitrate when the last decrease happens
+    bool bitrate_initialized_    = false;
+    int64_t first_incoming_ms_   = -1;
+
+private://incoming bitrate
+    int64_t incoming_bps_          = 0;
+    int64_t incoming_window_ms_    = -1;
+    int64_t incoming_window_bytes_ = 0;
+};
+
+}
+
+#endif
@@ -11,10 +11,12 @@
 
 namespace cpp_streamer
 {
+//offered in the order of preference: the AEAD GCM profiles cost much less cpu
+//than AES-CM + HMAC-SHA1 per packet on the machines with AES-NI.
 std::vector<srtp_crypto_suite_map> srtp_crypto_suite_vec =
 {
-    { AEAD_AES_256_GCM, "SRTP_AEAD_AES_256_GCM" },
     { AEAD_AES_128_GCM, "SRTP_AEAD_AES_128_GCM" },
+    { AEAD_AES_256_GCM, "SRTP_AEAD_AES_256_GCM" },
     { AES_CM_128_HMAC_SHA1_80, "SRTP_AES128_CM_SHA1_80" },
     { AES_CM_128_HMAC_SHA1_32, "SRTP_AES128_CM_SHA1_32" }
 };
@@ -39,8 +41,8 @@ std::map<finger_print_algorithm_enum, std::string> finger_print_algorithm2String
 
 std::vector<SRTP_CRYPTO_SUITE_ENTRY> srtp_crypto_suites =
 {
-    { CRYPTO_SUITE_AEAD_AES_256_GCM, "SRTP_AEAD_AES_256_GCM" },
     { CRYPTO_SUITE_AEAD_AES_128_GCM, "SRTP_AEAD_AES_128_GCM" },
+    { CRYPTO_SUITE_AEAD_AES_256_GCM, "SRTP_AEAD_AES_256_GCM" },
     { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80, "SRTP_AES128_CM_SHA1_80" },
     { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_32, "SRTP_AES128_CM_SHA1_32" }
 };
@@ -492,10 +494,15 @@ int RtcDtls::InitContext() {
     SSL_CTX_set_verify_depth(ctx_, 4);
     /* Whether we should read as many input bytes as possible (for non-blocking reads) or not. */
     SSL_CTX_set_read_ahead(ctx_, 1);
-    /* Only support SRTP_AES128_CM_SHA1_80, please read ssl/d1_srtp.c */
-    if (SSL_CTX_set_tlsext_use_srtp(ctx_, "SRTP_AES128_CM_SHA1_80")) {
-        LogErrorf(logger_, "DTLS: SSL_CTX_set_tlsext_use_srtp failed");
-        return -1;
+    /* Offer the AEAD GCM profiles first, fall back to SRTP_AES128_CM_SHA1_80
+     * if the openssl does not know them, please read ssl/d1_srtp.c */
+    if (SSL_CTX_set_tlsext_use_srtp(ctx_, srtp_ciphers_.c_str())) {
+        LogWarnf(logger_, "DTLS: SSL_CTX_set_tlsext_use_srtp(%s) failed, use SRTP_AES128_CM_SHA1_80",
+                srtp_ciphers_.c_str());
+        if (SSL_CTX_set_tlsext_use_srtp(ctx_, "SRTP_AES128_CM_SHA1_80")) {
+            LogErrorf(logger_, "DTLS: SSL_CTX_set_tlsext_use_srtp failed");
+            return -1;
+        }
     }
 
     /* The dtls should not be created unless the dtls_ctx has been initialized. */
@@ -647,11 +654,32 @@ void RtcDtls::OnDtlsData(uint8_t* buf, int size) {
         return;
     }
 
-    SetupSRtp(CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80);
+    CRYPTO_SUITE_ENUM srtp_suite = GetSelectedSrtpSuite();
+    if (srtp_suite == CRYPTO_SUITE_NONE) {
+        LogErrorf(logger_, "DTLS: no srtp profile is negotiated");
+        return;
+    }
+    SetupSRtp(srtp_suite);
 
     return;
 }
 
+CRYPTO_SUITE_ENUM RtcDtls::GetSelectedSrtpSuite() {
+    SRTP_PROTECTION_PROFILE* profile = SSL_get_selected_srtp_profile(dtls_);
+    if (!profile || !profile->name) {
+        return CRYPTO_SUITE_NONE;
+    }
+
+    for (auto& item : srtp_crypto_suites) {
+        if (strcmp(item.name, profile->name) == 0) {
+            LogInfof(logger_, "DTLS: selected srtp profile:%s", profile->name);
+            return item.crypto_suite;
+        }
+    }
+    LogErrorf(logger_, "DTLS: unsupported srtp profile:%s", profile->name);
+    return CRYPTO_SUITE_NONE;
+}
+
 int RtcDtls::OnWrite(uint8_t* data, int size) {
 
     if (udp_client_ == nullptr) {
@@ -201,6 +201,7 @@ private:
     int GenPrivateCert();
     int InitContext();
     int SetupSRtp(CRYPTO_SUITE_ENUM crypto_suite = CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80);
+    CRYPTO_SUITE_ENUM GetSelectedSrtpSuite();
 };
 
 }
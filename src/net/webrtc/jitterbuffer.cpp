@@ -7,40 +7,31 @@ namespace cpp_streamer
 JitterBuffer::JitterBuffer(MEDIA_PKT_TYPE type,
         JitterBufferCallbackI* cb, 
         uv_loop_t* loop, 
-        Logger* logger):TimerInterface(loop, 100)
+        Logger* logger):TimerInterface(loop, JITTER_BUFFER_TIMER_MS)
                        , logger_(logger)
                        , cb_(cb) 
                        , media_type_(type){
-    for (size_t i = 0; i < BUFFER_POOL_SIZE; i++) {
-        pkt_buffers_[i] = new uint8_t[RTP_PACKET_MAX_SIZE];
-    }
     if (type == MEDIA_VIDEO_TYPE) {
-        buffer_timeout_ = JITTER_BUFFER_VIDEO_TIMEOUT;
+        min_hold_ms_ = JITTER_BUFFER_VIDEO_MIN_HOLD;
+        max_hold_ms_ = JITTER_BUFFER_VIDEO_TIMEOUT;
     } else if (type == MEDIA_AUDIO_TYPE) {
-        buffer_timeout_ = JITTER_BUFFER_AUDIO_TIMEOUT;
+        min_hold_ms_ = JITTER_BUFFER_AUDIO_MIN_HOLD;
+        max_hold_ms_ = JITTER_BUFFER_AUDIO_TIMEOUT;
     } else {
         CSM_THROW_ERROR("JItterBuffer construct media_type %d error",
                 type);
     }
+    UpdateHoldTime();
 }
 
 JitterBuffer::~JitterBuffer() {
-    for (size_t i = 0; i < BUFFER_POOL_SIZE; i++) {
-        if (pkt_buffers_[i]) {
-            delete[] pkt_buffers_[i];
-        }
-    }
 }
 
 void JitterBuffer::InputRtpPacket(int clock_rate, 
-            RtpPacket* pkt) {
+            RtpPacket* input_pkt) {
     int64_t extend_seq = 0;
     bool reset = false;
     bool first_pkt = false;
-    size_t index = (buffer_index_++) % RTP_PACKET_MAX_SIZE;
-    uint8_t* buffer = pkt_buffers_[index];
-
-    RtpPacket* input_pkt = pkt->Clone(buffer);
 
     if (!init_flag_) {
         init_flag_ = true;
@@ -59,52 +50,64 @@ void JitterBuffer::InputRtpPacket(int clock_rate,
         }
     }
 
-    auto pkt_info_ptr = std::make_shared<RtpPacketInfo>(media_type_,
-                                                        clock_rate,
-                                                        input_pkt,
-                                                        extend_seq);
+    //the packet is copied only here, the input one is released by the caller
+    std::shared_ptr<RtpPacketInfo> pkt_info_ptr;
+    if (pool_) {
+        pkt_info_ptr = pool_->MakePacketInfo(media_type_, clock_rate, input_pkt, extend_seq);
+    } else {
+        pkt_info_ptr = std::make_shared<RtpPacketInfo>(media_type_, clock_rate, input_pkt, extend_seq);
+    }
     if (reset) {
         //if the rtc client is reset, call the reset callback which send pli
         ReportLost(pkt_info_ptr);
+        last_seq_ = -1;
     }
+    UpdateJitter(pkt_info_ptr.get(), extend_seq);
 
     //if it's the first packet, output the packet
     if (first_pkt || reset) {
+        ClearRing();
         OutputPacket(pkt_info_ptr);
         return;
     }
 
-    //if the seq is continued, output the packet
+    if (extend_seq <= output_seq_) {
+        LogInfof(logger_, "receive old seq:%ld, output_seq:%ld media type:%d",
+                extend_seq, output_seq_, pkt_info_ptr->media_type_);
+        return;
+    }
+
+    //the ring can't hold it, the packets which are too old are taken as lost
+    if (extend_seq - output_seq_ >= JITTER_BUFFER_RING_SIZE) {
+        LogWarnf(logger_, "jitter buffer media type:%d, seq:%ld is too far from output seq:%ld",
+                media_type_, extend_seq, output_seq_);
+        OutputUntil(extend_seq - JITTER_BUFFER_RING_SIZE);
+        ReportLost(pkt_info_ptr);
+    }
+
+    //if the seq is continued, output the packet and the continued ones in the ring
     if ((output_seq_ + 1) == extend_seq) {
         OutputPacket(pkt_info_ptr);
-
-        //check the packet in map
-        for (auto iter = rtp_packets_map_.begin();
-            iter != rtp_packets_map_.end();
-            ) {
-            int64_t pkt_extend_seq = iter->first;
-            if ((output_seq_ + 1) == pkt_extend_seq) {
-                if (iter->second->media_type_ == MEDIA_VIDEO_TYPE) {
-                    LogDebugf(logger_, "jitter buffer media type:%d, output seq(%d) in buffer queue",
-                        iter->second->media_type_, pkt_extend_seq);
-                }
-                OutputPacket(iter->second);
-                iter = rtp_packets_map_.erase(iter);
-                continue;
-            }
-            break;
-        }
+        OutputContinuous();
         return;
-    } else if (extend_seq <= output_seq_) {
-        LogInfof(logger_, "receive old seq:%ld, output_seq:%ld media type:%d",
-                extend_seq, output_seq_, pkt_info_ptr->media_type_);
+    }
+
+    GrowRing(extend_seq);
+    std::shared_ptr<RtpPacketInfo>& slot = RingSlot(extend_seq);
+    if (slot) {
+        //the duplicate packet
         return;
     }
-    rtp_packets_map_[extend_seq] = pkt_info_ptr;
+    slot = pkt_info_ptr;
+    buffered_count_++;
+    if (extend_seq > max_buffered_seq_) {
+        max_buffered_seq_ = extend_seq;
+    }
     if (pkt_info_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
         LogDebugf(logger_, "JitterBuffer media type:%d, packets queue len:%lu, pkt seq:%d, last output seq:%d",
-            pkt_info_ptr->media_type_, rtp_packets_map_.size(), pkt_info_ptr->extend_seq_, output_seq_);
+            pkt_info_ptr->media_type_, buffered_count_, pkt_info_ptr->extend_seq_, output_seq_);
     }
+    StartTimer();
 
     CheckTimeout();
 
@@ -115,36 +118,147 @@ void JitterBuffer::OnTimer() {
     CheckTimeout();
 }
 
+void JitterBuffer::UpdateRtt(int64_t rtt_ms) {
+    if (rtt_ms < 0) {
+        return;
+    }
+    rtt_ms_ = rtt_ms;
+    UpdateHoldTime();
+}
+
+//rfc3550 interarrival jitter in ms, by the packets which are received in order
+void JitterBuffer::UpdateJitter(RtpPacketInfo* pkt_info, int64_t extend_seq) {
+    RtpPacket* pkt = pkt_info->pkt;
+
+    if ((last_seq_ >= 0) && (extend_seq <= last_seq_)) {
+        return;
+    }
+    if ((last_seq_ >= 0) && (pkt_info->clock_rate_ > 0)) {
+        int64_t arrival_diff_ms = pkt->GetLocalMs() - last_arrival_ms_;
+        int64_t ts_diff_ms = (int64_t)(int32_t)(pkt->GetTimestamp() - last_timestamp_) * 1000 / pkt_info->clock_rate_;
+        double d = (double)(arrival_diff_ms - ts_diff_ms);
+
+        if (d < 0) {
+            d = -d;
+        }
+        jitter_ms_ += (d - jitter_ms_) / 16.0;
+        UpdateHoldTime();
+    }
+    last_seq_        = extend_seq;
+    last_arrival_ms_ = pkt->GetLocalMs();
+    last_timestamp_  = pkt->GetTimestamp();
+}
+
+void JitterBuffer::UpdateHoldTime() {
+    int64_t hold_ms = rtt_ms_ + (int64_t)(jitter_ms_ * JITTER_BUFFER_JITTER_FACTOR) + JITTER_BUFFER_HOLD_MARGIN;
+
+    if (hold_ms < min_hold_ms_) {
+        hold_ms = min_hold_ms_;
+    } else if (hold_ms > max_hold_ms_) {
+        hold_ms = max_hold_ms_;
+    }
+    hold_ms_ = hold_ms;
+}
+
 void JitterBuffer::CheckTimeout() {
-    if (rtp_packets_map_.empty()) {
+    if (buffered_count_ == 0) {
         return;
     }
     int64_t now_ms = now_millisec();
-    for(auto iter = rtp_packets_map_.begin();
-        iter != rtp_packets_map_.end();) {
-        std::shared_ptr<RtpPacketInfo> pkt_info_ptr = iter->second;
+
+    while (buffered_count_ > 0) {
+        //the first buffered packet after the lost ones
+        int64_t seq = output_seq_ + 1;
+        while ((seq <= max_buffered_seq_) && !RingSlot(seq)) {
+            seq++;
+        }
+        if (seq > max_buffered_seq_) {
+            break;
+        }
+        std::shared_ptr<RtpPacketInfo> pkt_info_ptr = RingSlot(seq);
         int64_t diff_t = now_ms - pkt_info_ptr->pkt->GetLocalMs();
 
-        if (diff_t > buffer_timeout_) {
-            if (pkt_info_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
-                LogInfof(logger_, "timeout output type:%d, seq:%d, timeout:%ld",
-                    pkt_info_ptr->media_type_, pkt_info_ptr->extend_seq_, buffer_timeout_);
-            }
+        if (diff_t <= hold_ms_) {
+            break;
+        }
+        if (pkt_info_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
+            LogInfof(logger_, "timeout output type:%d, seq:%d, timeout:%ld, jitter:%.1f",
+                pkt_info_ptr->media_type_, pkt_info_ptr->extend_seq_, hold_ms_, jitter_ms_);
+        }
+        OutputUntil(seq);
+        ReportLost(pkt_info_ptr);
+    }
 
-            OutputPacket(pkt_info_ptr);
-            iter = rtp_packets_map_.erase(iter);
-            ReportLost(pkt_info_ptr);
-            continue;
+    return;
+}
+
+void JitterBuffer::OutputContinuous() {
+    while (buffered_count_ > 0) {
+        std::shared_ptr<RtpPacketInfo>& slot = RingSlot(output_seq_ + 1);
+        if (!slot) {
+            break;
+        }
+        std::shared_ptr<RtpPacketInfo> pkt_info_ptr = std::move(slot);
+        slot.reset();
+        buffered_count_--;
+        if (pkt_info_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
+            LogDebugf(logger_, "jitter buffer media type:%d, output seq(%d) in buffer queue",
+                pkt_info_ptr->media_type_, pkt_info_ptr->extend_seq_);
         }
-        if ((output_seq_ + 1) == pkt_info_ptr->extend_seq_) {
-            OutputPacket(iter->second);
-            iter = rtp_packets_map_.erase(iter);
+        OutputPacket(pkt_info_ptr);
+    }
+    if (buffered_count_ == 0) {
+        StopTimer();
+    }
+}
+
+//output the buffered packets until the seq, the missing ones are skipped
+void JitterBuffer::OutputUntil(int64_t extend_seq) {
+    for (int64_t seq = output_seq_ + 1; (seq <= extend_seq) && (buffered_count_ > 0); seq++) {
+        std::shared_ptr<RtpPacketInfo>& slot = RingSlot(seq);
+        if (!slot) {
             continue;
         }
-        iter++;
+        std::shared_ptr<RtpPacketInfo> pkt_info_ptr = std::move(slot);
+        slot.reset();
+        buffered_count_--;
+        OutputPacket(pkt_info_ptr);
+    }
+    if (extend_seq > output_seq_) {
+        output_seq_ = extend_seq;
     }
+    OutputContinuous();
+}
 
-    return;
+//the ring holds the seqs in (output_seq_, output_seq_ + size), the buffered
+//packets are at the different indexes after the ring is doubled.
+void JitterBuffer::GrowRing(int64_t extend_seq) {
+    if (ring_.empty()) {
+        ring_.resize(JITTER_BUFFER_RING_INIT_SIZE);
+    }
+    while ((extend_seq - output_seq_ >= (int64_t)ring_.size()) &&
+        (ring_.size() < JITTER_BUFFER_RING_SIZE)) {
+        std::vector<std::shared_ptr<RtpPacketInfo>> new_ring(ring_.size() * 2);
+
+        for (std::shared_ptr<RtpPacketInfo>& slot : ring_) {
+            if (slot) {
+                int64_t seq = slot->extend_seq_;
+                new_ring[seq & (new_ring.size() - 1)] = std::move(slot);
+            }
+        }
+        ring_.swap(new_ring);
+    }
+}
+
+void JitterBuffer::ClearRing() {
+    if (buffered_count_ > 0) {
+        for (std::shared_ptr<RtpPacketInfo>& slot : ring_) {
+            slot.reset();
+        }
+    }
+    buffered_count_   = 0;
+    max_buffered_seq_ = -1;
+    StopTimer();
 }
 
 void JitterBuffer::ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
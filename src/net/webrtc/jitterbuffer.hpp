@@ -2,19 +2,21 @@
 #define JITTER_BUFFER_HPP
 #include "rtp_packet.hpp"
 #include "jitterbuffer_pub.hpp"
+#include "rtp_packet_pool.hpp"
 #include "logger.hpp"
 #include "timer.hpp"
 #include <string>
 #include <stdint.h>
 #include <stddef.h>
-#include <map>
+#include <vector>
 #include <memory>
 #include <uv.h>
 
 namespace cpp_streamer
 {
-#define BUFFER_POOL_SIZE 2048
-
+//the out of order packets are kept in a ring indexed by the extend seq,
+//they're output in order, or after the hold time when the packet before
+//them is lost. the hold time follows the interarrival jitter and the rtt.
 class JitterBuffer : public TimerInterface
 {
 public:
@@ -24,6 +26,17 @@ public:
 public:
     void InputRtpPacket(int clock_rate, 
             RtpPacket* input_pkt);
+    //the packet infos are allocated from the pool, it's shared by the jitter buffers of one peer connection
+    void SetPacketPool(RtpPacketPool* pool) { pool_ = pool; }
+    //the rtt for the nack resend, 0 if nack is disable
+    void UpdateRtt(int64_t rtt_ms);
+
+public:
+    int64_t GetHoldMs() { return hold_ms_; }
+    double GetJitterMs() { return jitter_ms_; }
+    size_t GetBufferedCount() { return buffered_count_; }
+    //the ring only, the packets in it are counted by the packet pool
+    size_t GetMemoryUsage() { return ring_.capacity() * sizeof(std::shared_ptr<RtpPacketInfo>); }
 
 public:
     virtual void OnTimer() override;
@@ -32,8 +45,17 @@ private:
     void InitSeq(RtpPacket* input_pkt);
     bool UpdateSeq(RtpPacket* input_pkt, int64_t& extend_seq, bool& reset);
     void OutputPacket(std::shared_ptr<RtpPacketInfo>);
+    void OutputContinuous();
+    void OutputUntil(int64_t extend_seq);
     void CheckTimeout();
+    void ClearRing();
+    void GrowRing(int64_t extend_seq);
+    std::shared_ptr<RtpPacketInfo>& RingSlot(int64_t extend_seq) {
+        return ring_[extend_seq & (ring_.size() - 1)];
+    }
     void ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr);
+    void UpdateJitter(RtpPacketInfo* pkt_info, int64_t extend_seq);
+    void UpdateHoldTime();
 
 private:
     Logger* logger_ = nullptr;
@@ -44,18 +66,28 @@ private:
     uint16_t max_seq_  = 0;
     uint32_t bad_seq_  = RTP_SEQ_MOD + 1;   /* so seq == bad_seq is false */
     uint32_t cycles_   = 0;
-    std::map<int64_t, std::shared_ptr<RtpPacketInfo>> rtp_packets_map_;//key: extend_seq, value: rtp packet info
+
+private:
+    std::vector<std::shared_ptr<RtpPacketInfo>> ring_;//index: extend_seq & (ring_.size() - 1)
+    size_t buffered_count_    = 0;
+    int64_t max_buffered_seq_ = -1;
 
 private:
     int64_t output_seq_ = 0;
     int64_t report_lost_ts_ = -1;
 
 private:
-    uint8_t* pkt_buffers_[BUFFER_POOL_SIZE];
-    size_t buffer_index_ = 0;
+    RtpPacketPool* pool_ = nullptr;
 
-private:
-    int64_t buffer_timeout_ = JITTER_BUFFER_VIDEO_TIMEOUT;
+private://adaptive hold time
+    int64_t min_hold_ms_ = JITTER_BUFFER_VIDEO_MIN_HOLD;
+    int64_t max_hold_ms_ = JITTER_BUFFER_VIDEO_TIMEOUT;
+    int64_t hold_ms_     = JITTER_BUFFER_VIDEO_TIMEOUT;
+    int64_t rtt_ms_      = JITTER_BUFFER_DEFAULT_RTT;
+    double jitter_ms_    = 0.0;
+    int64_t last_seq_         = -1;//the max extend seq which is received in order
+    int64_t last_arrival_ms_  = 0;
+    uint32_t last_timestamp_  = 0;
 };
 
 }
@@ -10,9 +10,25 @@
 
 namespace cpp_streamer
 {
+//the max hold time of the packets after the lost one
 #define JITTER_BUFFER_AUDIO_TIMEOUT 100 //ms
 #define JITTER_BUFFER_VIDEO_TIMEOUT 400 //ms
+//the min hold time on a clean link
+#define JITTER_BUFFER_AUDIO_MIN_HOLD 20 //ms
+#define JITTER_BUFFER_VIDEO_MIN_HOLD 40 //ms
+//the hold time: rtt(for the nack resend) + jitter * factor + margin
+#define JITTER_BUFFER_JITTER_FACTOR  4
+#define JITTER_BUFFER_HOLD_MARGIN    10 //ms
+#define JITTER_BUFFER_DEFAULT_RTT    100 //ms, before the rtt is measured
+//the packets are indexed by extend seq & (size - 1), it must be power of 2.
+//the ring is allocated at the first out of order packet, and grows to the
+//seq range which is buffered(bitrate * hold time) until the max size.
+#define JITTER_BUFFER_RING_INIT_SIZE 64
+#define JITTER_BUFFER_RING_SIZE      1024
+#define JITTER_BUFFER_TIMER_MS       20
 
+//the rtp packet and its data are kept in the object,
+//it's allocated from the RtpPacketPool of the peer connection.
 class RtpPacketInfo
 {
 public:
@@ -23,12 +39,11 @@ public:
                                 , extend_seq_(extend_seq)
                                 , clock_rate_(clock_rate)
     {
-        this->pkt = input_pkt->Clone();
+        this->pkt = holder_.Clone(input_pkt, buffer_);
     }
 
     ~RtpPacketInfo()
     {
-        delete this->pkt;
         this->pkt = nullptr;
     }
 
@@ -37,6 +52,10 @@ public:
     RtpPacket* pkt = nullptr;
     int64_t extend_seq_ = 0;
     int clock_rate_     = 0;
+
+private:
+    RtpPacketHolder holder_;
+    uint8_t buffer_[RTP_PACKET_MAX_SIZE];
 };
 
 class JitterBufferCallbackI
@@ -23,10 +23,13 @@ namespace cpp_streamer
 {
 #define MEDIASOUP_PUSH_NAME "mspush"
 
-void SourceBroadcasterData(uv_async_t *handle) {
-    MsPush* ms = (MsPush*)(handle->data);
-    ms->HandleMediaData();
-}
+std::map<std::string, std::string> MsPush::def_options_ = {
+    {"queue_policy", "block"},
+    {"pacing_kbps", "0"},//0: no pacing
+    {"pacing_burst_ms", "20"},
+    {"udp_batch", "false"},//sendmmsg/recvmmsg batching, applied when the network starts
+    {"udp_gso", "false"}//linux udp segment offload, needs udp_batch
+};
 
 MsPush::MsPush()
 {
@@ -34,11 +37,17 @@ MsPush::MsPush()
     name_ = MEDIASOUP_PUSH_NAME;
     name_ += "_";
     name_ += UUID::MakeUUID();
+    options_ = def_options_;
 }
 
 MsPush::~MsPush()
 {
     LogInfof(logger_, "destruct mediasoup push");
+    packet_queue_.Close();
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Remove(this);
+    }
     ReleaseHttpClient(hc_req_);
     ReleaseHttpClient(hc_transport_);
     ReleaseHttpClient(hc_video_prd_);
@@ -50,25 +59,26 @@ MsPush::~MsPush()
 }
 
 Media_Packet_Ptr MsPush::GetMediaPacket() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return packet_queue_.Pop();
+}
 
-    Media_Packet_Ptr pkt_ptr;
-    if (packet_queue_.empty()) {
-        return pkt_ptr;
-    }
-        
-    pkt_ptr = packet_queue_.front();
-    packet_queue_.pop();
+size_t MsPush::OnScheduleRun(size_t budget) {
+    return HandleMediaData(budget);
+}
 
-    return pkt_ptr;
+bool MsPush::HasScheduleData() {
+    return packet_queue_.Depth() > 0;
 }
 
-void MsPush::HandleMediaData() {
-    while(true) {
+size_t MsPush::HandleMediaData(size_t budget) {
+    size_t count = 0;
+
+    while(count < budget) {
         Media_Packet_Ptr pkt_ptr = GetMediaPacket();
         if (!pkt_ptr) {
             break;
         }
+        count++;
 
         if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
             pc_->SendVideoPacket(pkt_ptr);
@@ -79,7 +89,11 @@ void MsPush::HandleMediaData() {
                     avtype_tostring(pkt_ptr->av_type_).c_str());
         }
     }
-    return;
+    std::string statics;
+    if (report_ && packet_queue_.GetReportStatics(now_millisec(), statics)) {
+        report_->OnReport(name_, "queue_statics", statics);
+    }
+    return count;
 }
 
 void MsPush::ReleaseHttpClient(HttpClient*& hc) {
@@ -110,14 +124,26 @@ int MsPush::RemoveSinker(const std::string& name) {
 }
 
 int MsPush::SourceData(Media_Packet_Ptr pkt_ptr) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    Media_Packet_Ptr new_ptr = pkt_ptr->copy();
+    packet_queue_.Push(pkt_ptr->shared_copy());
+
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Notify(this);
+    }
+    return (int)packet_queue_.Depth();
+}
 
-    packet_queue_.push(new_ptr);
+int MsPush::SourceBatch(MediaPacketSpan pkts) {
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        packet_queue_.Push(pkt_ptr->shared_copy());
+    }
 
-    async_.data = (void*)this;
-    uv_async_send(&async_);
-    return (int)packet_queue_.size();
+    //one notify for the whole batch
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Notify(this);
+    }
+    return (int)pkts.size();
 }
 
 void MsPush::StartNetwork(const std::string& url, void* loop_handle) {
@@ -130,9 +156,14 @@ void MsPush::StartNetwork(const std::string& url, void* loop_handle) {
     LogInfof(logger_, "http post host:%s, port:%d, roomId:%s, userId:%s",
             host_.c_str(), port_, roomId_.c_str(), userId_.c_str());
     loop_ = (uv_loop_t*)loop_handle;
-    uv_async_init(loop_, &async_, SourceBroadcasterData);
+    scheduler_ = LoopScheduler::GetScheduler(loop_);
+    if (packet_queue_.Depth() > 0) {
+        scheduler_.load()->Notify(this);
+    }
 
-    pc_ = new PeerConnection((uv_loop_t*)loop_handle, logger_, this);
+    pc_ = new PeerConnection((uv_loop_t*)loop_handle, logger_, this, options_["udp_batch"] == "true");
+    UpdatePacingRate();
+    pc_->EnableUdpGso(options_["udp_gso"] == "true");
 
     BroadCasterRequest();
     return;
@@ -274,6 +305,29 @@ void MsPush::AddOption(const std::string& key, const std::string& value) {
     }
     options_[key] = value;
     LogInfof(logger_, "set mediaspu broadcaster options key:%s, value:%s", key.c_str(), value.c_str());
+
+    if (key == "queue_policy") {
+        QUEUE_OVERFLOW_POLICY policy;
+        if (!GetQueuePolicyByString(value, policy)) {
+            CSM_THROW_ERROR("unknown queue policy:%s", value.c_str());
+        }
+        packet_queue_.SetPolicy(policy);
+    } else if ((key == "pacing_kbps") || (key == "pacing_burst_ms")) {
+        if (pc_) {
+            UpdatePacingRate();
+        }
+    } else if (key == "udp_gso") {
+        if (pc_) {
+            pc_->EnableUdpGso(value == "true");
+        }
+    }
+}
+
+void MsPush::UpdatePacingRate() {
+    int64_t pacing_kbps = atoi(options_["pacing_kbps"].c_str());
+    int64_t burst_ms    = atoi(options_["pacing_burst_ms"].c_str());
+
+    pc_->SetPacingRate(pacing_kbps, burst_ms);
 }
 
 void MsPush::SetReporter(StreamerReport* reporter) {
@@ -596,7 +650,7 @@ bool MsPush::GetVideoRtpParameters(json& rtp_parameters_json) {
         header_exts_array_json.push_back(abs_send_time_json);
 
         auto tcc_json          = json::object();
-        tcc_json["uri"]        = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+        tcc_json["uri"]        = TCC_EXT_URI;
         tcc_json["id"]         = tcc_id;
         tcc_json["encrypt"]    = false;
         tcc_json["parameters"] = json::object();
@@ -718,7 +772,7 @@ bool MsPush::GetAudioRtpParameters(json& rtp_parameters_json) {
         header_exts_array_json.push_back(abs_send_time_json);
 
         auto tcc_json          = json::object();
-        tcc_json["uri"]        = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+        tcc_json["uri"]        = TCC_EXT_URI;
         tcc_json["id"]         = tcc_id;
         tcc_json["encrypt"]    = false;
         tcc_json["parameters"] = json::object();
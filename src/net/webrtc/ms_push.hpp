@@ -4,6 +4,8 @@
 #include "http_client.hpp"
 #include "peerconnection.hpp"
 #include "cpp_streamer_interface.hpp"
+#include "media_packet_queue.hpp"
+#include "loop_scheduler.hpp"
 #include "json.hpp"
 #include <queue>
 #include <mutex>
@@ -28,10 +30,8 @@ typedef enum
     BROADCASTER_DONE
 } BROADCASTER_STATE;
 
-class MsPush : public CppStreamerInterface , public HttpClientCallbackI, public PCStateReportI
+class MsPush : public CppStreamerInterface , public HttpClientCallbackI, public PCStateReportI, public LoopScheduleTaskI
 {
-friend void SourceBroadcasterData(uv_async_t *handle);
-
 public:
     MsPush();
     virtual ~MsPush();
@@ -45,6 +45,11 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
+
+public:
+    virtual size_t OnScheduleRun(size_t budget) override;
+    virtual bool HasScheduleData() override;
 
 protected:
     virtual void OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) override;
@@ -54,7 +59,8 @@ public:
 
 private:
     Media_Packet_Ptr GetMediaPacket();
-    void HandleMediaData();
+    size_t HandleMediaData(size_t budget);
+    void UpdatePacingRate();
 
 private:
     void ReleaseHttpClient(HttpClient*& hc);
@@ -80,9 +86,11 @@ private:
     std::string name_;
 
 private:
-    std::queue<Media_Packet_Ptr> packet_queue_;
-    std::mutex mutex_;
-    uv_async_t async_;
+    MediaPacketQueue packet_queue_;
+    std::atomic<LoopScheduler*> scheduler_{nullptr};
+
+private:
+    static std::map<std::string, std::string> def_options_;
 
 private:
     HttpClient* hc_req_           = nullptr;
@@ -2,34 +2,61 @@
 #include "rtprtcp_pub.hpp"
 #include "logger.hpp"
 #include "timeex.hpp"
-#include <algorithm>
-#include <sstream>
 
 namespace cpp_streamer
 {
 
-NackGenerator::NackGenerator(uv_loop_t* loop, Logger* logger, NackGeneratorCallbackI* cb):TimerInterface(loop, NACK_DEFAULT_TIMEOUT)
-                                                                             , logger_(logger)
+NackGenerator::NackGenerator(Logger* logger, NackGeneratorCallbackI* cb):logger_(logger)
     , cb_(cb)
 {
-    StartTimer();
 }
 
 NackGenerator::~NackGenerator()
 {
-    StopTimer();
 }
 
 void NackGenerator::UpdateRtt(int64_t rtt) {
     rtt_ = rtt;
 }
 
+void NackGenerator::SetMissing(uint16_t seq, uint32_t due_ms) {
+    if (IsMissing(seq)) {
+        return;
+    }
+    if (missing_count_ == 0) {
+        first_missing_ = seq;
+    }
+    bitmap_[seq >> 6] |= (uint64_t)1 << (seq & 63);
+    missing_count_++;
+
+    NackSlot& slot = slots_[seq & (NACK_WINDOW - 1)];
+    slot.due_ms = due_ms;
+    slot.retry  = 0;
+}
+
+void NackGenerator::ClearMissing(uint16_t seq) {
+    if (!IsMissing(seq)) {
+        return;
+    }
+    bitmap_[seq >> 6] &= ~((uint64_t)1 << (seq & 63));
+    missing_count_--;
+}
+
+//the seqs which are out of the window behind the last seq are not requested
+void NackGenerator::DropOutOfWindow() {
+    while ((missing_count_ > 0) && ((uint16_t)(last_seq_ - first_missing_) >= NACK_WINDOW)) {
+        ClearMissing(first_missing_);
+        first_missing_++;
+    }
+}
+
 void NackGenerator::UpdateNackList(RtpPacket* pkt) {
     uint16_t seq = pkt->GetSeq();
 
     if (!init_flag_) {
         init_flag_ = true;
         last_seq_  = seq;
+        base_ms_   = pkt->GetLocalMs();
         return;
     }
 
@@ -38,91 +65,105 @@ void NackGenerator::UpdateNackList(RtpPacket* pkt) {
         return;
     }
 
-    //LogInfof(logger_, "nack packet seq:%d", seq);
     if (SeqLowerThan(seq, last_seq_)) {
-        auto iter = nack_map_.find(seq);
-
         //the seq has been in the nack list, remove it.
-        if (iter != nack_map_.end()) {
-            nack_map_.erase(iter);
-            LogDebugf(logger_, "remove from nack map, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d, rtt:%ld",
+        if (IsMissing(seq)) {
+            ClearMissing(seq);
+            LogDebugf(logger_, "remove from nack list, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d, rtt:%ld",
                 pkt->GetSsrc(), seq, last_seq_, pkt->GetPayloadType(), rtt_);
-            return;
-        }
-        /*
-        std::stringstream ss;
-
-        ss << "[";
-        for (auto item : nack_map_) {
-            ss << " " << item.first;
         }
-        ss << " ]";
-        LogInfof(logger_, "receive the old packet which is not in nack list, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d, nack list:%s, rtt:%ld",
-            pkt->GetSsrc(), seq, last_seq_, pkt->GetPayloadType(), ss.str().c_str(), rtt_);
-            */
         return;
     }
 
-    if ((last_seq_ + 1) == seq) {
-        last_seq_ = seq;
+    uint16_t seq_start = last_seq_ + 1;
+    uint16_t gap       = seq - seq_start;
+
+    last_seq_ = seq;
+    if (gap == 0) {
         return;
     }
 
-    uint16_t seq_start = last_seq_;
-    uint16_t seq_end   = seq;
-    
-    last_seq_ = seq;
+    //only the seqs in the window are marked
+    if (gap >= NACK_WINDOW) {
+        seq_start = seq - (NACK_WINDOW - 1);
+        gap       = NACK_WINDOW - 1;
+    }
+    if (slots_.empty()) {
+        bitmap_.resize(RTP_SEQ_MOD / 64, 0);
+        slots_.resize(NACK_WINDOW);
+    }
+    DropOutOfWindow();
 
-    //add seqs in nack list
-    for (uint16_t key_seq = seq_start + 1; key_seq < seq_end; key_seq++) {
-        auto iter = nack_map_.find(key_seq);
-        if (iter == nack_map_.end()) {
-            nack_map_.insert(std::make_pair(key_seq, NACK_INFO(key_seq, 0, 0)));
-        }
+    //the missing seqs are requested at the next timer
+    uint32_t due_ms = RelativeMs(pkt->GetLocalMs());
+    for (uint16_t i = 0; i < gap; i++) {
+        SetMissing(seq_start + i, due_ms);
     }
 }
 
-void NackGenerator::OnTimer() {
-    if (nack_map_.empty()) {
+void NackGenerator::OnTimer(int64_t now_ms) {
+    if (missing_count_ == 0) {
         return;
     }
-
-    int64_t now_ms = now_millisec();
-    std::vector<uint16_t> lost_seq_list;
-    auto iter = nack_map_.begin();
-
-    while(iter != nack_map_.end()) {
-        if (iter->second.retry > NACK_RETRY_MAX) {
-            iter = nack_map_.erase(iter);
+    uint32_t now_rel   = RelativeMs(now_ms);
+    int64_t interval   = (rtt_ > NACK_MIN_INTERVAL) ? rtt_ : NACK_MIN_INTERVAL;
+    uint16_t seq       = first_missing_;
+    size_t remain      = (uint16_t)(last_seq_ - first_missing_);
+    bool first_found   = false;
+    RtcpNackBlock* block = nullptr;
+
+    blocks_.clear();
+    while (remain > 0) {
+        uint64_t word = bitmap_[seq >> 6] >> (seq & 63);
+        if (word == 0) {
+            //skip the rest of the word
+            size_t step = 64 - (seq & 63);
+            if (step > remain) {
+                step = remain;
+            }
+            seq    += (uint16_t)step;
+            remain -= step;
             continue;
         }
-        if (now_ms - iter->second.sent_ms < rtt_) {
-            iter++;
-            continue;
+        size_t zeros = (size_t)__builtin_ctzll(word);
+        if (zeros >= remain) {
+            break;
         }
-        iter->second.sent_ms = now_ms;
-        iter->second.retry++;
-
-        lost_seq_list.push_back(iter->first);
-
-        iter++;
-    }
-
-    //LogInfof(logger_, "nack list len:%lu", lost_seq_list.size());
-    if (!lost_seq_list.empty()) {
-        std::sort(lost_seq_list.begin(), lost_seq_list.end());
-        cb_->GenerateNackList(lost_seq_list);
-    }
-
-    if (nack_map_.size() > NACK_LIST_MAX) {
-        LogWarnf(logger_, "the nack list is overflow(%lu) and the list threshold is %d",
-            nack_map_.size(), NACK_LIST_MAX);
+        seq    += (uint16_t)zeros;
+        remain -= zeros;
+
+        NackSlot& slot = slots_[seq & (NACK_WINDOW - 1)];
+        if (slot.retry >= NACK_RETRY_MAX) {
+            ClearMissing(seq);
+        } else {
+            if (!first_found) {
+                first_found    = true;
+                first_missing_ = seq;
+            }
+            if ((int32_t)(now_rel - slot.due_ms) >= 0) {
+                slot.retry++;
+                slot.due_ms = now_rel + (uint32_t)interval;
+
+                //pid + blp: the bit i of blp is the seq pid + i + 1
+                uint16_t diff = block ? (uint16_t)(seq - block->packet_id) : 0;
+                if (block && (diff >= 1) && (diff <= 16)) {
+                    block->lost_bitmap |= (uint16_t)(1 << (diff - 1));
+                } else {
+                    RtcpNackBlock new_block;
+                    new_block.packet_id   = seq;
+                    new_block.lost_bitmap = 0;
+                    blocks_.push_back(new_block);
+                    block = &blocks_.back();
+                }
+            }
+        }
+        seq++;
+        remain--;
     }
 
-    while (nack_map_.size() > NACK_LIST_MAX) {
-        nack_map_.erase(nack_map_.begin());
+    if (!blocks_.empty()) {
+        cb_->GenerateNackBlocks(blocks_);
     }
 }
 
 }
-
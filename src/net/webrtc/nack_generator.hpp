@@ -2,70 +2,84 @@
 #define NACK_GENERATOR_HPP
 #include "rtprtcp_pub.hpp"
 #include "rtp_packet.hpp"
-#include "timer.hpp"
+#include "rtcpfb_nack.hpp"
 #include "logger.hpp"
 
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
 #include <vector>
-#include <map>
 
 namespace cpp_streamer
 {
-#define NACK_LIST_MAX        5000
-#define NACK_DEFAULT_TIMEOUT 10//ms
+//the missing seqs in the window(power of 2) behind the last seq are requested
+#define NACK_WINDOW          4096
 #define NACK_RETRY_MAX       20
 #define NACK_DEFAULT_RTT     15//ms
-
-class NACK_INFO
-{
-public:
-    NACK_INFO(uint16_t seq, int64_t sent_ms, int retry)
-    {
-        this->seq     = seq;
-        this->sent_ms = sent_ms;
-        this->retry   = retry;
-    }
-    ~NACK_INFO()
-    {
-    }
-
-public:
-    uint16_t seq;
-    int64_t sent_ms;
-    int retry = 0;
-};
+//the min resend request interval of one seq, it's the rtcp timer interval
+#define NACK_MIN_INTERVAL    20//ms
 
 class NackGeneratorCallbackI
 {
 public:
-    virtual void GenerateNackList(const std::vector<uint16_t>& seq_vec) = 0;
+    //the blocks(pid + blp) are in host order
+    virtual void GenerateNackBlocks(const std::vector<RtcpNackBlock>& blocks) = 0;
 };
 
-class NackGenerator : public TimerInterface
+//the missing seqs are marked in a bitmap indexed by the rtp seq, the retry
+//count and the next request time of them are in the side array of the window.
+//it's driven by the rtcp timer of the stream, and the nack blocks are made
+//from the bitmap directly.
+class NackGenerator
 {
 public:
-    NackGenerator(uv_loop_t* loop, Logger* logger, NackGeneratorCallbackI* cb);
-    virtual ~NackGenerator();
+    NackGenerator(Logger* logger, NackGeneratorCallbackI* cb);
+    ~NackGenerator();
 
     void UpdateNackList(RtpPacket* pkt);
     void UpdateRtt(int64_t rtt);
+    void OnTimer(int64_t now_ms);
+
+public:
+    size_t GetMissingCount() { return missing_count_; }
+    size_t GetMemoryUsage() {
+        return bitmap_.capacity() * sizeof(uint64_t) + slots_.capacity() * sizeof(NackSlot)
+            + blocks_.capacity() * sizeof(RtcpNackBlock);
+    }
 
-protected:
-    virtual void OnTimer() override;
+private:
+    class NackSlot
+    {
+    public:
+        uint32_t due_ms = 0;//from base_ms_
+        uint8_t retry   = 0;
+    };
 
 private:
-    Logger* logger_ = nullptr;
+    bool IsMissing(uint16_t seq) { return !bitmap_.empty() && ((bitmap_[seq >> 6] >> (seq & 63)) & 0x01); }
+    void SetMissing(uint16_t seq, uint32_t due_ms);
+    void ClearMissing(uint16_t seq);
+    void DropOutOfWindow();
+    uint32_t RelativeMs(int64_t now_ms) { return (uint32_t)(now_ms - base_ms_); }
 
 private:
+    Logger* logger_ = nullptr;
     NackGeneratorCallbackI* cb_ = nullptr;
+    int64_t rtt_ = NACK_DEFAULT_RTT;
+
+private:
     bool init_flag_ = false;
     uint16_t last_seq_ = 0;
-    std::map<uint16_t, NACK_INFO> nack_map_;
-    int64_t rtt_ = NACK_DEFAULT_RTT;
+    int64_t base_ms_   = 0;
+
+private:
+    //they're allocated when the first seq is missing
+    std::vector<uint64_t> bitmap_;//RTP_SEQ_MOD bits, bit set: the seq is missing
+    std::vector<NackSlot> slots_;//index: seq & (NACK_WINDOW - 1)
+    uint16_t first_missing_ = 0;//the scan starts from it
+    size_t missing_count_   = 0;
+    std::vector<RtcpNackBlock> blocks_;
 };
 
 }
 #endif
-
@@ -25,8 +25,8 @@ public:
 public:
     virtual void InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) override
     {
-        size_t pkt_size = pkt_ptr->pkt->GetPayloadLength() + 1024;
-        std::shared_ptr<Media_Packet> audio_pkt_ptr = std::make_shared<Media_Packet>(pkt_size);
+        size_t pkt_size = pkt_ptr->pkt->GetPayloadLength();
+        std::shared_ptr<Media_Packet> audio_pkt_ptr = make_media_packet(pkt_size);
         int64_t dts = (int64_t)pkt_ptr->pkt->GetTimestamp();
 
         audio_pkt_ptr->av_type_    = MEDIA_AUDIO_TYPE;
@@ -39,18 +39,22 @@ void PackHandleH264::GetStartEndBit(RtpPacket* pkt, bool& start, bool& end) {
 }
 
 void PackHandleH264::OnTimer() {
-    CheckFuaTimeout();
+    CheckAuTimeout();
 }
 
 void PackHandleH264::InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
+    RtpPacket* pkt = pkt_ptr->pkt;
+    uint32_t timestamp = pkt->GetTimestamp();
+
     if (!init_flag_) {
         init_flag_ = true;
         last_extend_seq_ = pkt_ptr->extend_seq_;
     } else {
         if ((last_extend_seq_ + 1) != pkt_ptr->extend_seq_) {
-            packets_queue_.clear();
-            start_flag_ = false;
-            end_flag_   = false;
+            //the access unit which the packet belongs to is broken
+            ResetAu();
+            drop_timestamp_ = true;
+            drop_ts_        = timestamp;
 
             ReportLost(pkt_ptr);
             last_extend_seq_ = pkt_ptr->extend_seq_;
@@ -59,106 +63,53 @@ void PackHandleH264::InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
         last_extend_seq_ = pkt_ptr->extend_seq_;
     }
 
-    uint8_t* payload_data = pkt_ptr->pkt->GetPayload();
-    uint8_t nal_type = payload_data[0] & 0x1f;
-
-    if ((nal_type >= 1) && (nal_type <= 23)) {//single nalu
-        int64_t dts = pkt_ptr->pkt->GetTimestamp();
-        size_t pkt_size = sizeof(NAL_START_CODE) + pkt_ptr->pkt->GetPayloadLength() + 1024;
-
-        auto h264_pkt_ptr = std::make_shared<Media_Packet>(pkt_size);
-
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)payload_data, pkt_ptr->pkt->GetPayloadLength());
-
-        h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-        h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-        h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-        h264_pkt_ptr->dts_        = dts;
-        h264_pkt_ptr->pts_        = dts;
-
-        if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-            h264_pkt_ptr->is_seq_hdr_   = true;
-            h264_pkt_ptr->is_key_frame_ = false;
-        } else if (nal_type == kAvcNaluTypeIDR) {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = true;
-        } else {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = false;
-        }
-
-        cb_->MediaPacketOutput(h264_pkt_ptr);
-        return;
-    } else if (nal_type == 28) {//rtp fua
-        bool start = false;
-        bool end   = false;
-
-        GetStartEndBit(pkt_ptr->pkt, start, end);
-
-        if (start && !end) {
-            packets_queue_.clear();
-            start_flag_ = start;
-        } else if (start && end) {//exception happened
-            LogErrorf(logger_, "rtp h264 pack error: both start and end flag are enable");
-            ResetRtpFua();
-            ReportLost(pkt_ptr);
+    if (drop_timestamp_) {
+        if (timestamp == drop_ts_) {
             return;
         }
+        drop_timestamp_ = false;
+    }
 
-        if (end && !start_flag_) {
-            LogErrorf(logger_, "rtp h264 pack error: get end rtp packet but there is no start rtp packet");
-            ResetRtpFua();
-            ReportLost(pkt_ptr);
-            return;
-        }
+    if (au_ptr_ && (timestamp != au_timestamp_)) {
+        //the marker of the last access unit is lost or not set
+        OutputAu();
+    }
 
-        if (end) {
-            end_flag_ = true;
-        }
+    if (pkt->GetPayloadLength() < 1) {
+        return;
+    }
+    uint8_t* payload_data = pkt->GetPayload();
+    uint8_t nal_type = payload_data[0] & 0x1f;
+    bool ok = true;
 
-        packets_queue_.push_back(pkt_ptr);
-
-        if (start_flag_ && end_flag_) {
-            auto h264_pkt_ptr = std::make_shared<Media_Packet>(50*1024);
-            int64_t dts = 0;
-            bool ok = DemuxFua(h264_pkt_ptr, dts);
-            if (ok) {
-                h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-                h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-                h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-                h264_pkt_ptr->dts_        = dts;
-                h264_pkt_ptr->pts_        = dts;
-                nal_type = ((uint8_t*)h264_pkt_ptr->buffer_ptr_->Data())[4];
-                nal_type = nal_type & 0x1f;
-                if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-                    h264_pkt_ptr->is_seq_hdr_   = true;
-                    h264_pkt_ptr->is_key_frame_ = false;
-                } else if (nal_type == kAvcNaluTypeIDR) {
-                    h264_pkt_ptr->is_seq_hdr_   = false;
-                    h264_pkt_ptr->is_key_frame_ = true;
-                } else {
-                    h264_pkt_ptr->is_seq_hdr_   = false;
-                    h264_pkt_ptr->is_key_frame_ = false;
-                }
-                cb_->MediaPacketOutput(h264_pkt_ptr);
-            } else {
-                ReportLost(pkt_ptr);
-            }
-            start_flag_ = false;
-            end_flag_   = false;
-            return;
+    if (!au_ptr_) {
+        StartAu(pkt);
+    }
+
+    if ((nal_type >= 1) && (nal_type <= 23)) {//single nalu
+        if (fua_started_) {
+            LogErrorf(logger_, "rtp h264 pack error: get single nalu before the fua end");
+            ok = false;
+        } else {
+            AppendNalu(payload_data, pkt->GetPayloadLength());
         }
+    } else if (nal_type == 28) {//rtp fua
+        ok = DemuxFua(pkt);
+    } else if (nal_type == 24) {//handle stapA
+        ok = DemuxStapA(pkt);
+    }
 
-        CheckFuaTimeout();
+    if (!ok) {
+        ResetAu();
+        drop_timestamp_ = true;
+        drop_ts_        = timestamp;
+        ReportLost(pkt_ptr);
         return;
-    } else if (nal_type == 24) {//handle stapA
-        bool ret = DemuxStapA(pkt_ptr);
-        if (!ret) {
-            ReportLost(pkt_ptr);
-        }
     }
 
+    if (pkt->GetMarker()) {
+        OutputAu();
+    }
     return;
 }
 
@@ -171,151 +122,169 @@ void PackHandleH264::ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
     }
 }
 
-void PackHandleH264::CheckFuaTimeout() {
-    size_t queue_len = packets_queue_.size();
+void PackHandleH264::StartAu(RtpPacket* pkt) {
+    au_ptr_       = make_media_packet(au_size_hint_);
+    au_timestamp_ = pkt->GetTimestamp();
+    au_start_ms_  = pkt->GetLocalMs();
+    au_key_frame_ = false;
+    au_has_slice_ = false;
+    fua_started_  = false;
+}
+
+//append the start code and the nalu, the access unit delimiter is dropped
+void PackHandleH264::AppendNalu(const uint8_t* data, size_t len) {
+    uint8_t nal_type = data[0] & 0x1f;
+
+    if (nal_type == kAvcNaluTypeAccessUnitDelimiter) {
+        return;
+    }
+    if (nal_type == kAvcNaluTypeIDR) {
+        au_key_frame_ = true;
+    }
+    if ((nal_type != kAvcNaluTypeSPS) && (nal_type != kAvcNaluTypePPS)) {
+        au_has_slice_ = true;
+    }
+    au_ptr_->buffer_ptr_->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
+    au_ptr_->buffer_ptr_->AppendData((char*)data, len);
+}
+
+void PackHandleH264::CheckAuTimeout() {
+    if (!au_ptr_) {
+        return;
+    }
     int64_t now_ms = now_millisec();
-    for (size_t index = 0; index < queue_len; index++) {
-        std::shared_ptr<RtpPacketInfo> pkt_ptr = packets_queue_.front();
-        int64_t pkt_local_ms = pkt_ptr->pkt->GetLocalMs();
-        if ((now_ms - pkt_local_ms) < PACK_BUFFER_TIMEOUT) {
-            break;
-        }
-        packets_queue_.pop_front();
-        LogWarnf(logger_, "h264 fua list is timeout, packet pop seq:%d", pkt_ptr->pkt->GetSeq());
+
+    if ((now_ms - au_start_ms_) < PACK_BUFFER_TIMEOUT) {
+        return;
     }
+    LogWarnf(logger_, "h264 access unit is timeout, timestamp:%u", au_timestamp_);
+    OutputAu();
     return;
 }
 
-bool PackHandleH264::DemuxStapA(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
-    uint8_t* payload_data = pkt_ptr->pkt->GetPayload();
-    size_t payload_length = pkt_ptr->pkt->GetPayloadLength();
-    std::vector<size_t> offsets;
+bool PackHandleH264::DemuxStapA(RtpPacket* pkt) {
+    uint8_t* payload_data = pkt->GetPayload();
+    size_t payload_length = pkt->GetPayloadLength();
 
+    if (fua_started_) {
+        LogErrorf(logger_, "rtp h264 pack error: get stapA before the fua end");
+        return false;
+    }
     if (payload_length <= (sizeof(uint8_t) + H264_STAPA_FIELD_SIZE)) {
         LogErrorf(logger_, "demux stapA error: payload length(%lu) is too short", payload_length);
         return false;
     }
 
-    bool ret = ParseStapAOffsets(payload_data, payload_length, offsets);
-    if (!ret) {
-        return ret;
-    }
-    int64_t dts = (int64_t)pkt_ptr->pkt->GetTimestamp();
-
-    offsets.push_back(payload_length + H264_STAPA_FIELD_SIZE);//end offset.
-    for (size_t index = 0; index < (offsets.size() - 1); index++) {
-        size_t start_offset = offsets[index];
-        size_t end_offset = offsets[index + 1] - H264_STAPA_FIELD_SIZE;
-        if ((end_offset - start_offset) < sizeof(uint8_t)) {
-            LogErrorf(logger_, "demux stapA error: start offset:%lu, end offset:%lu",
-                start_offset,  end_offset);
-            return false;
-        }
-        size_t pkt_size = sizeof(NAL_START_CODE) + end_offset - start_offset + 1024;
-        auto h264_pkt_ptr = std::make_shared<Media_Packet>(pkt_size);
-
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)payload_data + start_offset, end_offset - start_offset);
-        h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-        h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-        h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-        h264_pkt_ptr->dts_        = dts;
-        h264_pkt_ptr->pts_        = dts;
-
-        uint8_t nal_type = *(payload_data + start_offset) & 0x1f;
-
-        if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-            h264_pkt_ptr->is_seq_hdr_   = true;
-            h264_pkt_ptr->is_key_frame_ = false;
-        } else if (nal_type == kAvcNaluTypeIDR) {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = true;
-        } else {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = false;
-        }
-        cb_->MediaPacketOutput(h264_pkt_ptr);
-    }
-    return true;
-}
-
-bool PackHandleH264::ParseStapAOffsets(const uint8_t* data, size_t data_len, std::vector<size_t> &offsets) {
-    
-    size_t offset = 1;
-    size_t left_len = data_len;
-    const uint8_t* p = data + offset;
-    left_len -= offset;
+    const uint8_t* p = payload_data + 1;
+    size_t left_len = payload_length - 1;
 
     while (left_len > 0) {
-        if (left_len < sizeof(uint16_t)) {
+        if (left_len < H264_STAPA_FIELD_SIZE) {
             LogErrorf(logger_, "h264 stapA nalu len error: left length(%lu) is not enough.", left_len);
             return false;
         }
         uint16_t nalu_len = ByteStream::Read2Bytes(p);
-        p += sizeof(uint16_t);
-        left_len -= sizeof(uint16_t);
-        if (nalu_len > left_len) {
-            LogErrorf(logger_, "h264 stapA nalu len error: left length(%lu) is smaller than nalu length(%d).",
+        p += H264_STAPA_FIELD_SIZE;
+        left_len -= H264_STAPA_FIELD_SIZE;
+        if ((nalu_len == 0) || (nalu_len > left_len)) {
+            LogErrorf(logger_, "h264 stapA nalu len error: left length(%lu), nalu length(%d).",
                     left_len, nalu_len);
             return false;
         }
+        AppendNalu(p, nalu_len);
         p += nalu_len;
         left_len -= nalu_len;
-        offsets.push_back(offset + H264_STAPA_FIELD_SIZE);
-        offset += H264_STAPA_FIELD_SIZE + nalu_len;
     }
-    
     return true;
 }
 
-bool PackHandleH264::DemuxFua(Media_Packet_Ptr h264_pkt_ptr, int64_t& timestamp) {
-    size_t queue_len = packets_queue_.size();
-    bool has_start = false;
-    bool has_end   = false;
-
-    std::shared_ptr<DataBuffer> buffer_ptr = h264_pkt_ptr->buffer_ptr_;
-    for (size_t index = 0; index < queue_len; index++) {
-        bool start = false;
-        bool end   = false;
-
-        std::shared_ptr<RtpPacketInfo> pkt_ptr = packets_queue_.front();
-        packets_queue_.pop_front();
-
-        timestamp = (int64_t)pkt_ptr->pkt->GetTimestamp();
-        GetStartEndBit(pkt_ptr->pkt, start, end);
-
-        uint8_t* payload   = pkt_ptr->pkt->GetPayload();
-        size_t payload_len = pkt_ptr->pkt->GetPayloadLength();
-        if (index == 0) {
-            if (start) {
-                has_start = true;
-                uint8_t fu_indicator = payload[0];
-                uint8_t fu_header    = payload[1];
-                uint8_t nalu_header  = (fu_indicator & 0xe0) | (fu_header & 0x1f);
-                buffer_ptr->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-                buffer_ptr->AppendData((char*)&nalu_header, sizeof(nalu_header));
-                buffer_ptr->AppendData((char*)payload + 2, payload_len - 2);
-            }
-        } else {
-            if (has_start) {
-                buffer_ptr->AppendData((char*)payload + 2, payload_len - 2);
-            }
-        }
-        if (end) {
-            has_end = true;
-            break;
-        }
+//the fragments are written into the access unit buffer directly
+bool PackHandleH264::DemuxFua(RtpPacket* pkt) {
+    uint8_t* payload   = pkt->GetPayload();
+    size_t payload_len = pkt->GetPayloadLength();
+    bool start = false;
+    bool end   = false;
+
+    if (payload_len < 2) {
+        LogErrorf(logger_, "rtp h264 demux fua error: payload length(%lu) is too short", payload_len);
+        return false;
     }
-    if (!has_start || !has_end) {
-        LogErrorf(logger_, "rtp h264 demux fua error: has start:%d, has end:%d", has_start, has_end);
+    GetStartEndBit(pkt, start, end);
+
+    if (start && end) {//exception happened
+        LogErrorf(logger_, "rtp h264 pack error: both start and end flag are enable");
+        return false;
+    }
+
+    if (start) {
+        if (fua_started_) {
+            LogErrorf(logger_, "rtp h264 pack error: get start rtp packet before the last fua end");
+            return false;
+        }
+        uint8_t fu_indicator = payload[0];
+        uint8_t fu_header    = payload[1];
+        uint8_t nalu_header  = (fu_indicator & 0xe0) | (fu_header & 0x1f);
+
+        AppendNalu(&nalu_header, sizeof(nalu_header));
+        fua_started_ = true;
+    } else if (!fua_started_) {
+        LogErrorf(logger_, "rtp h264 pack error: get fua rtp packet but there is no start rtp packet");
         return false;
     }
+    au_ptr_->buffer_ptr_->AppendData((char*)payload + 2, payload_len - 2);
+
+    if (end) {
+        fua_started_ = false;
+    }
     return true;
 }
-void PackHandleH264::ResetRtpFua() {
-    start_flag_ = false;
-    end_flag_   = false;
-    packets_queue_.clear();
+
+void PackHandleH264::OutputAu() {
+    if (!au_ptr_) {
+        return;
+    }
+    if (fua_started_) {
+        LogWarnf(logger_, "h264 access unit timestamp:%u is dropped, the fua is not complete",
+                au_timestamp_);
+        ResetAu();
+        return;
+    }
+    Media_Packet_Ptr h264_pkt_ptr = au_ptr_;
+    size_t au_len = h264_pkt_ptr->buffer_ptr_->DataLen();
+
+    if (au_len == 0) {
+        ResetAu();
+        return;
+    }
+    h264_pkt_ptr->av_type_      = MEDIA_VIDEO_TYPE;
+    h264_pkt_ptr->codec_type_   = MEDIA_CODEC_H264;
+    h264_pkt_ptr->fmt_type_     = MEDIA_FORMAT_RAW;
+    h264_pkt_ptr->dts_          = au_timestamp_;
+    h264_pkt_ptr->pts_          = au_timestamp_;
+    h264_pkt_ptr->is_key_frame_ = au_key_frame_;
+    //the access unit of parameter sets only(eg: sps+pps in one stap-a) is the sequence header,
+    //the ones in front of the slices are taken by the muxers inline.
+    h264_pkt_ptr->is_seq_hdr_   = !au_has_slice_;
+
+    //25% headroom, but not beyond the buffer pool class which the access unit fits in
+    size_t class_size = BufferPool::GetRealSize(au_len + PRE_RESERVE_HEADER_SIZE) - PRE_RESERVE_HEADER_SIZE;
+    au_size_hint_ = au_len + au_len / 4;
+    if (au_size_hint_ > class_size) {
+        au_size_hint_ = class_size;
+    }
+    if (au_size_hint_ < H264_AU_MIN_SIZE) {
+        au_size_hint_ = H264_AU_MIN_SIZE;
+    }
+    ResetAu();
+
+    cb_->MediaPacketOutput(h264_pkt_ptr);
+}
+
+void PackHandleH264::ResetAu() {
+    au_ptr_.reset();
+    au_key_frame_ = false;
+    au_has_slice_ = false;
+    fua_started_  = false;
 }
 
 }
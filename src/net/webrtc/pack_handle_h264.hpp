@@ -1,13 +1,20 @@
 #ifndef H264_PACK_HANDLE_HPP
 #define H264_PACK_HANDLE_HPP
 #include "pack_handle_pub.hpp"
+#include "data_buffer.hpp"
 #include "rtp_packet.hpp"
 #include "timer.hpp"
 #include "logger.hpp"
-#include <queue>
 
 namespace cpp_streamer
 {
+//the min size of the access unit buffer, the buffer grows when the frame is bigger.
+//with the reserved header it's in the 16KB class of the buffer pool.
+#define H264_AU_MIN_SIZE (16*1024 - PRE_RESERVE_HEADER_SIZE)
+
+//the rtp packets of an access unit(the nalus which share the timestamp, until the
+//marker bit) are depacketized into one annexb frame buffer, which is output as one
+//media packet. the buffer size follows the last access unit.
 class PackHandleH264 : public PackHandleBase, public TimerInterface
 {
 public:
@@ -19,25 +26,35 @@ public:
 
 public:
     virtual void OnTimer() override;
-    
+
 private:
     void GetStartEndBit(RtpPacket* pkt, bool& start, bool& end);
-    void ResetRtpFua();
-    bool DemuxFua(Media_Packet_Ptr h264_pkt_ptr, int64_t& timestamp);
-    bool DemuxStapA(std::shared_ptr<RtpPacketInfo>);
-    bool ParseStapAOffsets(const uint8_t* data, size_t data_len, std::vector<size_t> &offsets);
-    void CheckFuaTimeout();
+    void StartAu(RtpPacket* pkt);
+    void AppendNalu(const uint8_t* data, size_t len);
+    bool DemuxFua(RtpPacket* pkt);
+    bool DemuxStapA(RtpPacket* pkt);
+    void OutputAu();
+    void ResetAu();
+    void CheckAuTimeout();
     void ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr);
-    
+
 private:
     bool init_flag_  = false;
-    bool start_flag_ = false;
-    bool end_flag_   = false;
     int64_t last_extend_seq_ = 0;
-    std::deque<std::shared_ptr<RtpPacketInfo>> packets_queue_;
     PackCallbackI* cb_ = nullptr;
     int64_t report_lost_ts_ = -1;
 
+private://the access unit in depacketizing
+    Media_Packet_Ptr au_ptr_;
+    uint32_t au_timestamp_ = 0;
+    int64_t au_start_ms_   = 0;
+    bool au_key_frame_     = false;
+    bool au_has_slice_     = false;
+    bool fua_started_      = false;
+    bool drop_timestamp_   = false;//drop the packets of the broken access unit
+    uint32_t drop_ts_      = 0;
+    size_t au_size_hint_   = H264_AU_MIN_SIZE;
+
 private:
     Logger* logger_ = nullptr;
 };
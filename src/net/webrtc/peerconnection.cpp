@@ -7,6 +7,8 @@
 #include "rtcp_xr_dlrr.hpp"
 #include "rtcp_xr_rrt.hpp"
 #include "rtcpfb_nack.hpp"
+#include "rtcpfb_tcc.hpp"
+#include "rtcp_remb.hpp"
 #include "srtp_session.hpp"
 #include "uuid.hpp"
 #include "byte_crypto.hpp"
@@ -21,19 +23,26 @@
 namespace cpp_streamer
 {
 #define RTCP_RR_INTERVAL (1*1000)
+//the rtcp timer, the nack requests are batched in it
+#define PC_TIMER_INTERVAL 20
 
 PeerConnection::PeerConnection(uv_loop_t* loop, 
-        Logger* logger, PCStateReportI* state_report):TimerInterface(loop, 300)
+        Logger* logger, PCStateReportI* state_report, bool udp_batch):TimerInterface(loop, PC_TIMER_INTERVAL)
                                                       , loop_(loop)
                                                       , logger_(logger)
                                                       , state_report_(state_report)
                                                       , dtls_(this, logger)
                                                       , offer_sdp_(&dtls_, logger)
                                                       , answer_sdp_(&dtls_, logger)
+                                                      , bwe_(logger)
+                                                      , remote_bwe_(logger)
                                                       , jb_video_(MEDIA_VIDEO_TYPE, this, loop, logger)
                                                       , jb_audio_(MEDIA_AUDIO_TYPE, this, loop, logger)
 {
-    udp_client_ = new UdpClient(loop, this, logger, nullptr, 0);
+    udp_client_ = new UdpClient(loop, this, logger, nullptr, 0, udp_batch);
+    pacer_ = new RtcPacer(loop, this, logger);
+    jb_video_.SetPacketPool(&rtp_pool_);
+    jb_audio_.SetPacketPool(&rtp_pool_);
     dtls_.udp_client_ = udp_client_;
 
     memset(&last_xr_ntp_, 0, sizeof(last_xr_ntp_));
@@ -45,6 +54,10 @@ PeerConnection::~PeerConnection()
 {
     LogInfof(logger_, "destruct PeerConnection");
     StopTimer();
+    if (pacer_) {
+        delete pacer_;
+        pacer_ = nullptr;
+    }
     if (udp_client_) {
         delete udp_client_;
         udp_client_ = nullptr;
@@ -454,6 +467,11 @@ int PeerConnection::HandleRtcpRtpFb(uint8_t* data, int data_len) {
             }
             break;
         }
+        case FB_RTP_TCC:
+        {
+            HandleRtcpTcc(data, data_len);
+            break;
+        }
         default:
         {
             LogWarnf(logger_, "receive rtcp psfb format(%d) is not handled.", header->fmt);
@@ -463,6 +481,30 @@ int PeerConnection::HandleRtcpRtpFb(uint8_t* data, int data_len) {
     return data_len;
 }
 
+void PeerConnection::HandleRtcpTcc(uint8_t* data, int data_len) {
+    if (tcc_ext_id_ == 0) {
+        return;
+    }
+    RtcpFbTcc* tcc_pkt = nullptr;
+    try {
+        tcc_pkt = RtcpFbTcc::Parse(data, data_len);
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "rtcp feedback tcc error:%s", e.what());
+        return;
+    }
+    int64_t now_ms = now_millisec();
+
+    if (video_send_stream_) {
+        bwe_.UpdateRtt(video_send_stream_->GetRtt());
+    } else if (audio_send_stream_) {
+        bwe_.UpdateRtt(audio_send_stream_->GetRtt());
+    }
+    if (bwe_.OnTransportFeedback(tcc_pkt, now_ms)) {
+        UpdatePacingRate();
+    }
+    delete tcc_pkt;
+}
+
 int PeerConnection::HandleRtcpPsFb(uint8_t* data, int data_len) {
 
     return data_len;
@@ -663,7 +705,9 @@ void PeerConnection::HandleRtpData(uint8_t* data, size_t len) {
             return;
         }
 
-        RtpPacket* pkt = RtpPacket::Parse(data, len);
+        //parsed on the stack, the jitter buffer copies it into the packet pool
+        RtpPacketHolder holder;
+        RtpPacket* pkt = holder.Parse(data, len);
         if (!pkt) {
             return;
         }
@@ -671,6 +715,13 @@ void PeerConnection::HandleRtpData(uint8_t* data, size_t len) {
         if (mspull_ && ssrc == 1234) {
             return;//discard ssrc=1234 which is test ssrc.
         }
+        if (abs_time_ext_id_ > 0) {
+            uint32_t abs_time_24bits = 0;
+            pkt->SetAbsTimeExtensionId(abs_time_ext_id_);
+            if (pkt->ReadAbsTime(abs_time_24bits)) {
+                remote_bwe_.OnRtpPacket(abs_time_24bits, len, now_microsec());
+            }
+        }
         if (video_recv_stream_ && (ssrc == video_recv_stream_->GetSsrc() || ssrc == video_recv_stream_->GetRtxSsrc())) {
             video_recv_stream_->HandleRtpPacket(pkt);
             jb_video_.InputRtpPacket(video_recv_stream_->GetClockRate(), pkt);
@@ -739,18 +790,112 @@ void PeerConnection::OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
     return;
 }
 
-void PeerConnection::SendRtpPacket(uint8_t* data, size_t len) {
+void PeerConnection::SetPacingRate(int64_t target_kbps, int64_t burst_ms) {
+    pacing_kbps_     = target_kbps;
+    pacing_burst_ms_ = burst_ms;
+    UpdatePacingRate();
+}
+
+int64_t PeerConnection::GetTargetBitrate() {
+    if ((tcc_ext_id_ == 0) || !bwe_.IsActive()) {
+        return 0;
+    }
+    return bwe_.GetTargetKbps();
+}
+
+size_t PeerConnection::GetMemoryUsage() {
+    size_t usage = sizeof(PeerConnection);
+
+    usage += rtp_pool_.GetMemoryUsage();
+    usage += jb_video_.GetMemoryUsage() + jb_audio_.GetMemoryUsage();
+    usage += bwe_.GetMemoryUsage();
+    if (udp_client_) {
+        usage += udp_client_->GetMemoryUsage();
+    }
+    if (pacer_) {
+        usage += pacer_->GetMemoryUsage();
+    }
+    if (video_recv_stream_) {
+        usage += video_recv_stream_->GetMemoryUsage();
+    }
+    if (audio_recv_stream_) {
+        usage += audio_recv_stream_->GetMemoryUsage();
+    }
+    if (video_send_stream_) {
+        usage += video_send_stream_->GetMemoryUsage();
+    }
+    if (audio_send_stream_) {
+        usage += audio_send_stream_->GetMemoryUsage();
+    }
+    return usage;
+}
+
+void PeerConnection::UpdatePacingRate() {
+    int64_t kbps = pacing_kbps_;
+
+    if ((kbps <= 0) && (tcc_ext_id_ > 0) && bwe_.IsActive()) {
+        kbps = (int64_t)(bwe_.GetTargetKbps() * BWE_PACING_FACTOR);
+    }
+    //the small changes of the estimate are not applied
+    int64_t current_kbps = pacer_->GetTargetKbps();
+    if ((kbps > 0) && (current_kbps > 0) &&
+        (kbps * 20 > current_kbps * 19) && (kbps * 20 < current_kbps * 21)) {
+        return;
+    }
+    if ((kbps <= 0) && (current_kbps <= 0)) {
+        return;
+    }
+    pacer_->SetPacingRate(kbps, pacing_burst_ms_);
+}
+
+void PeerConnection::SetSendTccExtensionId(int id) {
+    if ((id <= 0) || (id > 14)) {
+        LogInfof(logger_, "transport-wide-cc is not negotiated, ext id:%d", id);
+        return;
+    }
+    tcc_ext_id_ = (uint8_t)id;
+    if (video_send_stream_) {
+        video_send_stream_->SetTccExtensionId(tcc_ext_id_);
+    }
+    if (audio_send_stream_) {
+        audio_send_stream_->SetTccExtensionId(tcc_ext_id_);
+    }
+}
+
+void PeerConnection::SendRtpPacket(uint8_t* data, size_t len, RTP_PACING_PRIORITY priority) {
+    pacer_->SendRtpPacket(data, len, priority);
+}
+
+void PeerConnection::OnPacedRtpPacket(uint8_t* data, size_t len) {
     if(!write_srtp_) {
         LogErrorf(logger_, "write_srtp is not ready");
         return;
     }
     
-    bool ret = write_srtp_->EncryptRtp(const_cast<uint8_t**>(&data), &len);
+    //protect in the udp send slot, the datagram is not copied again before sending
+    size_t capacity = len + SRTP_MAX_TRAILER_LEN;
+    uint8_t* slot = (uint8_t*)udp_client_->ReserveWrite(capacity, dtls_.remote_address_);
+
+    memcpy(slot, data, len);
+    if (tcc_ext_id_ > 0) {
+        //the transport-wide seq is written at the sending time, it's new for the resent packet.
+        //the send streams put the tcc element at the fixed place(RtcSendStream::GetSendPayload)
+        RtpCommonHeader* header = (RtpCommonHeader*)slot;
+        if ((len >= RTP_TCC_SEQ_OFFSET + 2) && header->extension
+            && (slot[RTP_TCC_SEQ_OFFSET - 1] == (uint8_t)((tcc_ext_id_ << 4) | 1))) {
+            ByteStream::Write2Bytes(slot + RTP_TCC_SEQ_OFFSET, tcc_seq_);
+            bwe_.OnPacketSent(tcc_seq_++, len, now_microsec());
+        } else {
+            LogErrorf(logger_, "the rtp packet has no tcc element, len:%lu", len);
+        }
+    }
+    bool ret = write_srtp_->EncryptRtpInPlace(slot, &len, capacity);
     if (!ret) {
+        udp_client_->CancelWrite();
         LogErrorf(logger_, "encrypt_rtp error");
         return;
     }
-    udp_client_->Write((char*)data, len, dtls_.remote_address_);
+    udp_client_->CommitWrite(len);
     udp_client_->TryRead();
 }
 
@@ -758,12 +903,17 @@ void PeerConnection::SendRtcpPacket(uint8_t* data, size_t len) {
     if(!write_srtp_) {
         return;
     }
-    bool ret = write_srtp_->EncryptRtcp(const_cast<uint8_t**>(&data), &len);
+    size_t capacity = len + SRTCP_MAX_TRAILER_LEN;
+    uint8_t* slot = (uint8_t*)udp_client_->ReserveWrite(capacity, dtls_.remote_address_);
+
+    memcpy(slot, data, len);
+    bool ret = write_srtp_->EncryptRtcpInPlace(slot, &len, capacity);
     if (!ret) {
+        udp_client_->CancelWrite();
         LogErrorf(logger_, "encrypt rtcp error");
         return;
     }
-    udp_client_->Write((char*)data, len, dtls_.remote_address_);
+    udp_client_->CommitWrite(len);
     udp_client_->TryRead();
 }
 
@@ -786,17 +936,16 @@ void PeerConnection::CreateVideoRecvStream() {
             video_recv_stream_ = new RtcRecvStream(MEDIA_VIDEO_TYPE, 
                 ssrc, payload_type, clock_rate,
                 video_nack, rtx_payload, rtx_ssrc, this,
-                logger_, loop_);
+                logger_);
            
         } else {
             video_recv_stream_ = new RtcRecvStream(MEDIA_VIDEO_TYPE, 
                 ssrc, payload_type, clock_rate, 
-                video_nack, this, logger_, loop_);
+                video_nack, this, logger_);
         }
         video_recv_stream_->RequestKeyFrame(-1);
     }
-
-
+    UpdateAbsTimeExtensionId();
 }
 
 void PeerConnection::CreateAudioRecvStream() {
@@ -812,18 +961,28 @@ void PeerConnection::CreateAudioRecvStream() {
     if (answer_sdp_.GetAudioSsrc() > 0) {
         audio_recv_stream_ = new RtcRecvStream(MEDIA_AUDIO_TYPE, 
                 ssrc, payload_type, clock_rate,
-                audio_nack, this, logger_, loop_);
+                audio_nack, this, logger_);
         audio_recv_stream_->SetChannel(answer_sdp_.channel_);
     }
+    UpdateAbsTimeExtensionId();
 
     return;
 }
 
+//the recv streams are created by whep in one step, or one by one by mspull
+void PeerConnection::UpdateAbsTimeExtensionId() {
+    int abs_time_id = GetAnswerExtensionId(ABS_SEND_TIME_EXT_URI);
+    if ((abs_time_id <= 0) || (abs_time_id >= 15) || (abs_time_id == abs_time_ext_id_)) {
+        return;
+    }
+    abs_time_ext_id_ = (uint8_t)abs_time_id;
+    LogInfof(logger_, "receive side bwe is enable by abs-send-time id:%d", abs_time_id);
+}
+
 void PeerConnection::CreateRecvStream() {
     CreateVideoRecvStream();
     CreateAudioRecvStream();
     return;
-
 }
 
 void PeerConnection::CreateSendStream() {
@@ -866,9 +1025,19 @@ void PeerConnection::CreateSendStream() {
         audio_send_stream_->SetChannel(answer_sdp_.channel_);
     }
 
+    SetSendTccExtensionId(GetAnswerExtensionId(TCC_EXT_URI));
     return;
 }
 
+int PeerConnection::GetAnswerExtensionId(const std::string& uri) {
+    for (auto& item : answer_sdp_.ext_map_) {
+        if (item.second.desc.find(uri) == 0) {
+            return item.first;
+        }
+    }
+    return -1;
+}
+
 void PeerConnection::CreateSendStream2() {
     bool video_nack = offer_sdp_.IsVideoNackEnable();
     bool audio_nack = offer_sdp_.IsAudioNackEnable();
@@ -907,6 +1076,8 @@ void PeerConnection::CreateSendStream2() {
                 audio_nack, this, logger_);
         audio_send_stream_->SetChannel(offer_sdp_.channel_);
     }
+    //the extension ids of the offer are in the producer rtp parameters
+    SetSendTccExtensionId(offer_sdp_.em_tcc_);
     return;
 }
 
@@ -950,7 +1121,13 @@ void PeerConnection::OnTimer() {
     if (video_recv_stream_) {
         video_recv_stream_->OnTimer(now_ms);
     }
+
+    if (audio_recv_stream_) {
+        audio_recv_stream_->OnTimer(now_ms);
+    }
+    UpdateJitterBufferRtt();
     SendRr(now_ms);
+    SendRemb(now_ms);
     SendXrDlrr(now_ms);
 
     OnStatics(now_ms);
@@ -1002,6 +1179,50 @@ void PeerConnection::SendRr(int64_t now_ms) {
     }
 }
 
+//the jitter buffer holds the packets for the nack resend in a rtt
+void PeerConnection::UpdateJitterBufferRtt() {
+    if (video_recv_stream_) {
+        if (!video_recv_stream_->IsNackEnable()) {
+            jb_video_.UpdateRtt(0);
+        } else if (video_recv_stream_->IsRttValid()) {
+            jb_video_.UpdateRtt(video_recv_stream_->GetRtt());
+        }
+    }
+    if (audio_recv_stream_) {
+        if (!audio_recv_stream_->IsNackEnable()) {
+            jb_audio_.UpdateRtt(0);
+        } else if (audio_recv_stream_->IsRttValid()) {
+            jb_audio_.UpdateRtt(audio_recv_stream_->GetRtt());
+        }
+    }
+}
+
+void PeerConnection::SendRemb(int64_t now_ms) {
+    if ((abs_time_ext_id_ == 0) || !remote_bwe_.IsActive()) {
+        return;
+    }
+    if (video_recv_stream_) {
+        remote_bwe_.UpdateRtt(video_recv_stream_->GetRtt());
+    }
+
+    int64_t bitrate_bps = 0;
+    if (!remote_bwe_.OnRembTimer(now_ms, bitrate_bps)) {
+        return;
+    }
+
+    RtcpRemb remb_pkt;
+    remb_pkt.SetSenderSsrc(1);
+    remb_pkt.SetBitrate((uint64_t)bitrate_bps);
+    if (video_recv_stream_) {
+        remb_pkt.AddSsrc(video_recv_stream_->GetSsrc());
+    }
+    if (audio_recv_stream_) {
+        remb_pkt.AddSsrc(audio_recv_stream_->GetSsrc());
+    }
+    uint8_t* data = remb_pkt.Serial();
+    SendRtcpPacket(data, remb_pkt.GetDataLen());
+}
+
 void PeerConnection::SendXrDlrr(int64_t now_ms) {
     XrDlrr dlrr_obj;
 
@@ -1102,6 +1323,82 @@ void PeerConnection::OnStatics(int64_t now_ms) {
         Report("audio_statics", ss.str());
     }
 
+    if (pacer_->IsEnable()) {
+        int64_t avg_delay_ms = 0;
+        int64_t max_delay_ms = 0;
+        int64_t pacing_kbps  = 0;
+        std::stringstream ss;
+
+        pacer_->GetStatics(now_ms, avg_delay_ms, max_delay_ms, pacing_kbps);
+        ss << "{";
+        ss << "\"target_kbps\":" << pacer_->GetTargetKbps() << ",";
+        ss << "\"pacing_kbps\":" << pacing_kbps << ",";
+        ss << "\"queue_delay_ms\":" << avg_delay_ms << ",";
+        ss << "\"queue_delay_max_ms\":" << max_delay_ms << ",";
+        ss << "\"queue_packets\":" << pacer_->QueuePackets() << ",";
+        ss << "\"queue_bytes\":" << pacer_->QueueBytes();
+        ss << "}";
+        Report("pacer_statics", ss.str());
+    }
+
+    if ((tcc_ext_id_ > 0) && bwe_.IsActive()) {
+        std::stringstream ss;
+
+        ss << "{";
+        ss << "\"target_kbps\":" << bwe_.GetTargetKbps() << ",";
+        ss << "\"delay_kbps\":" << bwe_.GetDelayKbps() << ",";
+        ss << "\"loss_kbps\":" << bwe_.GetLossKbps() << ",";
+        ss << "\"acked_kbps\":" << bwe_.GetAckedKbps() << ",";
+        ss << "\"lost\":" << bwe_.GetLossRate() << ",";
+        ss << "\"usage\":\"" << BweUsageString(bwe_.GetUsage()) << "\"";
+        ss << "}";
+        Report("bwe_statics", ss.str());
+    }
+
+    if ((abs_time_ext_id_ > 0) && remote_bwe_.IsActive()) {
+        std::stringstream ss;
+
+        ss << "{";
+        ss << "\"remb_kbps\":" << remote_bwe_.GetBitrateKbps() << ",";
+        ss << "\"incoming_kbps\":" << remote_bwe_.GetIncomingKbps() << ",";
+        ss << "\"usage\":\"" << BweUsageString(remote_bwe_.GetUsage()) << "\"";
+        ss << "}";
+        Report("recv_bwe_statics", ss.str());
+    }
+
+    {
+        std::stringstream ss;
+        BUFFER_POOL_STATICS pool_statics;
+
+        //the buffer pool counters are of the whole process
+        BufferPool::GetStatics(pool_statics);
+        ss << "{";
+        ss << "\"total_bytes\":" << GetMemoryUsage() << ",";
+        ss << "\"packet_bytes\":" << rtp_pool_.GetMemoryUsage() << ",";
+        ss << "\"udp_bytes\":" << (udp_client_ ? udp_client_->GetMemoryUsage() : 0) << ",";
+        ss << "\"pacer_bytes\":" << (pacer_ ? pacer_->GetMemoryUsage() : 0) << ",";
+        ss << "\"packets\":" << rtp_pool_.InUseCount() << ",";
+        ss << "\"pool_hit\":" << pool_statics.hit_count << ",";
+        ss << "\"pool_miss\":" << pool_statics.miss_count << ",";
+        ss << "\"pool_bytes\":" << pool_statics.bytes_outstanding;
+        ss << "}";
+        Report("memory_statics", ss.str());
+    }
+
+    if (video_recv_stream_ || audio_recv_stream_) {
+        std::stringstream ss;
+
+        ss << "{";
+        ss << "\"v_hold_ms\":" << jb_video_.GetHoldMs() << ",";
+        ss << "\"v_jitter_ms\":" << jb_video_.GetJitterMs() << ",";
+        ss << "\"v_buffered\":" << jb_video_.GetBufferedCount() << ",";
+        ss << "\"a_hold_ms\":" << jb_audio_.GetHoldMs() << ",";
+        ss << "\"a_jitter_ms\":" << jb_audio_.GetJitterMs() << ",";
+        ss << "\"a_buffered\":" << jb_audio_.GetBufferedCount();
+        ss << "}";
+        Report("jitter_buffer_statics", ss.str());
+    }
+
     if (video_recv_stream_) {
         size_t vkps = 0;
         size_t vpps = 0;
@@ -1733,17 +2030,12 @@ void PeerConnection::PackHandleReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
 void PeerConnection::MediaPacketOutput(std::shared_ptr<Media_Packet> pkt_ptr) {
     if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
         pkt_ptr->dts_ = pkt_ptr->pts_ = pkt_ptr->dts_ * 1000 / video_recv_stream_->GetClockRate();
-        uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
-        int pos = GetNaluTypePos(p);
-
-        if(H264_IS_AUD(p[pos])) {
-            return;
-        }
+        //the whole access unit, which is flagged by the h264 pack handle
         if (find_keyframe_) {
-            if (!H264_IS_KEYFRAME(p[pos])) {
+            if (!pkt_ptr->is_key_frame_) {
                 return;
             }
-            find_keyframe_ = false;;
+            find_keyframe_ = false;
         }
     } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
         pkt_ptr->dts_ = pkt_ptr->pts_ = pkt_ptr->dts_ * 1000 / audio_recv_stream_->GetClockRate();
@@ -8,6 +8,9 @@
 #include "rtc_send_stream.hpp"
 #include "rtc_recv_stream.hpp"
 #include "jitterbuffer.hpp"
+#include "rtc_pacer.hpp"
+#include "send_side_bwe.hpp"
+#include "remote_bitrate_estimator.hpp"
 #include "timer.hpp"
 #include "rtcp_xr_dlrr.hpp"
 #include "pack_handle_pub.hpp"
@@ -15,6 +18,11 @@
 
 namespace cpp_streamer
 {
+#define TCC_EXT_URI "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+#define ABS_SEND_TIME_EXT_URI "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time"
+//the pacing rate by the estimated bitrate, the pacer smooths the bursts(eg: keyframe)
+#define BWE_PACING_FACTOR 2.5
+
 typedef enum {
     MID_TYPE,
     RTP_STREAMID_TYPE,
@@ -37,9 +45,9 @@ inline RTP_EXT_TYPE GetRtpExtType(const std::string& uri) {
         ret_type = RTP_STREAMID_TYPE;
     } else if (uri == "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id") {
         ret_type = RP_RTP_STREAMID_TYPE;
-    } else if (uri == "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time") {
+    } else if (uri == ABS_SEND_TIME_EXT_URI) {
         ret_type = ABS_SEND_TIME_TYPE;
-    } else if (uri == "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01") {
+    } else if (uri == TCC_EXT_URI) {
         ret_type = TCC_WIDE_TYPE;
     } else if (uri == "urn:ietf:params:rtp-hdrext:ssrc-audio-level") {
         ret_type = SSRC_AUDIO_LEVEL_TYPE;
@@ -101,9 +109,10 @@ class PeerConnection : public UdpSessionCallbackI
     , public TimerInterface
     , public JitterBufferCallbackI
     , public PackCallbackI
+    , public RtcPacerCallbackI
 {
 public:
-    PeerConnection(uv_loop_t* loop, Logger* logger, PCStateReportI* state_report);
+    PeerConnection(uv_loop_t* loop, Logger* logger, PCStateReportI* state_report, bool udp_batch = false);
     virtual ~PeerConnection();
 
 public:
@@ -180,6 +189,16 @@ public:
 
 public:
     void SetMediaCallback(MediaCallbackI* cb) { media_cb_ = cb; }
+    //target_kbps 0: the pacing rate follows the transport-cc estimate if it's
+    //negotiated, otherwise pacing is disabled
+    void SetPacingRate(int64_t target_kbps, int64_t burst_ms = PACER_DEFAULT_BURST_MS);
+    //udp gso for the paced video runs, it falls back to sendmmsg if the kernel rejects it
+    void EnableUdpGso(bool enable) { udp_client_->EnableGso(enable); }
+    //the send side estimate by transport-cc feedback, 0 if it's not active
+    int64_t GetTargetBitrate();
+    //the bytes of the session: the object, the rtp packets in use, and the
+    //jitter buffer rings, nack lists and send histories which grow on demand
+    size_t GetMemoryUsage();
 
 public:
     void OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
@@ -195,9 +214,12 @@ protected:
     virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override;
 
 protected:
-    virtual void SendRtpPacket(uint8_t* data, size_t len) override;
+    virtual void SendRtpPacket(uint8_t* data, size_t len, RTP_PACING_PRIORITY priority) override;
     virtual void SendRtcpPacket(uint8_t* data, size_t len) override;
 
+protected:
+    virtual void OnPacedRtpPacket(uint8_t* data, size_t len) override;
+
 public:
     virtual void RtpPacketReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) override;
     virtual void RtpPacketOutput(std::shared_ptr<RtpPacketInfo> pkt_ptr) override;
@@ -227,6 +249,7 @@ private:
     int HandleRtcpSr(uint8_t* data, int len);
     int HandleRtcpRr(uint8_t* data, int len);
     int HandleRtcpRtpFb(uint8_t* data, int len);
+    void HandleRtcpTcc(uint8_t* data, int len);
     int HandleRtcpPsFb(uint8_t* data, int len);
     int HandleRtcpXr(uint8_t* data, int len);
     int HandleXrDlrr(XrDlrrData* dlrr_block);
@@ -234,6 +257,14 @@ private:
     void SendStun(int64_t now_ms);
     void SendXrDlrr(int64_t now_ms);
     void SendRr(int64_t now_ms);
+    void SendRemb(int64_t now_ms);
+    void UpdateJitterBufferRtt();
+
+private:
+    int GetAnswerExtensionId(const std::string& uri);
+    void UpdateAbsTimeExtensionId();
+    void SetSendTccExtensionId(int id);
+    void UpdatePacingRate();
 
 private:
     uv_loop_t* loop_ = nullptr;
@@ -245,6 +276,7 @@ private:
 
 private:
     UdpClient* udp_client_ = nullptr;
+    RtcPacer* pacer_ = nullptr;
     std::string pc_ipaddr_str_;
     uint16_t pc_udp_port_ = 0;
     RtcDtls dtls_;
@@ -271,7 +303,19 @@ private:
 private:
     int64_t last_statics_ms_ = -1;
 
+private://transport-wide congestion control
+    SendSideBwe bwe_;
+    uint8_t tcc_ext_id_       = 0;
+    uint16_t tcc_seq_         = 0;
+    int64_t pacing_kbps_      = 0;//configured, 0: by the estimate
+    int64_t pacing_burst_ms_  = PACER_DEFAULT_BURST_MS;
+
+private://receive side estimate by abs-send-time, fed back by remb
+    RemoteBitrateEstimator remote_bwe_;
+    uint8_t abs_time_ext_id_ = 0;
+
 private:
+    RtpPacketPool rtp_pool_;//before the jitter buffers, the packets in them are from the pool
     JitterBuffer jb_video_;
     JitterBuffer jb_audio_;
 
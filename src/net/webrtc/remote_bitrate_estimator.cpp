@@ -0,0 +1,56 @@
+#include "remote_bitrate_estimator.hpp"
+
+namespace cpp_streamer
+{
+
+RemoteBitrateEstimator::RemoteBitrateEstimator(Logger* logger):logger_(logger)
+                                                              , delay_bwe_(logger)
+{
+}
+
+RemoteBitrateEstimator::~RemoteBitrateEstimator()
+{
+}
+
+void RemoteBitrateEstimator::OnRtpPacket(uint32_t abs_time_24bits, size_t len, int64_t arrival_us) {
+    int64_t abs_time = (int64_t)(abs_time_24bits & 0xffffff);
+
+    //the abs-send-time wraps in 64s, unwrap it as the signed difference
+    if (last_abs_time_ < 0) {
+        send_time_ticks_ = abs_time;
+    } else {
+        int64_t diff = (abs_time - last_abs_time_) & 0xffffff;
+        if (diff >= 0x800000) {
+            diff -= 0x1000000;
+        }
+        send_time_ticks_ += diff;
+    }
+    last_abs_time_ = abs_time;
+    packet_count_++;
+
+    int64_t send_us = (send_time_ticks_ * 1000000) >> ABS_SEND_TIME_FRACTION_BITS;
+    delay_bwe_.OnPacket(send_us, arrival_us, len, arrival_us / 1000);
+}
+
+bool RemoteBitrateEstimator::OnRembTimer(int64_t now_ms, int64_t& bitrate_bps) {
+    if (packet_count_ == 0) {
+        return false;
+    }
+    delay_bwe_.Update(now_ms);
+    bitrate_bps = delay_bwe_.GetBitrate();
+
+    bool drop = (last_remb_bps_ > 0) &&
+                (bitrate_bps < last_remb_bps_ * (100 - REMB_DROP_PERCENT) / 100);
+    if ((last_remb_ms_ > 0) && (now_ms - last_remb_ms_ < REMB_INTERVAL_MS) && !drop) {
+        return false;
+    }
+    if (drop) {
+        LogDebugf(logger_, "remb estimate drops from %ld kbps to %ld kbps, usage:%s",
+                last_remb_bps_ / 1000, bitrate_bps / 1000, BweUsageString(delay_bwe_.GetUsage()));
+    }
+    last_remb_ms_  = now_ms;
+    last_remb_bps_ = bitrate_bps;
+    return true;
+}
+
+}
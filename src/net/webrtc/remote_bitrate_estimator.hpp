@@ -0,0 +1,55 @@
+#ifndef REMOTE_BITRATE_ESTIMATOR_HPP
+#define REMOTE_BITRATE_ESTIMATOR_HPP
+#include "logger.hpp"
+#include "delay_based_bwe.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer
+{
+
+//abs-send-time: 24bits, 6.18 fixed point seconds
+#define ABS_SEND_TIME_FRACTION_BITS 18
+//the remb is sent in the interval, or at once when the estimate drops
+#define REMB_INTERVAL_MS            1000
+#define REMB_DROP_PERCENT           3
+
+//receive side bandwidth estimation by the abs-send-time extension:
+//the sender's send time and the local arrival time feed the delay based
+//estimate, the result is fed back to the sender by rtcp remb.
+class RemoteBitrateEstimator
+{
+public:
+    RemoteBitrateEstimator(Logger* logger);
+    ~RemoteBitrateEstimator();
+
+public:
+    void UpdateRtt(int64_t rtt_ms) { delay_bwe_.UpdateRtt(rtt_ms); }
+    void OnRtpPacket(uint32_t abs_time_24bits, size_t len, int64_t arrival_us);
+    //update the estimate, return true if the remb should be sent now
+    bool OnRembTimer(int64_t now_ms, int64_t& bitrate_bps);
+
+public:
+    bool IsActive() { return packet_count_ > 0; }
+    int64_t GetBitrateKbps() { return delay_bwe_.GetBitrate() / 1000; }
+    int64_t GetIncomingKbps() { return delay_bwe_.GetIncomingBitrate() / 1000; }
+    BWE_USAGE GetUsage() { return delay_bwe_.GetUsage(); }
+
+private:
+    Logger* logger_ = nullptr;
+    DelayBasedBwe delay_bwe_;
+
+private://abs-send-time unwrap
+    int64_t packet_count_      = 0;
+    int64_t last_abs_time_     = -1;
+    int64_t send_time_ticks_   = 0;//in 1/2^18 seconds
+
+private:
+    int64_t last_remb_ms_  = -1;
+    int64_t last_remb_bps_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include "rtc_pacer.hpp"
+#include "timeex.hpp"
+
+#include <cstring>
+
+namespace cpp_streamer
+{
+
+RtcPacer::RtcPacer(uv_loop_t* loop, RtcPacerCallbackI* cb, Logger* logger):TimerInterface(loop, PACER_INTERVAL_MS)
+                                                                    , logger_(logger)
+                                                                    , cb_(cb)
+{
+}
+
+RtcPacer::~RtcPacer() {
+    StopTimer();
+    for (std::deque<PacedPacket>& queue : queues_) {
+        for (PacedPacket& pkt : queue) {
+            BufferPool::Free(pkt.data, pkt.real_size);
+        }
+        queue.clear();
+    }
+}
+
+void RtcPacer::SetPacingRate(int64_t target_kbps, int64_t burst_ms) {
+    if (target_kbps < 0) {
+        target_kbps = 0;
+    }
+    if (burst_ms <= 0) {
+        burst_ms = PACER_DEFAULT_BURST_MS;
+    }
+    target_bps_  = target_kbps * 1000;
+    burst_bytes_ = target_bps_ / 8 * burst_ms / 1000;
+    if (burst_bytes_ < RTP_PACKET_MAX_SIZE) {
+        burst_bytes_ = RTP_PACKET_MAX_SIZE;
+    }
+    if (budget_bytes_ > burst_bytes_) {
+        budget_bytes_ = burst_bytes_;
+    }
+    LogInfof(logger_, "set pacing rate:%ld kbps, burst:%ld bytes", target_kbps, burst_bytes_);
+
+    if (target_bps_ == 0) {
+        //pacing is disabled, send the queued packets at once
+        Flush();
+    }
+}
+
+//send all the queued packets in the priority order
+void RtcPacer::Flush() {
+    budget_bytes_ = INT64_MAX / 2;
+    Process();
+    budget_bytes_ = 0;
+}
+
+void RtcPacer::SendRtpPacket(uint8_t* data, size_t len, RTP_PACING_PRIORITY priority) {
+    if ((target_bps_ == 0) || (len > RTP_PACKET_MAX_SIZE) || (queue_packets_ >= PACER_MAX_QUEUE_PACKETS)) {
+        //the packet which is not queued must not jump ahead of the queued ones
+        if (queue_packets_ > 0) {
+            LogWarnf(logger_, "pacer flushes %lu queued packets, len:%lu", queue_packets_, len);
+            Flush();
+        }
+        cb_->OnPacedRtpPacket(data, len);
+        return;
+    }
+    int64_t now_us = now_microsec();
+    PacedPacket pkt;
+
+    pkt.data       = BufferPool::Malloc(len, pkt.real_size);
+    pkt.len        = len;
+    pkt.enqueue_us = now_us;
+    memcpy(pkt.data, data, len);
+
+    queues_[priority].push_back(pkt);
+    queue_packets_++;
+    queue_bytes_       += len;
+    queue_alloc_bytes_ += pkt.real_size;
+
+    UpdateBudget(now_us);
+    Process();
+
+    if ((queue_packets_ > 0) && !timer_running_) {
+        timer_running_ = true;
+        StartTimer();
+    }
+}
+
+void RtcPacer::OnTimer() {
+    UpdateBudget(now_microsec());
+    Process();
+
+    //no idle wakeup
+    if (queue_packets_ == 0) {
+        timer_running_ = false;
+        StopTimer();
+    }
+}
+
+//the bitrate to drain the queue in PACER_MAX_QUEUE_MS, which is not less than the target one
+int64_t RtcPacer::GetDrainBps() {
+    int64_t drain_bps = (int64_t)queue_bytes_ * 8 * 1000 / PACER_MAX_QUEUE_MS;
+
+    return (drain_bps > target_bps_) ? drain_bps : target_bps_;
+}
+
+void RtcPacer::UpdateBudget(int64_t now_us) {
+    if (last_update_us_ < 0) {
+        last_update_us_ = now_us;
+        budget_bytes_   = burst_bytes_;
+        return;
+    }
+    int64_t elapsed_us = now_us - last_update_us_;
+    last_update_us_ = now_us;
+    if (elapsed_us <= 0) {
+        return;
+    }
+    budget_bytes_ += GetDrainBps() / 8 * elapsed_us / 1000000;
+    if (budget_bytes_ > burst_bytes_) {
+        budget_bytes_ = burst_bytes_;
+    }
+}
+
+void RtcPacer::Process() {
+    int64_t now_us = now_microsec();
+
+    //audio is small and latency sensitive, it's not held by the budget
+    while (SendOne(queues_[RTP_PACING_PRIORITY_AUDIO], now_us)) {
+    }
+    while (budget_bytes_ > 0) {
+        if (SendOne(queues_[RTP_PACING_PRIORITY_RETRANSMIT], now_us)) {
+            continue;
+        }
+        if (SendOne(queues_[RTP_PACING_PRIORITY_VIDEO], now_us)) {
+            continue;
+        }
+        break;
+    }
+}
+
+bool RtcPacer::SendOne(std::deque<PacedPacket>& queue, int64_t now_us) {
+    if (queue.empty()) {
+        return false;
+    }
+    PacedPacket pkt = queue.front();
+    queue.pop_front();
+
+    queue_packets_--;
+    queue_bytes_       -= pkt.len;
+    queue_alloc_bytes_ -= pkt.real_size;
+    budget_bytes_      -= (int64_t)pkt.len;
+
+    int64_t delay_us = now_us - pkt.enqueue_us;
+    delay_total_us_ += delay_us;
+    if (delay_us > delay_max_us_) {
+        delay_max_us_ = delay_us;
+    }
+    sent_bytes_ += (int64_t)pkt.len;
+    sent_count_++;
+
+    cb_->OnPacedRtpPacket((uint8_t*)pkt.data, pkt.len);
+
+    BufferPool::Free(pkt.data, pkt.real_size);
+    return true;
+}
+
+void RtcPacer::GetStatics(int64_t now_ms, int64_t& avg_delay_ms, int64_t& max_delay_ms, int64_t& pacing_kbps) {
+    avg_delay_ms = (sent_count_ > 0) ? delay_total_us_ / sent_count_ / 1000 : 0;
+    max_delay_ms = delay_max_us_ / 1000;
+    pacing_kbps  = 0;
+    if ((last_statics_ms_ > 0) && (now_ms > last_statics_ms_)) {
+        pacing_kbps = sent_bytes_ * 8 / (now_ms - last_statics_ms_);
+    }
+    last_statics_ms_ = now_ms;
+    sent_bytes_      = 0;
+    sent_count_      = 0;
+    delay_total_us_  = 0;
+    delay_max_us_    = 0;
+}
+
+}
@@ -0,0 +1,103 @@
+#ifndef RTC_PACER_HPP
+#define RTC_PACER_HPP
+#include "logger.hpp"
+#include "timer.hpp"
+#include "rtc_stream_pub.hpp"
+#include "rtprtcp_pub.hpp"
+#include "buffer_pool.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+
+namespace cpp_streamer
+{
+
+#define PACER_INTERVAL_MS        5
+#define PACER_DEFAULT_BURST_MS   20
+//the pacing rate is raised to drain the queue in this time at most
+#define PACER_MAX_QUEUE_MS       300
+#define PACER_MAX_QUEUE_PACKETS  8192
+
+class RtcPacerCallbackI
+{
+public:
+    virtual void OnPacedRtpPacket(uint8_t* data, size_t len) = 0;
+};
+
+//leaky bucket pacer of one peer connection: the budget grows at the target
+//bitrate up to the burst budget, the queued packets are sent while the budget
+//is positive. audio goes first and is not held by the budget, then the
+//retransmissions, then the video.
+//target bitrate 0 disables pacing, the packets are sent at once.
+class RtcPacer : public TimerInterface
+{
+public:
+    RtcPacer(uv_loop_t* loop, RtcPacerCallbackI* cb, Logger* logger);
+    virtual ~RtcPacer();
+
+public:
+    void SetPacingRate(int64_t target_kbps, int64_t burst_ms = PACER_DEFAULT_BURST_MS);
+    int64_t GetTargetKbps() { return target_bps_ / 1000; }
+    bool IsEnable() { return target_bps_ > 0; }
+
+    void SendRtpPacket(uint8_t* data, size_t len, RTP_PACING_PRIORITY priority);
+
+    size_t QueuePackets() { return queue_packets_; }
+    size_t QueueBytes() { return queue_bytes_; }
+    //the buffers of the queued packets, they go back to the buffer pool when sent
+    size_t GetMemoryUsage() { return queue_alloc_bytes_ + queue_packets_ * sizeof(PacedPacket); }
+
+    //the statics since the last call: average queue delay of the sent packets
+    //and the bitrate sent by the pacer.
+    void GetStatics(int64_t now_ms, int64_t& avg_delay_ms, int64_t& max_delay_ms, int64_t& pacing_kbps);
+
+public:
+    virtual void OnTimer() override;
+
+private:
+    class PacedPacket
+    {
+    public:
+        char* data = nullptr;//from the buffer pool
+        size_t len = 0;
+        size_t real_size = 0;
+        int64_t enqueue_us = 0;
+    };
+
+private:
+    void Process();
+    void Flush();
+    void UpdateBudget(int64_t now_us);
+    bool SendOne(std::deque<PacedPacket>& queue, int64_t now_us);
+    int64_t GetDrainBps();
+
+private:
+    Logger* logger_ = nullptr;
+    RtcPacerCallbackI* cb_ = nullptr;
+
+private:
+    int64_t target_bps_    = 0;
+    int64_t burst_bytes_   = 0;
+    int64_t budget_bytes_  = 0;
+    int64_t last_update_us_ = -1;
+    bool timer_running_    = false;
+
+private:
+    std::deque<PacedPacket> queues_[RTP_PACING_PRIORITY_MAX];
+    size_t queue_packets_     = 0;
+    size_t queue_bytes_       = 0;
+    size_t queue_alloc_bytes_ = 0;
+
+private://statics
+    int64_t sent_bytes_      = 0;
+    int64_t sent_count_      = 0;
+    int64_t delay_total_us_  = 0;
+    int64_t delay_max_us_    = 0;
+    int64_t last_statics_ms_ = -1;
+};
+
+}
+
+#endif
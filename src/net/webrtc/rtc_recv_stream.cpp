@@ -6,18 +6,19 @@
 namespace cpp_streamer
 {
 #define REQ_KEYFRAME_INTERVAL (5*1000)
+#define XR_RRT_INTERVAL       300
 
 RtcRecvStream::RtcRecvStream(MEDIA_PKT_TYPE type, 
         uint32_t ssrc, uint8_t payload, 
         int clock_rate, bool nack, 
         RtcSendStreamCallbackI* cb,
-        Logger* logger, uv_loop_t* loop):logger_(logger)
+        Logger* logger):logger_(logger)
                                          , media_type_(type)
                                          , nack_enable_(nack)
                                          , ssrc_(ssrc)
                                          , pt_(payload)
                                          , clock_rate_(clock_rate)
-                                         , nack_generator_(loop, logger, this)
+                                         , nack_generator_(logger, this)
                                          , send_cb_(cb)
 {
     has_rtx_ = false;
@@ -31,13 +32,13 @@ RtcRecvStream::RtcRecvStream(MEDIA_PKT_TYPE type,
         uint32_t ssrc, uint8_t payload, int clock_rate,
         bool nack, uint8_t rtx_payload, uint32_t rtx_ssrc,
         RtcSendStreamCallbackI* cb,
-        Logger* logger, uv_loop_t* loop) :logger_(logger)
+        Logger* logger) :logger_(logger)
                                           , media_type_(type)
                                           , nack_enable_(nack)
                                           , ssrc_(ssrc)
                                           , pt_(payload)
                                           , clock_rate_(clock_rate)
-                                          , nack_generator_(loop, logger, this)
+                                          , nack_generator_(logger, this)
                                           , send_cb_(cb)
 {
     has_rtx_ = true;
@@ -182,14 +183,16 @@ int64_t RtcRecvStream::GetPacketLost() {
     return total_lost_;
 }
 
-void RtcRecvStream::GenerateNackList(const std::vector<uint16_t>& seq_vec) {
-    RtcpFbNack* nack_pkt = new RtcpFbNack(0, ssrc_);
-    nack_pkt->InsertSeqList(seq_vec);
+void RtcRecvStream::GenerateNackBlocks(const std::vector<RtcpNackBlock>& blocks) {
+    for (size_t index = 0; index < blocks.size(); index += RTCP_NACK_BLOCKS_MAX) {
+        RtcpFbNack nack_pkt(0, ssrc_);
 
-    resend_count_ += seq_vec.size();
-    send_cb_->SendRtcpPacket(nack_pkt->GetData(), nack_pkt->GetLen());
-
-    delete nack_pkt;
+        for (size_t i = index; (i < blocks.size()) && (i < index + RTCP_NACK_BLOCKS_MAX); i++) {
+            nack_pkt.InsertBlock(blocks[i].packet_id, blocks[i].lost_bitmap);
+            resend_count_ += 1 + __builtin_popcount(blocks[i].lost_bitmap);
+        }
+        send_cb_->SendRtcpPacket(nack_pkt.GetData(), nack_pkt.GetLen());
+    }
 }
 
 void RtcRecvStream::HandleXrDlrr(XrDlrrData* dlrr_block) {
@@ -210,7 +213,13 @@ void RtcRecvStream::HandleXrDlrr(XrDlrrData* dlrr_block) {
     rtt_float += ((rtt & 0xffff) / 65536.0) * 1000.0;
 
 
-    avg_rtt_ += ((int64_t)rtt_float - avg_rtt_)/5;
+    if (!rtt_valid_) {
+        avg_rtt_   = (int)rtt_float;
+        rtt_valid_ = true;
+    } else {
+        avg_rtt_ += ((int64_t)rtt_float - avg_rtt_)/5;
+    }
+    nack_generator_.UpdateRtt(avg_rtt_);
 
     return;
 }
@@ -256,7 +265,16 @@ RtcpRrBlockInfo* RtcRecvStream::GetRtcpRr(int64_t now_ms) {
 }
 
 void RtcRecvStream::OnTimer(int64_t now_ms) {
-    SendXrRrt(now_ms);
+    if (nack_enable_) {
+        nack_generator_.OnTimer(now_ms);
+    }
+    if (media_type_ != MEDIA_VIDEO_TYPE) {
+        return;
+    }
+    if (now_ms - last_xr_rrt_ms_ >= XR_RRT_INTERVAL) {
+        last_xr_rrt_ms_ = now_ms;
+        SendXrRrt(now_ms);
+    }
     RequestKeyFrame(now_ms);
 }
 
@@ -25,12 +25,12 @@ public:
             uint32_t ssrc, uint8_t payload, 
             int clock_rate, bool nack, 
             RtcSendStreamCallbackI* cb,
-            Logger* logger, uv_loop_t* loop);
+            Logger* logger);
     RtcRecvStream(MEDIA_PKT_TYPE type, 
             uint32_t ssrc, uint8_t payload, int clock_rate,
             bool nack, uint8_t rtx_payload, uint32_t rtx_ssrc,
             RtcSendStreamCallbackI* cb,
-            Logger* logger, uv_loop_t* loop);
+            Logger* logger);
     virtual ~RtcRecvStream();
 
 public:
@@ -56,7 +56,7 @@ public:
     void SendXrRrt(int64_t now_ms);
 
 public:
-    virtual void GenerateNackList(const std::vector<uint16_t>& seq_vec) override;
+    virtual void GenerateNackBlocks(const std::vector<RtcpNackBlock>& blocks) override;
 
 public:
     void HandleRtpPacket(RtpPacket* pkt);
@@ -68,6 +68,10 @@ public:
 
 public:
     uint32_t GetRtt() { return avg_rtt_; }
+    //the nack lists, they are allocated when the first packet is lost
+    size_t GetMemoryUsage() { return nack_generator_.GetMemoryUsage(); }
+    bool IsRttValid() { return rtt_valid_; }//the rtt is measured by xr dlrr
+    bool IsNackEnable() { return nack_enable_; }
     uint32_t GetJitter() { return jitter_; }
     float GetLostRate() { return (float)lost_percent_; }
     void GetStatics(size_t& kbits, size_t& pps);
@@ -117,9 +121,11 @@ private://for rtcp sr
 
 private://for request keyframe
     int64_t last_keyframe_ms_ = -1;
+    int64_t last_xr_rrt_ms_   = -1;
     
 private:
     int avg_rtt_ = 10;
+    bool rtt_valid_ = false;
     int64_t resend_count_ = 0;
     int64_t last_resend_count_ = 0;
     int64_t last_resend_ms_ = -1;
@@ -2,14 +2,13 @@
 #include "h264_h265_header.hpp"
 #include "rtp_h264_pack.hpp"
 #include "opus_header.hpp"
+#include "byte_stream.hpp"
 
 #include "timeex.hpp"
 
 namespace cpp_streamer
 {
 
-#define SEND_BUFFER_SIZE 2048
-
 RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type, 
             uint32_t ssrc, uint8_t payload, 
             int clock_rate, bool nack, 
@@ -28,12 +27,6 @@ RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type,
         .ntp_frac = 0
     };
 
-    send_buffer_.resize(SEND_BUFFER_SIZE);
-    for (auto& item : send_buffer_) {
-        item.last_ms = 0;
-        item.retry_count = 0;
-        item.pkt = nullptr;
-    }
     LogInfof(logger, "RtcSendStream construct type:%s, ssrc:%u, payload:%d, clock rate:%d, nack:%s, rtx disable",
             type == MEDIA_VIDEO_TYPE ? "video" : "audio",
             ssrc, payload, clock_rate,
@@ -60,12 +53,6 @@ RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type,
         .ntp_frac = 0
     };
 
-    send_buffer_.resize(SEND_BUFFER_SIZE);
-    for (auto& item : send_buffer_) {
-        item.last_ms = 0;
-        item.retry_count = 0;
-        item.pkt = nullptr;
-    }
     LogInfof(logger, "RtcSendStream construct type:%s, ssrc:%u, payload:%d, clock rate:%d, nack:%s, rtx enable, rtx payload:%d, rtx ssrc:%u",
             type == MEDIA_VIDEO_TYPE ? "video" : "audio",
             ssrc, payload, clock_rate,
@@ -77,15 +64,13 @@ RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type,
 RtcSendStream::~RtcSendStream()
 {
     LogInfof(logger_, "destruct RtcSendStream %s", avtype_tostring(media_type_).c_str());
+}
 
-    for (auto& item : send_buffer_) {
-        item.last_ms     = 0;
-        item.retry_count = 0;
-        if(item.pkt) {
-            delete item.pkt;
-            item.pkt = nullptr;
-        }
-    }
+void RtcSendStream::SetTccExtensionId(uint8_t id) {
+    tcc_ext_id_ = id;
+    header_len_ = sizeof(RtpCommonHeader) + ((id > 0) ? RTP_TCC_EXT_BLOCK_LEN : 0);
+    LogInfof(logger_, "%s send stream transport-wide-cc extension id:%d",
+            avtype_tostring(media_type_).c_str(), id);
 }
 
 void RtcSendStream::SendPacket(Media_Packet_Ptr pkt_ptr) {
@@ -111,23 +96,18 @@ void RtcSendStream::SendVideoPacket(Media_Packet_Ptr pkt_ptr) {
 
 void RtcSendStream::SendAudioPacket(Media_Packet_Ptr pkt_ptr) {
     uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
-    uint8_t len   = pkt_ptr->buffer_ptr_->DataLen();
+    size_t len    = pkt_ptr->buffer_ptr_->DataLen();
     int64_t ts    = pkt_ptr->dts_;
     ts = ts * clock_rate_ / 1000;
 
-    RtpPacket* pkt = GenerateSinglePackets(data, len);
-
-    pkt->SetPayloadType(pt_);
-    pkt->SetSsrc(ssrc_);
-    pkt->SetSeq(seq_++);
-    pkt->SetTimestamp((uint32_t)ts);
-    pkt->SetMarker(1);
-    //LogInfof(logger_, "send audio packet:%s",
-    //        pkt->Dump().c_str());
-
-    SendAudioRtpPacket(pkt);
+    if (len > RTP_PACKET_MAX_SIZE - header_len_) {
+        LogErrorf(logger_, "audio packet len:%lu is too large", len);
+        return;
+    }
+    uint8_t* payload = GetSendPayload(now_millisec());
 
-    delete pkt;
+    memcpy(payload, data, len);
+    SendSlotPacket(len, (uint32_t)ts, true);
 }
 
 void RtcSendStream::SendH264Packet(Media_Packet_Ptr pkt_ptr) {
@@ -146,9 +126,9 @@ void RtcSendStream::SendH264Packet(Media_Packet_Ptr pkt_ptr) {
         LogDebugf(logger_, "send h264 keyframe len:%lu, pos:%d", len, pos);
     }
 
-    pkt_ptr->buffer_ptr_->ConsumeData(pos);
-    data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
-    len  = pkt_ptr->buffer_ptr_->DataLen();
+    //the payload may be shared with other sinkers, skip the start code without consuming it.
+    data += pos;
+    len  -= pos;
     //LogInfof(logger_, "h264 data:0x%02x",
     //        data[0], data[1], data[2], data[3], data[4]);
     if (pkt_ptr->is_seq_hdr_) {
@@ -169,53 +149,90 @@ void RtcSendStream::SendH264Packet(Media_Packet_Ptr pkt_ptr) {
         return;
     }
 
+    int64_t now_ms = now_millisec();
     if (pkt_ptr->is_key_frame_) {
+        //sps and pps are smaller than 512 bytes, the StapA packet fits the slot
         if (sps_len_ > 0 && pps_len_ > 0) {
-            std::vector<std::pair<uint8_t*, int>> data_vec;
+            uint8_t* payload = GetSendPayload(now_ms);
+            size_t index = 0;
+
+            payload[index++] = (sps_[0] & (kFBit | kNriMask)) | NaluType::kStapA;
+            payload[index++] = (uint8_t)(sps_len_ >> 8);
+            payload[index++] = (uint8_t)sps_len_;
+            memcpy(payload + index, sps_, sps_len_);
+            index += sps_len_;
+            payload[index++] = (uint8_t)(pps_len_ >> 8);
+            payload[index++] = (uint8_t)pps_len_;
+            memcpy(payload + index, pps_, pps_len_);
+            index += pps_len_;
+
+            SendSlotPacket(index, (uint32_t)ts, false);
+        }
+    }
 
-            data_vec.push_back({sps_, sps_len_});
-            data_vec.push_back({pps_, pps_len_});           
+    //the payloads are packetized once for all the send streams of the packet,
+    //only the rtp header is written here, into the nack history slot.
+    RtpFramePayloads_Ptr payloads_ptr = GetH264FramePayloads(pkt_ptr, data, len);
+    for (const RtpPayloadItem& item : payloads_ptr->items_) {
+        uint8_t* payload = GetSendPayload(now_ms);
 
-            //StapA packet
-            RtpPacket* pkt = GenerateStapAPackets(data_vec);
-            pkt->SetPayloadType(pt_);
-            pkt->SetSsrc(ssrc_);
-            pkt->SetSeq(seq_++);
-            pkt->SetTimestamp((uint32_t)ts);
-            pkt->SetMarker(0);
+        item.CopyTo(payload);
+        SendSlotPacket(item.Length(), (uint32_t)ts, item.marker);
+    }
+    return;
+}
 
-            SendVideoRtpPacket(pkt);
-            delete pkt;
-        }
+uint8_t* RtcSendStream::GetSendPayload(int64_t now_ms) {
+    if (nack_enable_ && (media_type_ == MEDIA_VIDEO_TYPE)) {
+        send_slot_ = send_history_.Alloc(seq_, now_ms);
+    } else {
+        scratch_slot_.data = scratch_data_;
+        send_slot_ = &scratch_slot_;
+    }
+    RtpCommonHeader* header = (RtpCommonHeader*)send_slot_->data;
+
+    memset(header, 0, sizeof(RtpCommonHeader));
+    header->version = RTP_VERSION;
+    if (tcc_ext_id_ > 0) {
+        uint8_t* ext = (uint8_t*)(header + 1);
+
+        header->extension = 1;
+        ByteStream::Write2Bytes(ext, 0xBEDE);
+        ByteStream::Write2Bytes(ext + 2, (RTP_TCC_EXT_BLOCK_LEN - 4) / 4);
+        ext[4] = (uint8_t)((tcc_ext_id_ << 4) | 1);//2 bytes value
+        ext[5] = 0;
+        ext[6] = 0;
+        ext[7] = 0;
     }
+    return send_slot_->data + header_len_;
+}
 
-    //single packet
-    if (len <= kPayloadMaxSize) {
-        RtpPacket* pkt = GenerateSinglePackets(data, len);
+HeaderExtension* RtcSendStream::GetExtension(uint8_t* data) {
+    if (tcc_ext_id_ == 0) {
+        return nullptr;
+    }
+    return (HeaderExtension*)(data + sizeof(RtpCommonHeader));
+}
 
-        pkt->SetPayloadType(pt_);
-        pkt->SetSsrc(ssrc_);
-        pkt->SetSeq(seq_++);
-        pkt->SetTimestamp((uint32_t)ts);
-        pkt->SetMarker(1);
+void RtcSendStream::SendSlotPacket(size_t payload_len, uint32_t ts, bool marker) {
+    RtpCommonHeader* header = (RtpCommonHeader*)send_slot_->data;
 
-        SendVideoRtpPacket(pkt);
-        delete pkt;
-        return;
-    }
+    send_slot_->len = header_len_ + payload_len;
+    //the packet refers to the slot, nothing is allocated
+    RtpPacket pkt(header, GetExtension(send_slot_->data),
+            send_slot_->data + header_len_, payload_len, 0, send_slot_->len);
 
-    //fuA packet
-    std::vector<RtpPacket*> fuA_vec = GenerateFuAPackets(data, len);
-    for (auto fuA_pkt : fuA_vec) {
-        fuA_pkt->SetPayloadType(pt_);
-        fuA_pkt->SetSsrc(ssrc_);
-        fuA_pkt->SetSeq(seq_++);
-        fuA_pkt->SetTimestamp((uint32_t)ts);
+    pkt.SetPayloadType(pt_);
+    pkt.SetSsrc(ssrc_);
+    pkt.SetSeq(seq_++);
+    pkt.SetTimestamp(ts);
+    pkt.SetMarker(marker ? 1 : 0);
 
-        SendVideoRtpPacket(fuA_pkt);
-        delete fuA_pkt;
+    if (media_type_ == MEDIA_VIDEO_TYPE) {
+        SendVideoRtpPacket(&pkt);
+    } else {
+        SendAudioRtpPacket(&pkt);
     }
-    return;
 }
 
 void RtcSendStream::SendVideoRtpPacket(RtpPacket* pkt, bool resend) {
@@ -228,11 +245,9 @@ void RtcSendStream::SendVideoRtpPacket(RtpPacket* pkt, bool resend) {
         cb_->SendRtcpPacket(sr->GetData(), sr->GetDataLen());
         delete sr;
     }
-    if (!resend) {
-        SaveBuffer(pkt);
-    }
     statics_.Update(pkt->GetDataLength(), now_millisec());
-    cb_->SendRtpPacket(pkt->GetData(), pkt->GetDataLength());
+    cb_->SendRtpPacket(pkt->GetData(), pkt->GetDataLength(),
+            resend ? RTP_PACING_PRIORITY_RETRANSMIT : RTP_PACING_PRIORITY_VIDEO);
 }
 
 void RtcSendStream::SendAudioRtpPacket(RtpPacket* pkt) {
@@ -246,7 +261,7 @@ void RtcSendStream::SendAudioRtpPacket(RtpPacket* pkt) {
         delete sr;
     }
     statics_.Update(pkt->GetDataLength(), now_millisec());
-    cb_->SendRtpPacket(pkt->GetData(), pkt->GetDataLength());
+    cb_->SendRtpPacket(pkt->GetData(), pkt->GetDataLength(), RTP_PACING_PRIORITY_AUDIO);
 }
 
 void RtcSendStream::OnTimer(int64_t now_ts) {
@@ -273,64 +288,54 @@ RtcpSrPacket* RtcSendStream::GetRtcpSr(int64_t now_ms) {
     return sr_pkt;
 }
 
-void RtcSendStream::SaveBuffer(RtpPacket* pkt) {
-    if (nack_enable_) {
-        size_t index = pkt->GetSeq() % SEND_BUFFER_SIZE;
-        SendRtpPacketInfo& info = send_buffer_[index];
-        if (info.pkt) {
-            delete info.pkt;
-            info.pkt = nullptr;
-        }
-        //LogInfof(logger_, "save buffer seq:%d, index:%lu", pkt->GetSeq(), index);
-        info.pkt         = pkt->Clone(nullptr);
-        info.retry_count = 0;
-        info.last_ms     = 0;
-    }
-}
-
 void RtcSendStream::ResendRtpPacket(uint16_t seq) {
-    size_t index = seq % SEND_BUFFER_SIZE;
+    int64_t now_ms = now_millisec();
 
-    SendRtpPacketInfo& info = send_buffer_[index];
-    if (!info.pkt) {
-        LogWarnf(logger_, "fail to find rtp packet by seq:%d, index:%lu", seq, index);
-        return;
-    }
-    if (info.pkt->GetSeq() != seq) {
-        LogWarnf(logger_, "fail to get rtp packet(%d) by seq:%d, index:%lu", 
-                seq, info.pkt->GetSeq(), index);
+    RtpHistorySlot* slot = send_history_.Find(seq, now_ms);
+    if (!slot) {
+        LogWarnf(logger_, "fail to find rtp packet by seq:%d, history size:%lu, keep ms:%ld",
+                seq, send_history_.Size(), send_history_.GetKeepMs());
         return;
     }
 
-    int64_t now_ms = now_millisec();
-    if (info.last_ms == 0) {
-        info.retry_count = 1;
-        info.last_ms     = now_ms;
+    if (slot->last_ms == 0) {
+        slot->retry_count = 1;
+        slot->last_ms     = now_ms;
     } else {
         float interval = avg_rtt_ > 10 ? avg_rtt_ / 2 : avg_rtt_;
-        if ((float)(now_ms - info.last_ms + 10) < interval) {
+        if ((float)(now_ms - slot->last_ms + 10) < interval) {
             LogDebugf(logger_, "resend too often and ignore nack request, interval:%ld, rtt:%f",
-                    now_ms - info.last_ms, avg_rtt_);
+                    now_ms - slot->last_ms, avg_rtt_);
             return;
         }
-        info.retry_count++;
-        if (info.retry_count > 5) {
-            LogInfof(logger_, "resend times(%d) is too large, seq:%d", info.retry_count,seq);
+        slot->retry_count++;
+        if (slot->retry_count > 5) {
+            LogInfof(logger_, "resend times(%d) is too large, seq:%d", slot->retry_count,seq);
         }
     }
-    info.last_ms = now_ms;
+    slot->last_ms = now_ms;
 
     resend_cnt_++;
     LogDebugf(logger_, "resend packet seq:%d, retry count:%d",
-            seq, info.retry_count);
+            seq, slot->retry_count);
+
+    size_t payload_len = slot->len - header_len_;
     if (!has_rtx_) {
-        SendVideoRtpPacket(info.pkt, true);
+        RtpPacket pkt((RtpCommonHeader*)slot->data, GetExtension(slot->data),
+                slot->data + header_len_, payload_len, 0, slot->len);
+        SendVideoRtpPacket(&pkt, true);
+        return;
+    }
+    if (slot->len + 2 > sizeof(rtx_buffer_)) {
+        LogErrorf(logger_, "rtp packet len:%lu is too large for rtx", slot->len);
         return;
     }
-    RtpPacket* rtx_pkt = info.pkt->Clone();
-    rtx_pkt->RtxMux(rtx_payload_, rtx_ssrc_, rtx_seq_++);
-    SendVideoRtpPacket(rtx_pkt, true);
-    delete rtx_pkt;
+    //the rtx packet is made in the rtx buffer, the history keeps the original one
+    memcpy(rtx_buffer_, slot->data, slot->len);
+    RtpPacket rtx_pkt((RtpCommonHeader*)rtx_buffer_, GetExtension(rtx_buffer_),
+            rtx_buffer_ + header_len_, payload_len, 0, slot->len);
+    rtx_pkt.RtxMux(rtx_payload_, rtx_ssrc_, rtx_seq_++);
+    SendVideoRtpPacket(&rtx_pkt, true);
     return;
 }
 
@@ -366,6 +371,7 @@ void RtcSendStream::HandleRtcpRr(RtcpRrBlockInfo& block) {
     rtt_ += (static_cast<float>(rtt & 0x0000FFFF) / 65536.0) * 1000;
 
     avg_rtt_ += (rtt_ - avg_rtt_) / 4.0;
+    send_history_.UpdateRtt(avg_rtt_);
 
     LogDebugf(logger_, "handle rtcp rr media(%s), ssrc:%u, lost total:%u, lost rate:%.03f, jitter:%u, rtt_:%.02f, avg rtt:%.02f",
             avtype_tostring(media_type_).c_str(), ssrc_, lost_total_, lost_rate_, jitter_, rtt_, avg_rtt_);
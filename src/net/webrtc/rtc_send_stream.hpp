@@ -9,6 +9,7 @@
 #include "rtcpfb_nack.hpp"
 #include "rtcp_xr_rrt.hpp"
 #include "rtc_stream_pub.hpp"
+#include "rtp_send_history.hpp"
 #include "stream_statics.hpp"
 
 #include <vector>
@@ -16,11 +17,10 @@
 namespace cpp_streamer
 {
 
-typedef struct {
-    int retry_count;
-    int64_t last_ms;
-    RtpPacket* pkt;
-} SendRtpPacketInfo;
+//one-byte extension header(4 bytes) + transport-wide-cc element(3 bytes) + padding
+#define RTP_TCC_EXT_BLOCK_LEN 8
+//the offset of the transport-wide seq(2 bytes) in the packet which has the block
+#define RTP_TCC_SEQ_OFFSET (sizeof(RtpCommonHeader) + 5)
 
 class RtcSendStream
 {
@@ -51,6 +51,12 @@ public:
     void SetRtxSsrc(uint32_t ssrc) { rtx_ssrc_ = ssrc; }
     uint32_t GetRtxSsrc() { return rtx_ssrc_; }
 
+    //the transport-wide-cc element is reserved in every packet, and the
+    //seq is written when the packet is sent by the peer connection.
+    //it's set before the first packet.
+    void SetTccExtensionId(uint8_t id);
+    uint8_t GetTccExtensionId() { return tcc_ext_id_; }
+
 public:
     void SendPacket(Media_Packet_Ptr pkt_ptr);
     void OnTimer(int64_t now_ts);
@@ -62,6 +68,7 @@ public:
 
 public:
     uint32_t GetRtt() { return avg_rtt_; }
+    size_t GetMemoryUsage() { return send_history_.GetMemoryUsage(); }
     uint32_t GetJitter() { return jitter_; }
     float GetLostRate() { return lost_rate_; }
     void GetStatics(size_t& kbits, size_t& pps);
@@ -77,9 +84,15 @@ private:
 private:
     void SendVideoRtpPacket(RtpPacket* pkt, bool resend = false);
     void SendAudioRtpPacket(RtpPacket* pkt);
-    void SaveBuffer(RtpPacket* pkt);
     void ResendRtpPacket(uint16_t seq);
 
+private:
+    //the packets are written into the slot: the slot of seq_ in the nack history
+    //for video, otherwise the scratch slot.
+    uint8_t* GetSendPayload(int64_t now_ms);
+    void SendSlotPacket(size_t payload_len, uint32_t ts, bool marker);
+    HeaderExtension* GetExtension(uint8_t* data);
+
 private:
     RtcpSrPacket* GetRtcpSr(int64_t now_ms);
 
@@ -95,6 +108,8 @@ private:
     uint16_t seq_   = 0;
     int clock_rate_ = 0;
     int channel_    = 0;
+    uint8_t tcc_ext_id_ = 0;
+    size_t header_len_  = sizeof(RtpCommonHeader);
 
 private:
     uint8_t rtx_payload_ = 0;
@@ -111,7 +126,11 @@ private:
     int pps_len_ = 0;
 
 private:
-    std::vector<SendRtpPacketInfo> send_buffer_;
+    RtpSendHistory send_history_;
+    RtpHistorySlot scratch_slot_;//the packet which is not kept for nack
+    uint8_t scratch_data_[RTP_PACKET_MAX_SIZE];
+    RtpHistorySlot* send_slot_ = nullptr;
+    uint8_t rtx_buffer_[RTP_PACKET_MAX_SIZE];
 
 private://for rtcp sr
     NTP_TIMESTAMP last_sr_ntp_ts_;
@@ -13,10 +13,19 @@ namespace cpp_streamer
 #define RTT_DEFAULT 30 //ms
 #define RETRANSMIT_MAX_COUNT 20
 
+//the send order of the packets in the pacer
+typedef enum
+{
+    RTP_PACING_PRIORITY_AUDIO = 0,
+    RTP_PACING_PRIORITY_RETRANSMIT,
+    RTP_PACING_PRIORITY_VIDEO,
+    RTP_PACING_PRIORITY_MAX
+} RTP_PACING_PRIORITY;
+
 class RtcSendStreamCallbackI
 {
 public:
-    virtual void SendRtpPacket(uint8_t* data, size_t len) = 0;
+    virtual void SendRtpPacket(uint8_t* data, size_t len, RTP_PACING_PRIORITY priority) = 0;
     virtual void SendRtcpPacket(uint8_t* data, size_t len) = 0;
 };
 
@@ -0,0 +1,115 @@
+#ifndef RTP_PACKET_POOL_HPP
+#define RTP_PACKET_POOL_HPP
+#include "jitterbuffer_pub.hpp"
+#include "buffer_pool.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+namespace cpp_streamer
+{
+
+//the blocks(the shared_ptr control block and the RtpPacketInfo in it) are
+//from the BufferPool of the loop thread, the free blocks are shared by all
+//the peer connections in the loop instead of being cached by each one.
+//the core only counts the blocks in use of one peer connection.
+class RtpPacketPoolCore
+{
+public:
+    RtpPacketPoolCore() = default;
+    ~RtpPacketPoolCore() = default;
+
+public:
+    void* Alloc(size_t size) {
+        size_t real_size = 0;
+        char* block = BufferPool::Malloc(size, real_size);
+
+        in_use_++;
+        in_use_bytes_ += real_size;
+        return block;
+    }
+
+    void Free(void* block, size_t size) {
+        size_t real_size = BufferPool::GetRealSize(size);
+
+        in_use_--;
+        in_use_bytes_ -= real_size;
+        BufferPool::Free((char*)block, real_size);
+    }
+
+public:
+    size_t in_use_       = 0;
+    size_t in_use_bytes_ = 0;
+};
+
+//allocator of std::allocate_shared: the refcount lives in the same pooled
+//block as the RtpPacketInfo, and the block goes back to the buffer pool when
+//the last reference is released(eg: by the depacketizer).
+template <class T>
+class RtpPacketPoolAllocator
+{
+public:
+    typedef T value_type;
+
+    RtpPacketPoolAllocator(std::shared_ptr<RtpPacketPoolCore> core):core_(core)
+    {
+    }
+    template <class U>
+    RtpPacketPoolAllocator(const RtpPacketPoolAllocator<U>& other):core_(other.core_)
+    {
+    }
+
+public:
+    T* allocate(size_t n) {
+        return (T*)core_->Alloc(n * sizeof(T));
+    }
+    void deallocate(T* p, size_t n) {
+        core_->Free(p, n * sizeof(T));
+    }
+
+public:
+    //the blocks in use keep the core alive
+    std::shared_ptr<RtpPacketPoolCore> core_;
+};
+
+template <class T, class U>
+bool operator==(const RtpPacketPoolAllocator<T>& a, const RtpPacketPoolAllocator<U>& b) {
+    return a.core_ == b.core_;
+}
+
+template <class T, class U>
+bool operator!=(const RtpPacketPoolAllocator<T>& a, const RtpPacketPoolAllocator<U>& b) {
+    return a.core_ != b.core_;
+}
+
+//RtpPacketInfo pool of one peer connection, the received packets are copied
+//once into the pooled blocks, and no heap allocation in the steady state.
+class RtpPacketPool
+{
+public:
+    RtpPacketPool():core_(std::make_shared<RtpPacketPoolCore>())
+    {
+    }
+    ~RtpPacketPool() {
+    }
+
+public:
+    std::shared_ptr<RtpPacketInfo> MakePacketInfo(MEDIA_PKT_TYPE media_type,
+            int clock_rate,
+            RtpPacket* input_pkt,
+            int64_t extend_seq) {
+        return std::allocate_shared<RtpPacketInfo>(RtpPacketPoolAllocator<RtpPacketInfo>(core_),
+                                    media_type, clock_rate, input_pkt, extend_seq);
+    }
+
+    size_t InUseCount() { return core_->in_use_; }
+    size_t GetMemoryUsage() { return core_->in_use_bytes_; }
+
+private:
+    std::shared_ptr<RtpPacketPoolCore> core_;
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef RTP_SEND_HISTORY_HPP
+#define RTP_SEND_HISTORY_HPP
+#include "rtprtcp_pub.hpp"
+#include "buffer_pool.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <cstring>
+
+namespace cpp_streamer
+{
+
+//the slots are indexed by seq & (size - 1), size is power of 2
+#define RTP_HISTORY_INIT_SIZE  64
+#define RTP_HISTORY_MAX_SIZE   (32*1024)
+//the sent packets are kept for rtt * RTP_HISTORY_RTT_FACTOR in the range
+#define RTP_HISTORY_RTT_FACTOR 4
+#define RTP_HISTORY_MIN_KEEP_MS 300
+#define RTP_HISTORY_MAX_KEEP_MS 2000
+
+class RtpHistorySlot
+{
+public:
+    uint8_t* data   = nullptr;//RTP_PACKET_MAX_SIZE bytes from the buffer pool, allocated at the first use
+    size_t len      = 0;
+    uint16_t seq    = 0;
+    bool used       = false;
+    int64_t sent_ms = 0;
+    int retry_count = 0;
+    int64_t last_ms = 0;//last resend time
+};
+
+//the sent rtp packets of one stream for nack: the packetizer writes the packet
+//into the slot of its seq, and the same bytes are sent and resent.
+//a slot is reused only when its packet is older than the keep time, otherwise
+//the ring grows, so the history covers rtt based time instead of a fixed count.
+//the ring is allocated at the first packet and the packet buffers are from the
+//buffer pool of the loop thread, so the memory follows the bitrate * keep time.
+class RtpSendHistory
+{
+public:
+    RtpSendHistory(size_t size = RTP_HISTORY_INIT_SIZE) {
+        size_t real_size = 1;
+        while (real_size < size) {
+            real_size <<= 1;
+        }
+        init_size_ = real_size;
+    }
+    ~RtpSendHistory() {
+        for (size_t i = 0; i < size_; i++) {
+            if (slots_[i].data) {
+                BufferPool::Free((char*)slots_[i].data, data_size_);
+            }
+        }
+    }
+
+public:
+    void UpdateRtt(float rtt_ms) {
+        int64_t keep_ms = (int64_t)(rtt_ms * RTP_HISTORY_RTT_FACTOR);
+
+        if (keep_ms < RTP_HISTORY_MIN_KEEP_MS) {
+            keep_ms = RTP_HISTORY_MIN_KEEP_MS;
+        } else if (keep_ms > RTP_HISTORY_MAX_KEEP_MS) {
+            keep_ms = RTP_HISTORY_MAX_KEEP_MS;
+        }
+        keep_ms_ = keep_ms;
+    }
+    int64_t GetKeepMs() { return keep_ms_; }
+    size_t Size() { return size_; }
+
+    size_t GetMemoryUsage() {
+        return size_ * sizeof(RtpHistorySlot) + data_count_ * data_size_;
+    }
+
+    //the slot to write the new packet of seq
+    RtpHistorySlot* Alloc(uint16_t seq, int64_t now_ms) {
+        if (!slots_) {
+            slots_.reset(new RtpHistorySlot[init_size_]);
+            size_ = init_size_;
+        }
+        RtpHistorySlot* slot = &slots_[seq & (size_ - 1)];
+
+        while (slot->used && (slot->seq != seq) &&
+            (now_ms - slot->sent_ms < keep_ms_) && (size_ < RTP_HISTORY_MAX_SIZE)) {
+            Grow();
+            slot = &slots_[seq & (size_ - 1)];
+        }
+        if (!slot->data) {
+            slot->data = (uint8_t*)BufferPool::Malloc(RTP_PACKET_MAX_SIZE, data_size_);
+            data_count_++;
+        }
+        slot->len         = 0;
+        slot->seq         = seq;
+        slot->used        = true;
+        slot->sent_ms     = now_ms;
+        slot->retry_count = 0;
+        slot->last_ms     = 0;
+        return slot;
+    }
+
+    //return nullptr if the packet is overwritten or expired
+    RtpHistorySlot* Find(uint16_t seq, int64_t now_ms) {
+        if (!slots_) {
+            return nullptr;
+        }
+        RtpHistorySlot* slot = &slots_[seq & (size_ - 1)];
+
+        if (!slot->used || (slot->seq != seq) || (now_ms - slot->sent_ms > keep_ms_)) {
+            return nullptr;
+        }
+        return slot;
+    }
+
+private:
+    //the used slots are at the different indexes in the new ring,
+    //so the packet buffers are moved instead of copied.
+    void Grow() {
+        size_t new_size = size_ * 2;
+        std::unique_ptr<RtpHistorySlot[]> new_slots(new RtpHistorySlot[new_size]);
+
+        for (size_t i = 0; i < size_; i++) {
+            RtpHistorySlot& slot = slots_[i];
+            if (!slot.used) {
+                continue;
+            }
+            RtpHistorySlot& new_slot = new_slots[slot.seq & (new_size - 1)];
+            new_slot.data        = slot.data;
+            new_slot.len         = slot.len;
+            new_slot.seq         = slot.seq;
+            new_slot.used        = true;
+            new_slot.sent_ms     = slot.sent_ms;
+            new_slot.retry_count = slot.retry_count;
+            new_slot.last_ms     = slot.last_ms;
+        }
+        slots_.swap(new_slots);
+        size_ = new_size;
+    }
+
+private:
+    std::unique_ptr<RtpHistorySlot[]> slots_;
+    size_t init_size_  = RTP_HISTORY_INIT_SIZE;
+    size_t size_       = 0;
+    size_t data_count_ = 0;
+    size_t data_size_  = 0;//the real size of the packet buffer
+    int64_t keep_ms_   = RTP_HISTORY_MIN_KEEP_MS;
+};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include "send_side_bwe.hpp"
+
+namespace cpp_streamer
+{
+
+SendSideBwe::SendSideBwe(Logger* logger):logger_(logger)
+                                        , delay_bwe_(logger)
+{
+}
+
+SendSideBwe::~SendSideBwe()
+{
+}
+
+void SendSideBwe::SetBitrates(int64_t min_kbps, int64_t start_kbps, int64_t max_kbps) {
+    if ((min_kbps <= 0) || (max_kbps < min_kbps)) {
+        LogErrorf(logger_, "bwe bitrates error, min:%ld kbps, max:%ld kbps", min_kbps, max_kbps);
+        return;
+    }
+    min_bps_    = min_kbps * 1000;
+    max_bps_    = max_kbps * 1000;
+    target_bps_ = ClampBitrate(start_kbps * 1000);
+    loss_bps_   = target_bps_;
+    delay_bwe_.SetBitrates(min_bps_, target_bps_, max_bps_);
+}
+
+void SendSideBwe::UpdateRtt(int64_t rtt_ms) {
+    if (rtt_ms > 0) {
+        rtt_ms_ = rtt_ms;
+    }
+    delay_bwe_.UpdateRtt(rtt_ms);
+}
+
+int64_t SendSideBwe::ClampBitrate(int64_t bps) {
+    if (bps < min_bps_) {
+        return min_bps_;
+    }
+    if (bps > max_bps_) {
+        return max_bps_;
+    }
+    return bps;
+}
+
+void SendSideBwe::OnPacketSent(uint16_t tcc_seq, size_t len, int64_t now_us) {
+    //allocated when the first packet is sent, the receive only sessions don't need it
+    if (!history_) {
+        history_.reset(new SentPacket[BWE_HISTORY_SIZE]);
+    }
+    SentPacket& pkt = history_[tcc_seq & (BWE_HISTORY_SIZE - 1)];
+
+    pkt.seq     = tcc_seq;
+    pkt.used    = true;
+    pkt.len     = len;
+    pkt.send_us = now_us;
+}
+
+bool SendSideBwe::OnTransportFeedback(RtcpFbTcc* fb, int64_t now_ms) {
+    if (!history_) {
+        return false;
+    }
+    int64_t ref_time = (int64_t)fb->GetReferenceTime();
+
+    //the reference time is 24bits, unwrap it as the signed difference
+    if (last_ref_time_ < 0) {
+        arrival_base_us_ = ref_time * TCC_REF_TIME_UNIT_US;
+    } else {
+        int64_t diff = (ref_time - last_ref_time_) & 0xffffff;
+        if (diff >= 0x800000) {
+            diff -= 0x1000000;
+        }
+        arrival_base_us_ += diff * TCC_REF_TIME_UNIT_US;
+    }
+    last_ref_time_ = ref_time;
+    feedback_count_++;
+
+    size_t expected = 0;
+    size_t lost     = 0;
+    for (const TccPacketStatus& status : fb->GetPacketStatus()) {
+        SentPacket& sent_pkt = history_[status.seq & (BWE_HISTORY_SIZE - 1)];
+        if (!sent_pkt.used || (sent_pkt.seq != status.seq)) {
+            continue;
+        }
+        expected++;
+        if (!status.received) {
+            lost++;
+            continue;
+        }
+        delay_bwe_.OnPacket(sent_pkt.send_us, arrival_base_us_ + status.arrival_offset_us,
+                            sent_pkt.len, now_ms);
+        //the packet is reported once
+        sent_pkt.used = false;
+    }
+
+    int64_t last_target_bps = target_bps_;
+
+    delay_bwe_.Update(now_ms);
+    UpdateLossBitrate(expected, lost, now_ms);
+
+    int64_t delay_bps = delay_bwe_.GetBitrate();
+    target_bps_ = ClampBitrate((delay_bps < loss_bps_) ? delay_bps : loss_bps_);
+    if (target_bps_ != last_target_bps) {
+        LogDebugf(logger_, "bwe target:%ld kbps, delay:%ld kbps, loss:%ld kbps, acked:%ld kbps, usage:%s, trend:%.2f, threshold:%.2f",
+                target_bps_ / 1000, delay_bps / 1000, loss_bps_ / 1000, GetAckedKbps(),
+                BweUsageString(delay_bwe_.GetUsage()), delay_bwe_.GetTrend(), delay_bwe_.GetThreshold());
+        return true;
+    }
+    return false;
+}
+
+void SendSideBwe::UpdateLossBitrate(size_t expected, size_t lost, int64_t now_ms) {
+    loss_expected_ += expected;
+    loss_lost_     += lost;
+    if (loss_expected_ < BWE_LOSS_MIN_PACKETS) {
+        return;
+    }
+    loss_rate_ = (float)loss_lost_ / (float)loss_expected_;
+    loss_expected_ = 0;
+    loss_lost_     = 0;
+
+    if (loss_rate_ < 0.02) {
+        //increase 8% in one second
+        if ((last_loss_increase_ms_ < 0) || (now_ms - last_loss_increase_ms_ >= 1000)) {
+            loss_bps_ = ClampBitrate(loss_bps_ * 108 / 100 + 1000);
+            last_loss_increase_ms_ = now_ms;
+        }
+    } else if (loss_rate_ > 0.1) {
+        //decrease once in the time of the loss report, from the acked bitrate:
+        //the source may not follow the estimate, and the decrease is not accumulated
+        if ((last_loss_decrease_ms_ < 0) || (now_ms - last_loss_decrease_ms_ >= 300 + rtt_ms_)) {
+            int64_t base_bps = (target_bps_ < loss_bps_) ? target_bps_ : loss_bps_;
+            if (delay_bwe_.GetIncomingBitrate() > 0) {
+                base_bps = delay_bwe_.GetIncomingBitrate();
+            }
+            loss_bps_ = ClampBitrate((int64_t)(base_bps * (1.0 - 0.5 * loss_rate_)));
+            last_loss_decrease_ms_ = now_ms;
+        }
+    }
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef SEND_SIDE_BWE_HPP
+#define SEND_SIDE_BWE_HPP
+#include "logger.hpp"
+#include "rtcpfb_tcc.hpp"
+#include "delay_based_bwe.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+namespace cpp_streamer
+{
+
+//the sent packets are indexed by transport seq & (size - 1)
+#define BWE_HISTORY_SIZE      8192
+//the loss fraction is updated when the packets are more than it
+#define BWE_LOSS_MIN_PACKETS  20
+
+//send side bandwidth estimation by the transport-wide-cc feedback:
+//the delay based estimate and the loss based estimate, the target bitrate
+//is the lower one.
+class SendSideBwe
+{
+public:
+    SendSideBwe(Logger* logger);
+    ~SendSideBwe();
+
+public:
+    void SetBitrates(int64_t min_kbps, int64_t start_kbps, int64_t max_kbps);
+    void UpdateRtt(int64_t rtt_ms);
+
+    void OnPacketSent(uint16_t tcc_seq, size_t len, int64_t now_us);
+    //return true if the target bitrate is changed
+    bool OnTransportFeedback(RtcpFbTcc* fb, int64_t now_ms);
+
+public:
+    bool IsActive() { return feedback_count_ > 0; }
+    int64_t GetTargetKbps() { return target_bps_ / 1000; }
+    int64_t GetDelayKbps() { return delay_bwe_.GetBitrate() / 1000; }
+    int64_t GetLossKbps() { return loss_bps_ / 1000; }
+    int64_t GetAckedKbps() { return delay_bwe_.GetIncomingBitrate() / 1000; }
+    float GetLossRate() { return loss_rate_; }
+    BWE_USAGE GetUsage() { return delay_bwe_.GetUsage(); }
+    double GetTrend() { return delay_bwe_.GetTrend(); }
+    double GetThreshold() { return delay_bwe_.GetThreshold(); }
+    size_t GetMemoryUsage() { return history_ ? BWE_HISTORY_SIZE * sizeof(SentPacket) : 0; }
+
+private:
+    class SentPacket
+    {
+    public:
+        uint16_t seq    = 0;
+        bool used       = false;
+        size_t len      = 0;
+        int64_t send_us = 0;
+    };
+
+private:
+    void UpdateLossBitrate(size_t expected, size_t lost, int64_t now_ms);
+    int64_t ClampBitrate(int64_t bps);
+
+private:
+    Logger* logger_ = nullptr;
+    DelayBasedBwe delay_bwe_;
+
+private:
+    int64_t min_bps_    = BWE_MIN_KBPS * 1000;
+    int64_t max_bps_    = BWE_MAX_KBPS * 1000;
+    int64_t target_bps_ = BWE_START_KBPS * 1000;
+    int64_t loss_bps_   = BWE_START_KBPS * 1000;
+    int64_t rtt_ms_     = 200;
+
+private://sent packets
+    std::unique_ptr<SentPacket[]> history_;
+
+private://feedback arrival time
+    int64_t feedback_count_  = 0;
+    int64_t last_ref_time_   = -1;
+    int64_t arrival_base_us_ = 0;
+
+private://loss based
+    float loss_rate_               = 0.0;
+    size_t loss_expected_          = 0;
+    size_t loss_lost_              = 0;
+    int64_t last_loss_increase_ms_ = -1;
+    int64_t last_loss_decrease_ms_ = -1;
+};
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "srtp_session.hpp"
 #include "logger.hpp"
 #include <vector>
+#include <mutex>
 #include <cstring>
 #include <netinet/in.h>
 
@@ -41,6 +42,9 @@ bool SRtpSession::init_ = false;
 Logger* SRtpSession::logger_ = nullptr;
 
 void SRtpSession::Init(Logger* logger) {
+    static std::mutex s_init_mutex;
+    std::lock_guard<std::mutex> lock(s_init_mutex);
+
     if (init_) {
         LogInfof(SRtpSession::logger_, "srtp session has been initialized.");
         return;
@@ -238,6 +242,38 @@ bool SRtpSession::DecryptSrtcp(uint8_t* data, size_t* len) {
     return true;
 }
 
+bool SRtpSession::EncryptRtpInPlace(uint8_t* data, size_t* len, size_t capacity) {
+    if (*len + SRTP_MAX_TRAILER_LEN > capacity) {
+        LogErrorf(SRtpSession::logger_, "fail to encrypt RTP packet in place, len:%lu, capacity:%lu", *len, capacity);
+        return false;
+    }
+    int data_len = (int)*len;
+    srtp_err_status_t err = srtp_protect(session_, (void*)data, &data_len);
+
+    if (err != srtp_err_status_ok) {
+        LogErrorf(SRtpSession::logger_, "srtp_protect error: %s", SRtpSession::errors.at(err));
+        return false;
+    }
+    *len = (size_t)data_len;
+    return true;
+}
+
+bool SRtpSession::EncryptRtcpInPlace(uint8_t* data, size_t* len, size_t capacity) {
+    if (*len + SRTCP_MAX_TRAILER_LEN > capacity) {
+        LogErrorf(SRtpSession::logger_, "fail to encrypt RTCP packet in place, len:%lu, capacity:%lu", *len, capacity);
+        return false;
+    }
+    int data_len = (int)*len;
+    srtp_err_status_t err = srtp_protect_rtcp(session_, (void*)data, &data_len);
+
+    if (err != srtp_err_status_ok) {
+        LogErrorf(SRtpSession::logger_, "srtp_protect_rtcp error: %s", SRtpSession::errors.at(err));
+        return false;
+    }
+    *len = (size_t)data_len;
+    return true;
+}
+
 void SRtpSession::RemoveStream(uint32_t ssrc) {
     srtp_remove_stream(session_, (uint32_t)(htonl(ssrc)));
     return;
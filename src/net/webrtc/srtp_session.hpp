@@ -31,6 +31,8 @@ typedef enum
 } SRTP_SESSION_TYPE;
 
 #define SRTP_ENCRYPT_BUFFER_SIZE (10*1024)
+//srtp_protect_rtcp writes the srtcp index after the tag
+#define SRTCP_MAX_TRAILER_LEN (SRTP_MAX_TRAILER_LEN + 4)
 
 class SRtpSession
 {
@@ -47,6 +49,10 @@ public:
     bool DecryptSrtp(uint8_t* data, size_t* len);
     bool EncryptRtcp(uint8_t** data, size_t* len);
     bool DecryptSrtcp(uint8_t* data, size_t* len);
+    //protect in the caller's buffer without copying,
+    //capacity must be at least *len + SRTP_MAX_TRAILER_LEN(SRTCP_MAX_TRAILER_LEN for rtcp).
+    bool EncryptRtpInPlace(uint8_t* data, size_t* len, size_t capacity);
+    bool EncryptRtcpInPlace(uint8_t* data, size_t* len, size_t capacity);
     void RemoveStream(uint32_t ssrc);
 
 private:
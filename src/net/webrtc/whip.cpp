@@ -20,10 +20,13 @@ namespace cpp_streamer
 {
 #define WHIP_NAME "whip"
 
-void SourceWhipData(uv_async_t *handle) {
-    Whip* whip = (Whip*)(handle->data);
-    whip->HandleMediaData();
-}
+std::map<std::string, std::string> Whip::def_options_ = {
+    {"queue_policy", "block"},
+    {"pacing_kbps", "0"},//0: no pacing
+    {"pacing_burst_ms", "20"},
+    {"udp_batch", "false"},//sendmmsg/recvmmsg batching, applied when the network starts
+    {"udp_gso", "false"}//linux udp segment offload, needs udp_batch
+};
 
 Whip::Whip()
 {
@@ -31,11 +34,17 @@ Whip::Whip()
     name_ = WHIP_NAME;
     name_ += "_";
     name_ += UUID::MakeUUID();
+    options_ = def_options_;
 }
 
 Whip::~Whip()
 {
     LogInfof(logger_, "destruct Whip");
+    packet_queue_.Close();
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Remove(this);
+    }
     ReleaseHttpClient();
     if (pc_) {
         delete pc_;
@@ -45,26 +54,27 @@ Whip::~Whip()
 
 
 Media_Packet_Ptr Whip::GetMediaPacket() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return packet_queue_.Pop();
+}
 
-    Media_Packet_Ptr pkt_ptr;
-    if (packet_queue_.empty()) {
-        return pkt_ptr;
-    }
-        
-    pkt_ptr = packet_queue_.front();
-    packet_queue_.pop();
+size_t Whip::OnScheduleRun(size_t budget) {
+    return HandleMediaData(budget);
+}
 
-    return pkt_ptr;
+bool Whip::HasScheduleData() {
+    return packet_queue_.Depth() > 0;
 }
 
-void Whip::HandleMediaData() {
+size_t Whip::HandleMediaData(size_t budget) {
+    size_t count = 0;
+
 
-    while(true) {
+    while(count < budget) {
         Media_Packet_Ptr pkt_ptr = GetMediaPacket();
         if (!pkt_ptr) {
             break;
         }
+        count++;
 
         if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
             pc_->SendVideoPacket(pkt_ptr);
@@ -75,7 +85,11 @@ void Whip::HandleMediaData() {
                     avtype_tostring(pkt_ptr->av_type_).c_str());
         }
     }
-    return;
+    std::string statics;
+    if (report_ && packet_queue_.GetReportStatics(now_millisec(), statics)) {
+        report_->OnReport(name_, "queue_statics", statics);
+    }
+    return count;
 }
 
 void Whip::ReleaseHttpClient() {
@@ -106,14 +120,26 @@ int Whip::RemoveSinker(const std::string& name) {
 }
 
 int Whip::SourceData(Media_Packet_Ptr pkt_ptr) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    Media_Packet_Ptr new_ptr = pkt_ptr->copy();
+    packet_queue_.Push(pkt_ptr->shared_copy());
+
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Notify(this);
+    }
+    return (int)packet_queue_.Depth();
+}
 
-    packet_queue_.push(new_ptr);
+int Whip::SourceBatch(MediaPacketSpan pkts) {
+    for (const Media_Packet_Ptr& pkt_ptr : pkts) {
+        packet_queue_.Push(pkt_ptr->shared_copy());
+    }
 
-    async_.data = (void*)this;
-    uv_async_send(&async_);
-    return (int)packet_queue_.size();
+    //one notify for the whole batch
+    LoopScheduler* scheduler = scheduler_;
+    if (scheduler) {
+        scheduler->Notify(this);
+    }
+    return (int)pkts.size();
 }
 
 void Whip::StartNetwork(const std::string& url, void* loop_handle) {
@@ -123,9 +149,14 @@ void Whip::StartNetwork(const std::string& url, void* loop_handle) {
     }
 
     loop_ = (uv_loop_t*)loop_handle;
-    uv_async_init(loop_, &async_, SourceWhipData);
+    scheduler_ = LoopScheduler::GetScheduler(loop_);
+    if (packet_queue_.Depth() > 0) {
+        scheduler_.load()->Notify(this);
+    }
 
-    pc_ = new PeerConnection((uv_loop_t*)loop_handle, logger_, this);
+    pc_ = new PeerConnection((uv_loop_t*)loop_handle, logger_, this, options_["udp_batch"] == "true");
+    UpdatePacingRate();
+    pc_->EnableUdpGso(options_["udp_gso"] == "true");
 
     bool https_enable = false;
     if (!GetHostInfoByUrl(url, host_, port_, subpath_, https_enable)) {
@@ -146,6 +177,29 @@ void Whip::AddOption(const std::string& key, const std::string& value) {
     }
     options_[key] = value;
     LogInfof(logger_, "set whip options key:%s, value:%s", key.c_str(), value.c_str());
+
+    if (key == "queue_policy") {
+        QUEUE_OVERFLOW_POLICY policy;
+        if (!GetQueuePolicyByString(value, policy)) {
+            CSM_THROW_ERROR("unknown queue policy:%s", value.c_str());
+        }
+        packet_queue_.SetPolicy(policy);
+    } else if ((key == "pacing_kbps") || (key == "pacing_burst_ms")) {
+        if (pc_) {
+            UpdatePacingRate();
+        }
+    } else if (key == "udp_gso") {
+        if (pc_) {
+            pc_->EnableUdpGso(value == "true");
+        }
+    }
+}
+
+void Whip::UpdatePacingRate() {
+    int64_t pacing_kbps = atoi(options_["pacing_kbps"].c_str());
+    int64_t burst_ms    = atoi(options_["pacing_burst_ms"].c_str());
+
+    pc_->SetPacingRate(pacing_kbps, burst_ms);
 }
 
 void Whip::SetReporter(StreamerReport* reporter) {
@@ -4,6 +4,8 @@
 #include "http_client.hpp"
 #include "peerconnection.hpp"
 #include "cpp_streamer_interface.hpp"
+#include "media_packet_queue.hpp"
+#include "loop_scheduler.hpp"
 #include <queue>
 #include <mutex>
 
@@ -15,10 +17,8 @@ void destroy_whip_streamer(void* streamer);
 namespace cpp_streamer
 {
 
-class Whip : public CppStreamerInterface, public HttpClientCallbackI, public PCStateReportI
+class Whip : public CppStreamerInterface, public HttpClientCallbackI, public PCStateReportI, public LoopScheduleTaskI
 {
-friend void SourceWhipData(uv_async_t *handle);
-
 public:
     Whip();
     virtual ~Whip();
@@ -32,6 +32,11 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) override;
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
+    virtual int SourceBatch(MediaPacketSpan pkts) override;
+
+public:
+    virtual size_t OnScheduleRun(size_t budget) override;
+    virtual bool HasScheduleData() override;
 
 protected:
     virtual void OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) override;
@@ -41,7 +46,8 @@ public:
 
 private:
     Media_Packet_Ptr GetMediaPacket();
-    void HandleMediaData();
+    size_t HandleMediaData(size_t budget);
+    void UpdatePacingRate();
 
 private:
     void ReleaseHttpClient();
@@ -54,9 +60,11 @@ private:
     std::string name_;
 
 private:
-    std::queue<Media_Packet_Ptr> packet_queue_;
-    std::mutex mutex_;
-    uv_async_t async_;
+    MediaPacketQueue packet_queue_;
+    std::atomic<LoopScheduler*> scheduler_{nullptr};
+
+private:
+    static std::map<std::string, std::string> def_options_;
 
 private:
     HttpClient* hc_ = nullptr;
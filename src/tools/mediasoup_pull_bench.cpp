@@ -1,6 +1,7 @@
 #include "logger.hpp"
 #include "cpp_streamer_factory.hpp"
 #include "timer.hpp"
+#include "loop_runtime.hpp"
 
 #include <iostream>
 #include <uv.h>
@@ -14,11 +15,12 @@
 #include <thread>
 #include <memory>
 #include <vector>
+#include <atomic>
 
 using namespace cpp_streamer;
 
 static Logger* s_logger = nullptr;
-static const int BENCH_MAX = 100;
+static const int BENCH_MAX = 100;//per loop thread
 static const size_t WHEPS_INTERVAL = 10;
 
 class MediasoupPulls: public StreamerReport, public TimerInterface, public CppStreamerInterface
@@ -74,6 +76,27 @@ protected:
     }
 
 public:
+    void StartStreamer(CppStreamerInterface* streamer, const std::string& url) {
+        if (!runtime_) {
+            try {
+                streamer->StartNetwork(url, loop_);
+            } catch(CppStreamException& e) {
+                LogErrorf(logger_, "mediasoup pull start network exception:%s", e.what());
+            }
+            return;
+        }
+        //the streamer runs in the loop thread of its shard
+        uv_loop_t* loop = runtime_->AssignLoop();
+        Logger* logger  = logger_;
+        PostToLoop(loop, [streamer, url, loop, logger]() {
+            try {
+                streamer->StartNetwork(url, loop);
+            } catch(CppStreamException& e) {
+                LogErrorf(logger, "mediasoup pull start network exception:%s", e.what());
+            }
+        });
+    }
+
     int MakeStreamers(uv_loop_t* loop_handle) {
         loop_ = loop_handle;
 
@@ -103,11 +126,7 @@ public:
             }
             std::string url = GetUrl(i);
             LogWarnf(logger_, "start network url:%s", url.c_str());
-            try {
-                mediasoup_puller_vec[i]->StartNetwork(url, loop_);
-            } catch(CppStreamException& e) {
-                LogErrorf(logger_, "mediasoup pull start network exception:%s", e.what());
-            }
+            StartStreamer(mediasoup_puller_vec[i], url);
         }
         whep_index_ = i;
         if (whep_index_ >= bench_count_) {
@@ -119,7 +138,15 @@ public:
         StartTimer();
     }
 
+    //run the streamers in the loops of the runtime, instead of the main loop
+    void SetRuntime(LoopRuntime* runtime) {
+        runtime_ = runtime;
+    }
+
     void Stop() {
+        if (runtime_) {
+            runtime_->Stop();
+        }
         Clean();
         LogInfof(logger_, "job is done.");
         exit(0);
@@ -175,6 +202,7 @@ private:
     std::string src_url_;
     size_t bench_count_ = 1;
     uv_loop_t* loop_ = nullptr;
+    LoopRuntime* runtime_ = nullptr;
     size_t whep_index_ = 0;
     bool post_done_ = false;
 
@@ -193,8 +221,9 @@ int main(int argc, char** argv) {
     bool src_url_name_ready = false;
     bool log_file_ready = false;
     int bench_count = 0;
+    int thread_count = 0;
 
-    while ((opt = getopt(argc, argv, "i:l:n:h")) != -1) {
+    while ((opt = getopt(argc, argv, "i:l:n:t:h")) != -1) {
         switch (opt) {
             case 'i': strncpy(src_url_name, optarg, sizeof(src_url_name)); src_url_name_ready = true; break;
             case 'n':
@@ -204,12 +233,20 @@ int main(int argc, char** argv) {
                 bench_count = atoi(count_sz);
                 break;
             }
+            case 't':
+            {
+                char count_sz[80];
+                strncpy(count_sz, optarg, sizeof(count_sz));
+                thread_count = atoi(count_sz);
+                break;
+            }
             case 'l': strncpy(log_file, optarg, sizeof(log_file)); log_file_ready = true; break;
             case 'h':
             default: 
             {
                 printf("Usage: %s [-i whep url]\n\
     [-n bench count]\n\
+    [-t loop threads, 0: run all in the main loop]\n\
     [-l log file name]\n",
                     argv[0]); 
                 return -1;
@@ -226,8 +263,9 @@ int main(int argc, char** argv) {
         std::cout << "please input whep bench count.\r\n";
         return -1;
     }
-    if (bench_count > BENCH_MAX) {
-        std::cout << "bench count max is " << BENCH_MAX << ".\r\n";
+    int bench_max = (thread_count > 0) ? BENCH_MAX * thread_count : BENCH_MAX;
+    if (bench_count > bench_max) {
+        std::cout << "bench count max is " << bench_max << ".\r\n";
         return -1;
     }
 
@@ -251,6 +289,14 @@ int main(int argc, char** argv) {
 
     mgr_ptr->SetLogger(s_logger);
 
+    std::shared_ptr<LoopRuntime> runtime_ptr;
+    if (thread_count > 0) {
+        runtime_ptr = std::make_shared<LoopRuntime>((size_t)thread_count);
+        runtime_ptr->Start();
+        mgr_ptr->SetRuntime(runtime_ptr.get());
+        LogInfof(s_logger, "streamers run in %d loop threads", thread_count);
+    }
+
     if (mgr_ptr->MakeStreamers(loop) < 0) {
         LogErrorf(s_logger, "call mediasoup pull bench error");
         return -1;
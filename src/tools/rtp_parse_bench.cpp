@@ -0,0 +1,170 @@
+#include "logger.hpp"
+#include "rtp_packet.hpp"
+#include "timeex.hpp"
+#include "byte_stream.hpp"
+
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+
+//the extension ids of a browser publisher
+static const uint8_t MID_EXT_ID      = 4;
+static const uint8_t ABS_TIME_EXT_ID = 3;
+static const uint8_t TWCC_EXT_ID     = 5;
+static const uint8_t AUDIO_LEVEL_EXT_ID = 1;
+
+typedef std::vector<uint8_t> RtpData;
+
+//corpus file format: [2 bytes length(network order)][rtp packet]...
+static int LoadCorpus(const std::string& filename, std::vector<RtpData>& corpus) {
+    FILE* file_p = fopen(filename.c_str(), "rb");
+    if (!file_p) {
+        std::cout << "open corpus file error:" << filename << "\r\n";
+        return -1;
+    }
+    uint8_t len_data[2];
+    while (fread(len_data, 1, sizeof(len_data), file_p) == sizeof(len_data)) {
+        size_t len = ByteStream::Read2Bytes(len_data);
+        if ((len == 0) || (len > RTP_PACKET_MAX_SIZE)) {
+            break;
+        }
+        RtpData data(len);
+        if (fread(&data[0], 1, len, file_p) != len) {
+            break;
+        }
+        corpus.push_back(data);
+    }
+    fclose(file_p);
+    return 0;
+}
+
+//one-byte extensions: mid, abs-send-time, transport-cc and audio level(audio only)
+static void MakeCorpus(size_t count, std::vector<RtpData>& corpus) {
+    for (size_t i = 0; i < count; i++) {
+        bool video = (i % 4) != 0;
+        size_t payload_len = video ? 1100 + (i % 100) : 120;
+        RtpData data(12 + 4 + 16 + payload_len, 0x5a);
+        uint8_t* p = &data[0];
+
+        p[0] = 0x90;//version 2, extension
+        p[1] = video ? 96 : 111;
+        ByteStream::Write2Bytes(p + 2, (uint16_t)i);
+        ByteStream::Write4Bytes(p + 4, (uint32_t)(i * 3000));
+        ByteStream::Write4Bytes(p + 8, video ? 0x11111111 : 0x22222222);
+
+        p += 12;
+        ByteStream::Write2Bytes(p, 0xBEDE);
+        ByteStream::Write2Bytes(p + 2, 4);//16 bytes
+        p += 4;
+        uint8_t* ext_end = p + 16;
+        *p++ = (MID_EXT_ID << 4) | 0;
+        *p++ = '0' + (video ? 1 : 0);
+        *p++ = (ABS_TIME_EXT_ID << 4) | 2;
+        ByteStream::Write3Bytes(p, (uint32_t)(i * 100) & 0xffffff);
+        p += 3;
+        *p++ = (TWCC_EXT_ID << 4) | 1;
+        ByteStream::Write2Bytes(p, (uint16_t)i);
+        p += 2;
+        if (!video) {
+            *p++ = (AUDIO_LEVEL_EXT_ID << 4) | 0;
+            *p++ = 0x80 | 30;
+        }
+        while (p < ext_end) {
+            *p++ = 0;
+        }
+        corpus.push_back(data);
+    }
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    std::string corpus_file;
+    size_t count   = 10000;
+    size_t rounds  = 100;
+
+    while ((opt = getopt(argc, argv, "f:n:r:h")) != -1) {
+        switch (opt) {
+            case 'f': corpus_file = std::string(optarg); break;
+            case 'n': count = (size_t)atoi(optarg); break;
+            case 'r': rounds = (size_t)atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-f rtp corpus file: (2 bytes length + rtp packet)..., default generated]\n\
+    [-n generated packet count, default 10000]\n\
+    [-r rounds over the corpus, default 100]\n",
+                    argv[0]);
+                return -1;
+            }
+        }
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_WARN_LEVEL);
+
+    std::vector<RtpData> corpus;
+    if (!corpus_file.empty()) {
+        if (LoadCorpus(corpus_file, corpus) < 0) {
+            return -1;
+        }
+    } else {
+        MakeCorpus(count, corpus);
+    }
+    if (corpus.empty() || (rounds == 0)) {
+        std::cout << "the rtp corpus is empty.\r\n";
+        return -1;
+    }
+
+    //parse, read mid and abs-send-time as the receive path does, then free
+    int64_t found = 0;
+    int64_t error = 0;
+    int64_t start_us = now_microsec();
+    for (size_t r = 0; r < rounds; r++) {
+        for (RtpData& data : corpus) {
+            RtpPacket* pkt = nullptr;
+            try {
+                pkt = RtpPacket::Parse(&data[0], data.size());
+            } catch (CppStreamException& e) {
+                error++;
+                continue;
+            }
+            uint8_t mid = 0;
+            uint32_t abs_time = 0;
+
+            pkt->SetLogger(s_logger);
+            pkt->SetMidExtensionId(MID_EXT_ID);
+            pkt->SetAbsTimeExtensionId(ABS_TIME_EXT_ID);
+            if (pkt->HasExtension()) {
+                if (pkt->ReadMid(mid)) {
+                    found++;
+                }
+                if (pkt->ReadAbsTime(abs_time)) {
+                    found++;
+                }
+            }
+            delete pkt;
+        }
+    }
+    int64_t cost_us = now_microsec() - start_us;
+    if (cost_us <= 0) {
+        cost_us = 1;
+    }
+    int64_t total = (int64_t)(corpus.size() * rounds);
+
+    printf("rtp parse bench, corpus packets:%lu, rounds:%lu, extensions found:%ld, errors:%ld\r\n",
+            corpus.size(), rounds, found, error);
+    printf("%.1f ns/packet, %.0f packets/s\r\n",
+            (double)cost_us * 1000.0 / total, (double)total * 1000000.0 / cost_us);
+    return 0;
+}
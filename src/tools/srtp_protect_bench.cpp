@@ -0,0 +1,122 @@
+#include "logger.hpp"
+#include "srtp_session.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const size_t RTP_HEADER_LEN = 12;
+
+typedef struct BENCH_SUITE_S
+{
+    CRYPTO_SUITE_ENUM suite;
+    const char* name;
+    size_t key_len;//master key + master salt
+} BENCH_SUITE;
+
+static const BENCH_SUITE s_bench_suites[] = {
+    { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80, "AES_CM_128_HMAC_SHA1_80", 30 },
+    { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_32, "AES_CM_128_HMAC_SHA1_32", 30 },
+    { CRYPTO_SUITE_AEAD_AES_128_GCM,        "AEAD_AES_128_GCM",        28 },
+    { CRYPTO_SUITE_AEAD_AES_256_GCM,        "AEAD_AES_256_GCM",        44 }
+};
+
+//protect count rtp packets whose size is pkt_size, return the cost in microseconds
+static int64_t BenchProtect(const BENCH_SUITE& item, size_t pkt_size, size_t count) {
+    std::vector<uint8_t> key(item.key_len);
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = (uint8_t)(rand() & 0xff);
+    }
+    SRtpSession session(SRTP_SESSION_OUT_TYPE, item.suite, key.data(), key.size());
+
+    std::vector<uint8_t> pkt(pkt_size);
+    for (size_t i = 0; i < pkt_size; i++) {
+        pkt[i] = (uint8_t)(rand() & 0xff);
+    }
+    pkt[0] = 0x80;
+    pkt[1] = 96;
+    uint32_t ssrc = htonl(0x12345678);
+    memcpy(&pkt[8], &ssrc, sizeof(ssrc));
+
+    int64_t start_us = now_microsec();
+    for (size_t i = 0; i < count; i++) {
+        uint16_t seq = htons((uint16_t)i);
+        uint32_t ts  = htonl((uint32_t)(i * 3000));
+        memcpy(&pkt[2], &seq, sizeof(seq));
+        memcpy(&pkt[4], &ts, sizeof(ts));
+
+        uint8_t* data = pkt.data();
+        size_t len = pkt_size;
+        if (!session.EncryptRtp(&data, &len)) {
+            return -1;
+        }
+    }
+    return now_microsec() - start_us;
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    size_t pkt_size = 1200;
+    size_t count = 200000;
+
+    while ((opt = getopt(argc, argv, "s:n:h")) != -1) {
+        switch (opt) {
+            case 's': pkt_size = (size_t)atoi(optarg); break;
+            case 'n': count = (size_t)atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-s rtp packet size, default 1200]\n\
+    [-n packet count, default 200000]\n",
+                    argv[0]);
+                return -1;
+            }
+        }
+    }
+    if ((pkt_size <= RTP_HEADER_LEN) || (pkt_size > SRTP_ENCRYPT_BUFFER_SIZE - SRTP_MAX_TRAILER_LEN)) {
+        std::cout << "rtp packet size should be in (" << RTP_HEADER_LEN << ", "
+                  << SRTP_ENCRYPT_BUFFER_SIZE - SRTP_MAX_TRAILER_LEN << "].\r\n";
+        return -1;
+    }
+    if (count == 0) {
+        std::cout << "please input packet count.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_WARN_LEVEL);
+    SRtpSession::Init(s_logger);
+
+    printf("srtp protect bench, rtp packet size:%lu, count:%lu\r\n", pkt_size, count);
+    printf("%-26s %12s %12s\r\n", "suite", "ns/packet", "Mbps");
+    for (const BENCH_SUITE& item : s_bench_suites) {
+        int64_t cost_us = -1;
+        try {
+            cost_us = BenchProtect(item, pkt_size, count);
+        } catch (CppStreamException& e) {
+            LogErrorf(s_logger, "suite %s exception:%s", item.name, e.what());
+        }
+        if (cost_us < 0) {
+            printf("%-26s %12s %12s\r\n", item.name, "unsupported", "-");
+            continue;
+        }
+        if (cost_us == 0) {
+            cost_us = 1;
+        }
+        double ns_per_pkt = (double)cost_us * 1000.0 / count;
+        double mbps = (double)pkt_size * 8 * count / cost_us;
+        printf("%-26s %12.1f %12.1f\r\n", item.name, ns_per_pkt, mbps);
+    }
+    return 0;
+}
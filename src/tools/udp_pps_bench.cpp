@@ -0,0 +1,171 @@
+#include "logger.hpp"
+#include "timer.hpp"
+#include "udp_client.hpp"
+#include "udp_server.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+using namespace cpp_streamer;
+
+static Logger s_logger;
+
+//loopback udp packets per second: the sender writes a burst of datagrams every
+//interval(eg: the fragments of a keyframe), the receiver counts them,
+//and the cpu cost per datagram and per burst is reported.
+class UdpPpsBench : public UdpSessionCallbackI, public TimerInterface
+{
+public:
+    UdpPpsBench(uv_loop_t* loop, uint16_t port, size_t pkt_size,
+            size_t burst, uint32_t interval_ms, int64_t duration_ms,
+            bool batch_mode, bool gso):TimerInterface(loop, interval_ms)
+                                                            , loop_(loop)
+                                                            , remote_("127.0.0.1", port)
+                                                            , data_(pkt_size, 'x')
+                                                            , burst_(burst)
+                                                            , duration_ms_(duration_ms)
+    {
+        receiver_ = new UdpServer(loop, port, this, &s_logger, batch_mode);
+        sender_   = new UdpClient(loop, this, &s_logger, nullptr, 0, batch_mode);
+        sender_->EnableGso(gso);
+    }
+    virtual ~UdpPpsBench() {
+        StopTimer();
+        delete sender_;
+        delete receiver_;
+    }
+
+public:
+    void Start() {
+        start_ms_ = now_millisec();
+        GetCpuUs(start_cpu_us_);
+        StartTimer();
+    }
+
+    void Report() {
+        int64_t cpu_us = 0;
+        GetCpuUs(cpu_us);
+        cpu_us -= start_cpu_us_;
+
+        int64_t cost_ms = now_millisec() - start_ms_;
+        if (cost_ms <= 0) {
+            cost_ms = 1;
+        }
+        printf("mode:%s%s, packet size:%lu, sent:%ld, received:%ld, send syscalls:%ld, gso buffers:%ld\r\n",
+                sender_->IsBatchMode() ? "batch" : "single", sender_->IsGsoEnable() ? "+gso" : "",
+                data_.size(), sent_count_, recv_count_,
+                sender_->IsBatchMode() ? sender_->GetSendCallCount() : sent_count_,
+                sender_->GetGsoSendCount());
+        printf("recv pps:%ld, cpu:%.3f us/packet, %.1f us/burst(%lu packets)\r\n",
+                recv_count_ * 1000 / cost_ms,
+                (recv_count_ > 0) ? (double)cpu_us / recv_count_ : 0.0,
+                (burst_count_ > 0) ? (double)cpu_us / burst_count_ : 0.0,
+                burst_);
+    }
+
+protected:
+    virtual void OnTimer() override {
+        if (now_millisec() - start_ms_ > duration_ms_) {
+            StopTimer();
+            Report();
+            uv_stop(loop_);
+            return;
+        }
+        for (size_t i = 0; i < burst_; i++) {
+            sender_->Write(&data_[0], data_.size(), remote_);
+            sent_count_++;
+        }
+        burst_count_++;
+    }
+
+    virtual void OnWrite(size_t sent_size, UdpTuple address) override {
+    }
+
+    virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override {
+        recv_count_++;
+    }
+
+private:
+    void GetCpuUs(int64_t& cpu_us) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        cpu_us = (int64_t)usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec
+               + (int64_t)usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    UdpTuple remote_;
+    std::string data_;
+    size_t burst_ = 0;
+    int64_t duration_ms_ = 0;
+    UdpServer* receiver_ = nullptr;
+    UdpClient* sender_   = nullptr;
+    int64_t start_ms_     = 0;
+    int64_t start_cpu_us_ = 0;
+    int64_t sent_count_   = 0;
+    int64_t recv_count_   = 0;
+    int64_t burst_count_  = 0;
+};
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    uint16_t port = 19000;
+    size_t pkt_size = 1200;
+    size_t burst = 64;
+    uint32_t interval_ms = 1;
+    int64_t duration_ms = 5000;
+    bool batch_mode = false;
+    bool gso = false;
+
+    while ((opt = getopt(argc, argv, "p:s:n:i:d:bgh")) != -1) {
+        switch (opt) {
+            case 'p': port = (uint16_t)atoi(optarg); break;
+            case 's': pkt_size = (size_t)atoi(optarg); break;
+            case 'n': burst = (size_t)atoi(optarg); break;
+            case 'i': interval_ms = (uint32_t)atoi(optarg); break;
+            case 'd': duration_ms = (int64_t)atoi(optarg) * 1000; break;
+            case 'b': batch_mode = true; break;
+            case 'g': batch_mode = true; gso = true; break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-p udp port, default 19000]\n\
+    [-s packet size, default 1200]\n\
+    [-n packets sent per burst, default 64]\n\
+    [-i burst interval ms, default 1]\n\
+    [-d duration seconds, default 5]\n\
+    [-b use sendmmsg/recvmmsg batch mode]\n\
+    [-g use batch mode with udp gso]\n\
+eg: keyframe of 300KB every 40ms: %s -n 250 -i 40 -g\n",
+                    argv[0], argv[0]);
+                return -1;
+            }
+        }
+    }
+    if (interval_ms == 0) {
+        interval_ms = 1;
+    }
+    if ((pkt_size == 0) || (pkt_size > UDP_DATA_BUFFER_MAX)) {
+        std::cout << "packet size should be in (0, " << UDP_DATA_BUFFER_MAX << "].\r\n";
+        return -1;
+    }
+    s_logger.SetLevel(LOGGER_WARN_LEVEL);
+
+    uv_loop_t* loop = uv_default_loop();
+    UdpPpsBench bench(loop, port, pkt_size, burst, interval_ms, duration_ms, batch_mode, gso);
+
+    bench.Start();
+    uv_run(loop, UV_RUN_DEFAULT);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "logger.hpp"
 #include "cpp_streamer_factory.hpp"
 #include "timer.hpp"
+#include "loop_runtime.hpp"
 
 #include <iostream>
 #include <uv.h>
@@ -14,11 +15,12 @@
 #include <thread>
 #include <memory>
 #include <vector>
+#include <atomic>
 
 using namespace cpp_streamer;
 
 static Logger* s_logger = nullptr;
-static const int BENCH_MAX = 100;
+static const int BENCH_MAX = 100;//per loop thread
 static const size_t WHIPS_INTERVAL = 10;
 
 void CloseCallback(uv_async_t *handle);
@@ -46,6 +48,9 @@ public:
 protected:
     virtual void OnTimer() override {
         StartWhips();
+        if (read_start_ && !read_started_) {
+            StartReadTs();
+        }
     }
 
     std::string GetUrl(size_t index) {
@@ -56,6 +61,27 @@ protected:
     }
 
 public:
+    void StartStreamer(CppStreamerInterface* streamer, const std::string& url) {
+        if (!runtime_) {
+            try {
+                streamer->StartNetwork(url, loop_);
+            } catch(CppStreamException& e) {
+                LogErrorf(logger_, "whip start network exception:%s", e.what());
+            }
+            return;
+        }
+        //the streamer runs in the loop thread of its shard
+        uv_loop_t* loop = runtime_->AssignLoop();
+        Logger* logger  = logger_;
+        PostToLoop(loop, [streamer, url, loop, logger]() {
+            try {
+                streamer->StartNetwork(url, loop);
+            } catch(CppStreamException& e) {
+                LogErrorf(logger, "whip start network exception:%s", e.what());
+            }
+        });
+    }
+
     int MakeStreamers(uv_loop_t* loop_handle) {
         loop_ = loop_handle;
         uv_async_init(loop_, &async_, CloseCallback);
@@ -70,6 +96,9 @@ public:
         tsdemux_streamer_->SetLogger(logger_);
         tsdemux_streamer_->AddOption("re", "true");
         tsdemux_streamer_->SetReporter(this);
+        //the demuxer paces the packets in the main loop, and the file is read in
+        //the main loop too: it stops at the pacing "full" and goes on at "drain".
+        tsdemux_streamer_->StartNetwork("", loop_);
 
         for (size_t i = 0; i < bench_count_; i++) {
             CppStreamerInterface* whip_streamer = CppStreamerFactory::MakeStreamer("whip");
@@ -79,6 +108,9 @@ public:
             }
             whip_streamer->SetLogger(logger_);
             whip_streamer->SetReporter(this);
+            whip_streamer->AddOption("udp_batch", "true");
+            //the sessions may run in the loop of the demuxer, which must not be blocked
+            whip_streamer->AddOption("queue_policy", "drop_gop");
             tsdemux_streamer_->AddSinker(whip_streamer);
 
             whips_.push_back(whip_streamer);
@@ -102,11 +134,7 @@ public:
             }
             std::string url = GetUrl(i);
             LogWarnf(logger_, "start network url:%s", url.c_str());
-            try {
-                whips_[i]->StartNetwork(url, loop_);
-            } catch(CppStreamException& e) {
-                LogErrorf(logger_, "whip start network exception:%s", e.what());
-            }
+            StartStreamer(whips_[i], url);
         }
         whip_index_ = i;
         if (whip_index_ >= bench_count_) {
@@ -121,7 +149,15 @@ public:
         StartTimer();
     }
 
+    //run the streamers in the loops of the runtime, instead of the main loop
+    void SetRuntime(LoopRuntime* runtime) {
+        runtime_ = runtime;
+    }
+
     void Stop() {
+        if (runtime_) {
+            runtime_->Stop();
+        }
         Clean();
         LogInfof(logger_, "job is done.");
         exit(0);
@@ -150,6 +186,10 @@ protected:
     virtual void OnReport(const std::string& name,
             const std::string& type,
             const std::string& value) override {
+        if (type == "pacing") {
+            OnPacingReport(value);
+            return;
+        }
         LogWarnf(logger_, "report name:%s, type:%s, value:%s",
                 name.c_str(), type.c_str(), value.c_str());
         if (type == "dtls") {
@@ -179,7 +219,61 @@ protected:
         return 0;
     }
 
+    //run in the main loop
+    void StartReadTs() {
+        read_started_ = true;
+        file_p_ = fopen(src_ts_.c_str(), "r");
+        if (!file_p_) {
+            LogErrorf(s_logger, "open mpegts file error:%s", src_ts_.c_str());
+            read_done_ = true;
+            return;
+        }
+        ReadTs();
+    }
+
+    //read until the pacing of the demuxer is full or the end of the file
+    void ReadTs() {
+        uint8_t read_data[10*188];
+
+        pacing_full_ = false;
+        while (file_p_ && !pacing_full_) {
+            size_t read_n = fread(read_data, 1, sizeof(read_data), file_p_);
+            if (read_n > 0) {
+                InputTsData(read_data, read_n);
+            }
+            if (whip_ready_count_ == 0) {
+                LogErrorf(logger_, "whip error and break mpegts reading");
+                CloseTs();
+                read_done_ = true;
+                return;
+            }
+            if (read_n == 0) {
+                //it's done when the paced packets are output
+                CloseTs();
+                return;
+            }
+        }
+    }
+
+    void CloseTs() {
+        if (file_p_) {
+            fclose(file_p_);
+            file_p_ = nullptr;
+        }
+    }
+
+    void OnPacingReport(const std::string& value) {
+        if (value == "full") {
+            pacing_full_ = true;
+        } else if (value == "drain") {
+            ReadTs();
+        } else if ((value == "empty") && read_started_ && !file_p_) {
+            read_done_ = true;
+        }
+    }
+
     void Clean() {
+        CloseTs();
         if (tsdemux_streamer_) {
             delete tsdemux_streamer_;
             tsdemux_streamer_ = nullptr;
@@ -217,27 +311,13 @@ protected:
                 break;
             }
         }
-        LogWarnf(logger_, "%d whip session is ready", whip_ready_count_);
+        LogWarnf(logger_, "%lu whip session is ready", whip_ready_count_.load());
 
-        FILE* file_p = fopen(src_ts_.c_str(), "r");
-        if (!file_p) {
-            LogErrorf(s_logger, "open mpegts file error:%s", src_ts_.c_str());
-            AsyncClose();
-            return;
+        //the file is read in the main loop
+        read_start_ = true;
+        while (!read_done_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        uint8_t read_data[10*188];
-        size_t read_n = 0;
-        do {
-            read_n = fread(read_data, 1, sizeof(read_data), file_p);
-            if (read_n > 0) {
-                InputTsData(read_data, read_n);
-            }
-            if (whip_ready_count_ == 0) {
-                LogErrorf(logger_, "whip error and break mpegts reading");
-                break;
-            }
-        } while (read_n > 0);
-        fclose(file_p);
         LogInfof(logger_, "mpegts file read is over...");
 
         std::this_thread::sleep_for(std::chrono::milliseconds(3000));
@@ -250,12 +330,20 @@ private:
     std::string base_url_;
     size_t bench_count_ = 1;
     uv_loop_t* loop_ = nullptr;
+    LoopRuntime* runtime_ = nullptr;
     uv_async_t async_;
     std::shared_ptr<std::thread> thread_ptr_;
-    size_t whip_ready_count_ = 0;
+    std::atomic<size_t> whip_ready_count_{0};//reported by the shard threads
     size_t whip_index_ = 0;
     bool post_done_ = false;
 
+private://the file is read in the main loop
+    std::atomic<bool> read_start_{false};
+    std::atomic<bool> read_done_{false};
+    bool read_started_ = false;
+    bool pacing_full_  = false;
+    FILE* file_p_      = nullptr;
+
 private:
     Logger* logger_ = nullptr;
     std::vector<CppStreamerInterface*> whips_;
@@ -277,8 +365,9 @@ int main(int argc, char** argv) {
     bool output_url_name_ready = false;
     bool log_file_ready = false;
     int bench_count = 0;
+    int thread_count = 0;
 
-    while ((opt = getopt(argc, argv, "i:o:l:n:h")) != -1) {
+    while ((opt = getopt(argc, argv, "i:o:l:n:t:h")) != -1) {
         switch (opt) {
             case 'i': strncpy(input_ts_name, optarg, sizeof(input_ts_name)); input_ts_name_ready = true; break;
             /*eg: http://10.0.24.12:1985/rtc/v1/whip/?app=live&stream=1000*/
@@ -290,6 +379,13 @@ int main(int argc, char** argv) {
                 bench_count = atoi(count_sz);
                 break;
             }
+            case 't':
+            {
+                char count_sz[80];
+                strncpy(count_sz, optarg, sizeof(count_sz));
+                thread_count = atoi(count_sz);
+                break;
+            }
             case 'l': strncpy(log_file, optarg, sizeof(log_file)); log_file_ready = true; break;
             case 'h':
             default: 
@@ -297,6 +393,7 @@ int main(int argc, char** argv) {
                 printf("Usage: %s [-i input mpegts(h264+opus) file]\n\
     [-o whip url]\n\
     [-n bench count]\n\
+    [-t loop threads, 0: run all in the main loop]\n\
     [-l log file name]\n",
                     argv[0]); 
                 return -1;
@@ -313,8 +410,9 @@ int main(int argc, char** argv) {
         std::cout << "please input whip bench count.\r\n";
         return -1;
     }
-    if (bench_count > BENCH_MAX) {
-        std::cout << "bench count max is " << BENCH_MAX << ".\r\n";
+    int bench_max = (thread_count > 0) ? BENCH_MAX * thread_count : BENCH_MAX;
+    if (bench_count > bench_max) {
+        std::cout << "bench count max is " << bench_max << ".\r\n";
         return -1;
     }
 
@@ -339,6 +437,14 @@ int main(int argc, char** argv) {
 
     mgr_ptr->SetLogger(s_logger);
 
+    std::shared_ptr<LoopRuntime> runtime_ptr;
+    if (thread_count > 0) {
+        runtime_ptr = std::make_shared<LoopRuntime>((size_t)thread_count);
+        runtime_ptr->Start();
+        mgr_ptr->SetRuntime(runtime_ptr.get());
+        LogInfof(s_logger, "streamers run in %d loop threads", thread_count);
+    }
+
     if (mgr_ptr->MakeStreamers(loop) < 0) {
         LogErrorf(s_logger, "call mpegts to whip bench error");
         return -1;
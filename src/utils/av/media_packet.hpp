@@ -2,6 +2,7 @@
 #define MEDIA_PACKET_HPP
 #include "av.hpp"
 #include "data_buffer.hpp"
+#include "stream_context.hpp"
 
 #include <stdint.h>
 #include <string>
@@ -12,6 +13,39 @@
 namespace cpp_streamer
 {
 
+//payloads up to this size live inline in the packet allocation, see make_media_packet()
+#define MEDIA_PACKET_INLINE_SIZE 1024
+
+class Media_Metadata
+{
+public:
+    int metadata_type_ = 0;
+    std::map<std::string, std::string> metadata_;
+};
+
+//the data derived from the payload(eg: the rtp payloads of a video frame).
+//it's built once by the first sinker and shared by all the sinkers which get
+//the same packet, so it's read only after being attached.
+class Media_Packet_Attachment
+{
+public:
+    Media_Packet_Attachment() = default;
+    virtual ~Media_Packet_Attachment() = default;
+};
+
+typedef std::shared_ptr<Media_Packet_Attachment> Media_Packet_Attachment_Ptr;
+
+//the attachment lives in the slot which is shared by the packet and all its
+//shared copies(the same payload), so it's built once for all the sinkers even
+//if the copies are made before it's attached.
+class Media_Packet_Attachment_Slot
+{
+public:
+    Media_Packet_Attachment_Ptr attachment_ptr_;
+};
+
+typedef std::shared_ptr<Media_Packet_Attachment_Slot> Media_Packet_Attachment_Slot_Ptr;
+
 class Media_Packet
 {
 public:
@@ -23,6 +57,10 @@ public:
     {
         buffer_ptr_ = std::make_shared<DataBuffer>(len);
     }
+    Media_Packet(std::shared_ptr<DataBuffer> buffer_ptr)
+    {
+        buffer_ptr_ = buffer_ptr;
+    }
     Media_Packet(const Media_Packet& input_packet)
     {
         copy_properties(input_packet);
@@ -42,12 +80,57 @@ public:
     {
     }
 
-    std::shared_ptr<Media_Packet> copy() {
-        std::shared_ptr<Media_Packet> pkt_ptr = std::make_shared<Media_Packet>(this->buffer_ptr_->DataLen() + 1024);
+    std::shared_ptr<Media_Packet> copy();
 
-        pkt_ptr->copy_properties(*this);
-        pkt_ptr->buffer_ptr_->AppendData(this->buffer_ptr_->Data(), this->buffer_ptr_->DataLen());
-        return pkt_ptr;
+    //the new packet shares the payload buffer, only the properties are copied.
+    //the shared payload is read only, call MakeWritable() before changing it.
+    //an inline payload(not owned by buffer_ptr_) is small and copied instead.
+    std::shared_ptr<Media_Packet> shared_copy();
+
+    //copy on write: detach the payload buffer if it's shared with other packets.
+    void MakeWritable() {
+        if (buffer_ptr_.use_count() <= 1) {
+            return;
+        }
+        std::shared_ptr<DataBuffer> new_buffer_ptr = std::make_shared<DataBuffer>(buffer_ptr_->DataLen() + 1024);
+
+        new_buffer_ptr->AppendData(buffer_ptr_->Data(), buffer_ptr_->DataLen());
+        buffer_ptr_ = new_buffer_ptr;
+        //it may refer to the old payload, leave the slot of the shared copies
+        std::atomic_store(&attachment_slot_ptr_, Media_Packet_Attachment_Slot_Ptr());
+    }
+
+    //thread safe: the sinkers in different loop threads may get the same packet.
+    Media_Packet_Attachment_Ptr GetAttachment() {
+        Media_Packet_Attachment_Slot_Ptr slot_ptr = std::atomic_load(&attachment_slot_ptr_);
+        if (!slot_ptr) {
+            return Media_Packet_Attachment_Ptr();
+        }
+        return std::atomic_load(&slot_ptr->attachment_ptr_);
+    }
+
+    //return the attachment of the packet: the input one, or the one which is
+    //attached by another sinker at the same time.
+    Media_Packet_Attachment_Ptr SetAttachment(Media_Packet_Attachment_Ptr attachment_ptr) {
+        Media_Packet_Attachment_Slot_Ptr slot_ptr = GetAttachmentSlot();
+        Media_Packet_Attachment_Ptr expected;
+        if (std::atomic_compare_exchange_strong(&slot_ptr->attachment_ptr_, &expected, attachment_ptr)) {
+            return attachment_ptr;
+        }
+        return expected;
+    }
+
+    //the slot is made at the first use, by the first attachment or shared copy
+    Media_Packet_Attachment_Slot_Ptr GetAttachmentSlot() {
+        Media_Packet_Attachment_Slot_Ptr slot_ptr = std::atomic_load(&attachment_slot_ptr_);
+        if (slot_ptr) {
+            return slot_ptr;
+        }
+        Media_Packet_Attachment_Slot_Ptr new_slot_ptr = std::make_shared<Media_Packet_Attachment_Slot>();
+        if (std::atomic_compare_exchange_strong(&attachment_slot_ptr_, &slot_ptr, new_slot_ptr)) {
+            return new_slot_ptr;
+        }
+        return slot_ptr;
     }
 
     void copy_properties(const Media_Packet& pkt) {
@@ -59,11 +142,7 @@ public:
         this->is_key_frame_ = pkt.is_key_frame_;
         this->is_seq_hdr_   = pkt.is_seq_hdr_;
 
-        this->key_        = pkt.key_;
-        this->vhost_      = pkt.vhost_;
-        this->app_        = pkt.app_;
-        this->streamname_ = pkt.streamname_;
-        this->streamid_   = pkt.streamid_;
+        this->context_    = pkt.context_;
         this->typeid_     = pkt.typeid_;
     }
 
@@ -76,14 +155,17 @@ public:
         this->is_key_frame_ = pkt_ptr->is_key_frame_;
         this->is_seq_hdr_   = pkt_ptr->is_seq_hdr_;
 
-        this->key_        = pkt_ptr->key_;
-        this->vhost_      = pkt_ptr->vhost_;
-        this->app_        = pkt_ptr->app_;
-        this->streamname_ = pkt_ptr->streamname_;
-        this->streamid_   = pkt_ptr->streamid_;
+        this->context_    = pkt_ptr->context_;
         this->typeid_     = pkt_ptr->typeid_;
     }
 
+    Media_Metadata* Metadata() {
+        if (!metadata_ptr_) {
+            metadata_ptr_.reset(new Media_Metadata());
+        }
+        return metadata_ptr_.get();
+    }
+
     std::string Dump() {
         std::stringstream ss;
         
@@ -95,55 +177,101 @@ public:
         ss << ", format type:" << formattype_tostring(fmt_type_) << ", dts:" << dts_ << ", pts:" << pts_
            << ", is key frame:" << is_key_frame_ << ", is seq frame:" << is_seq_hdr_
            << ", data length:" << buffer_ptr_->DataLen();
-        if (!key_.empty()) {
-            ss << ", key:" << key_;
+        if (context_ && !context_->key_.empty()) {
+            ss << ", key:" << context_->key_;
         }
-        if (!app_.empty()) {
-            ss << ", app:" << app_;
+        if (context_ && !context_->app_.empty()) {
+            ss << ", app:" << context_->app_;
         }
-        if (!streamname_.empty()) {
-            ss << ", stream name:" << streamname_;
+        if (context_ && !context_->streamname_.empty()) {
+            ss << ", stream name:" << context_->streamname_;
         }
-        if (!metadata_.empty()) {
+        if (metadata_ptr_ && !metadata_ptr_->metadata_.empty()) {
             ss << "\r\n";
-            ss << "metadata type:" << metadata_type_ << "\r\n";
-            for (auto& item : metadata_) {
+            ss << "metadata type:" << metadata_ptr_->metadata_type_ << "\r\n";
+            for (auto& item : metadata_ptr_->metadata_) {
                 ss << "key:" << item.first << ", value:" << item.second << "\r\n";
             }
         }
         return ss.str();
     }
 
-public:
+public://hot fields in the first cache line
+    int64_t dts_ = -1;
+    int64_t pts_ = -1;
+    std::shared_ptr<DataBuffer> buffer_ptr_;
     MEDIA_PKT_TYPE av_type_      = MEDIA_UNKOWN_TYPE;
     MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKOWN;
     MEDIA_FORMAT_TYPE fmt_type_  = MEDIA_FORMAT_UNKOWN;
-    int64_t dts_ = -1;
-    int64_t pts_ = -1;
     bool is_key_frame_ = false;
     bool is_seq_hdr_   = false;
     bool has_flv_audio_asc_ = false;
-    std::shared_ptr<DataBuffer> buffer_ptr_;
-    int metadata_type_;
-    std::map<std::string, std::string> metadata_;
+    uint8_t channel_ = 2;
+    uint8_t aac_asc_type_ = ASC_TYPE_AAC_LC;
+    uint8_t typeid_ = 0;
 
 public:
     int sample_rate_ = 44100;
     int sample_size_ = 1;
-    uint8_t channel_ = 2;
-    uint8_t aac_asc_type_ = ASC_TYPE_AAC_LC;
-//rtmp info:
-public:
-    std::string key_;//vhost(option)_appname_streamname
-    std::string vhost_;
-    std::string app_;
-    std::string streamname_;
-    uint32_t streamid_ = 0;
-    uint8_t typeid_ = 0;
+
+public://allocated by Metadata() only for metadata packets
+    std::unique_ptr<Media_Metadata> metadata_ptr_;
+
+public://stream identity: key, vhost, app, stream name and stream id
+    StreamContextPtr context_;
+
+private://see GetAttachment/SetAttachment
+    Media_Packet_Attachment_Slot_Ptr attachment_slot_ptr_;
 };
 
 typedef std::shared_ptr<Media_Packet> Media_Packet_Ptr;
 
+//packet, DataBuffer and the small payload in one allocation.
+//buffer_ptr_ of the packet doesn't own the DataBuffer, it's valid while the packet is alive.
+class Media_Packet_Block
+{
+public:
+    Media_Packet_Block(size_t len):packet_(std::shared_ptr<DataBuffer>(std::shared_ptr<DataBuffer>(), &buffer_))
+                                , buffer_(len, inline_data_, sizeof(inline_data_))
+    {
+    }
+
+public:
+    Media_Packet packet_;
+    DataBuffer buffer_;
+    char inline_data_[MEDIA_PACKET_INLINE_SIZE + PRE_RESERVE_HEADER_SIZE];
+};
+
+//one allocation for small packets, the payload can still grow into the buffer pool.
+inline Media_Packet_Ptr make_media_packet(size_t len = EXTRA_LEN) {
+    if (len > MEDIA_PACKET_INLINE_SIZE) {
+        return std::make_shared<Media_Packet>(len);
+    }
+    std::shared_ptr<Media_Packet_Block> block_ptr = std::make_shared<Media_Packet_Block>(len);
+
+    return Media_Packet_Ptr(block_ptr, &block_ptr->packet_);
+}
+
+inline std::shared_ptr<Media_Packet> Media_Packet::copy() {
+    std::shared_ptr<Media_Packet> pkt_ptr = make_media_packet(this->buffer_ptr_->DataLen());
+
+    pkt_ptr->copy_properties(*this);
+    pkt_ptr->buffer_ptr_->AppendData(this->buffer_ptr_->Data(), this->buffer_ptr_->DataLen());
+    return pkt_ptr;
+}
+
+inline std::shared_ptr<Media_Packet> Media_Packet::shared_copy() {
+    if (this->buffer_ptr_.use_count() == 0) {
+        return copy();
+    }
+    std::shared_ptr<Media_Packet> pkt_ptr = std::make_shared<Media_Packet>(this->buffer_ptr_);
+
+    pkt_ptr->copy_properties(*this);
+    //the payload is shared, so is the data derived from it
+    pkt_ptr->attachment_slot_ptr_ = this->GetAttachmentSlot();
+    return pkt_ptr;
+}
+
 class av_writer_base
 {
 public:
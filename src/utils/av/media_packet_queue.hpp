@@ -0,0 +1,217 @@
+#ifndef MEDIA_PACKET_QUEUE_HPP
+#define MEDIA_PACKET_QUEUE_HPP
+#include "media_packet.hpp"
+#include "spsc_queue.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+namespace cpp_streamer
+{
+
+#define MEDIA_PACKET_QUEUE_DEF_SIZE 1024
+#define MEDIA_PACKET_QUEUE_REPORT_INTERVAL 2000
+
+typedef enum {
+    QUEUE_POLICY_BLOCK = 0,  //the producer waits for free space
+    QUEUE_POLICY_DROP_OLDEST,//the oldest packet is dropped
+    QUEUE_POLICY_DROP_GOP    //drop the video until the next keyframe, the seq headers and audio are kept
+} QUEUE_OVERFLOW_POLICY;
+
+inline bool GetQueuePolicyByString(const std::string& desc, QUEUE_OVERFLOW_POLICY& policy) {
+    if (desc == "block") {
+        policy = QUEUE_POLICY_BLOCK;
+    } else if (desc == "drop_oldest") {
+        policy = QUEUE_POLICY_DROP_OLDEST;
+    } else if (desc == "drop_gop") {
+        policy = QUEUE_POLICY_DROP_GOP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//bounded packet handoff between the producer thread and the uv loop.
+class MediaPacketQueue
+{
+public:
+    MediaPacketQueue(size_t capacity = MEDIA_PACKET_QUEUE_DEF_SIZE,
+                    QUEUE_OVERFLOW_POLICY policy = QUEUE_POLICY_BLOCK):queue_(capacity)
+                                                                        , policy_(policy)
+    {
+    }
+    ~MediaPacketQueue() {
+    }
+
+public:
+    //called by the producer, return false when the packet is dropped.
+    bool Push(Media_Packet_Ptr pkt_ptr) {
+        if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
+            has_video_ = true;
+        }
+        QUEUE_OVERFLOW_POLICY policy = policy_.load();
+
+        if ((policy == QUEUE_POLICY_DROP_GOP) && has_video_) {
+            return PushGop(pkt_ptr);
+        }
+        PushPendingSeqHdr(pkt_ptr);
+
+        if (queue_.Push(pkt_ptr)) {
+            return true;
+        }
+
+        if (policy == QUEUE_POLICY_BLOCK) {
+            while (!queue_.Push(pkt_ptr)) {
+                if (closed_) {
+                    drop_count_++;
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+
+        //drop oldest, or drop gop for the audio only stream
+        PushEvictOldest(pkt_ptr);
+        return true;
+    }
+
+    //called by the consumer, return nullptr when it's empty.
+    Media_Packet_Ptr Pop() {
+        Media_Packet_Ptr pkt_ptr;
+
+        queue_.Pop(pkt_ptr);
+        return pkt_ptr;
+    }
+
+    void SetPolicy(QUEUE_OVERFLOW_POLICY policy) { policy_ = policy; }
+    QUEUE_OVERFLOW_POLICY GetPolicy() { return policy_.load(); }
+
+    //wake up the blocked producer, and the following packets are dropped when it's full.
+    void Close() { closed_ = true; }
+
+    size_t Depth() { return queue_.Size(); }
+    size_t Capacity() { return queue_.Capacity(); }
+    int64_t DropCount() { return drop_count_.load(); }
+
+    //called by the consumer, return false when the last statics are reported
+    //in MEDIA_PACKET_QUEUE_REPORT_INTERVAL.
+    bool GetReportStatics(int64_t now_ms, std::string& statics) {
+        if ((last_report_ms_ > 0) && (last_report_ms_ + MEDIA_PACKET_QUEUE_REPORT_INTERVAL > now_ms)) {
+            return false;
+        }
+        last_report_ms_ = now_ms;
+
+        std::stringstream ss;
+
+        ss << "{";
+        ss << "\"depth\":" << Depth() << ",";
+        ss << "\"capacity\":" << Capacity() << ",";
+        ss << "\"drop\":" << DropCount();
+        ss << "}";
+        statics = ss.str();
+        return true;
+    }
+
+private:
+    bool PushGop(Media_Packet_Ptr pkt_ptr) {
+        bool is_keyframe = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && pkt_ptr->is_key_frame_;
+        bool is_audio    = (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE);
+
+        if (wait_keyframe_ && !is_audio) {
+            if (!pkt_ptr->is_seq_hdr_ && !is_keyframe) {
+                drop_count_++;
+                return false;
+            }
+            if (is_keyframe) {
+                wait_keyframe_ = false;
+            }
+        }
+        PushPendingSeqHdr(pkt_ptr);
+
+        if (queue_.Push(pkt_ptr)) {
+            return true;
+        }
+
+        //the queue is full: drop the video packets until the next keyframe,
+        //and the seq header, keyframe or audio takes the place of the oldest packet.
+        if (pkt_ptr->is_seq_hdr_ || is_keyframe) {
+            PushEvictOldest(pkt_ptr);
+            return true;
+        }
+        wait_keyframe_ = true;
+        if (is_audio) {
+            PushEvictOldest(pkt_ptr);
+            return true;
+        }
+        drop_count_++;
+        return false;
+    }
+
+    //the evicted seq headers are not dropped: the latest one of each media type
+    //is kept and pushed again before the next video keyframe or audio packet.
+    void PushEvictOldest(Media_Packet_Ptr pkt_ptr) {
+        while (true) {
+            //the seq header evicted by the packet itself goes before it
+            PushPendingSeqHdr(pkt_ptr);
+            if (queue_.Push(pkt_ptr)) {
+                return;
+            }
+            Media_Packet_Ptr drop_ptr;
+            if (!queue_.Pop(drop_ptr)) {
+                continue;
+            }
+            if (drop_ptr->is_seq_hdr_ && (drop_ptr->av_type_ == MEDIA_VIDEO_TYPE)) {
+                video_seq_hdr_ = drop_ptr;
+            } else if (drop_ptr->is_seq_hdr_ && (drop_ptr->av_type_ == MEDIA_AUDIO_TYPE)) {
+                audio_seq_hdr_ = drop_ptr;
+            } else {
+                drop_count_++;
+            }
+        }
+    }
+
+    void PushPendingSeqHdr(const Media_Packet_Ptr& pkt_ptr) {
+        Media_Packet_Ptr* pending = nullptr;
+
+        if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
+            pending = &video_seq_hdr_;
+        } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+            pending = &audio_seq_hdr_;
+        }
+        if (!pending || !(*pending)) {
+            return;
+        }
+        if (pkt_ptr->is_seq_hdr_) {
+            //the new one takes the place
+            pending->reset();
+            return;
+        }
+        if ((pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && !pkt_ptr->is_key_frame_) {
+            return;
+        }
+        Media_Packet_Ptr seq_hdr_ptr = *pending;
+        pending->reset();
+        PushEvictOldest(seq_hdr_ptr);
+    }
+
+private:
+    SpscQueue<Media_Packet_Ptr> queue_;
+    std::atomic<QUEUE_OVERFLOW_POLICY> policy_;
+    std::atomic<bool> closed_{false};
+    std::atomic<int64_t> drop_count_{0};
+
+private://used by the producer only
+    bool has_video_     = false;
+    bool wait_keyframe_ = false;
+    int64_t last_report_ms_ = -1;//used by the consumer
+    Media_Packet_Ptr video_seq_hdr_;//the evicted seq headers
+    Media_Packet_Ptr audio_seq_hdr_;
+};
+
+}
+#endif
@@ -0,0 +1,280 @@
+#ifndef PACING_SCHEDULER_HPP
+#define PACING_SCHEDULER_HPP
+#include "media_packet.hpp"
+#include "loop_scheduler.hpp"
+#include "timeex.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <queue>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+namespace cpp_streamer
+{
+
+//the sink is full when it has PACING_SINK_PENDING_MAX packets waiting in the scheduler,
+//and it's drained when they go down to PACING_SINK_PENDING_LOW.
+#define PACING_SINK_PENDING_MAX 1024
+#define PACING_SINK_PENDING_LOW 256
+
+class PacingScheduler;
+
+//the receiver of the paced packets, it's called in the loop thread.
+class PacingSinkI
+{
+friend class PacingScheduler;
+
+public:
+    PacingSinkI() = default;
+    virtual ~PacingSinkI() = default;
+
+public:
+    virtual void OnPacingOutput(Media_Packet_Ptr pkt_ptr) = 0;
+    //the producer which stops at the full Push can go on
+    virtual void OnPacingDrain() {}
+    //all the packets of the sink are output
+    virtual void OnPacingEmpty() {}
+
+public:
+    //packets waiting in the scheduler
+    size_t PacingPending() { return pacing_pending_.load(); }
+
+private:
+    std::atomic<size_t> pacing_pending_{0};
+    bool pacing_full_ = false;//guarded by the scheduler mutex
+};
+
+inline void OnPacingTimer(uv_timer_t* handle);
+inline void OnPacingTimerClose(uv_handle_t* handle);
+
+//one scheduler per uv loop: the packets of all the paced sources are kept in
+//a min-heap by their send time, and released by one uv timer.
+class PacingScheduler
+{
+friend void OnPacingTimer(uv_timer_t* handle);
+friend void OnPacingTimerClose(uv_handle_t* handle);
+
+public:
+    //call it in the loop thread at the first time, uv_timer_init is not thread safe.
+    static PacingScheduler* GetScheduler(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetSchedulersMutex());
+        std::map<uv_loop_t*, PacingScheduler*>& schedulers = GetSchedulers();
+
+        auto iter = schedulers.find(loop);
+        if (iter != schedulers.end()) {
+            return iter->second;
+        }
+        PacingScheduler* scheduler = new PacingScheduler(loop);
+        schedulers[loop] = scheduler;
+        return scheduler;
+    }
+
+    //call it in the loop thread or after the loop thread exits, before uv_loop_close.
+    //the scheduler is freed in the close callback, the sinks of the loop must be removed.
+    static void Release(uv_loop_t* loop) {
+        PacingScheduler* scheduler = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(GetSchedulersMutex());
+            std::map<uv_loop_t*, PacingScheduler*>& schedulers = GetSchedulers();
+
+            auto iter = schedulers.find(loop);
+            if (iter == schedulers.end()) {
+                return;
+            }
+            scheduler = iter->second;
+            schedulers.erase(iter);
+        }
+        uv_timer_stop(&scheduler->timer_);
+        uv_close((uv_handle_t*)&scheduler->timer_, OnPacingTimerClose);
+    }
+
+public:
+    //thread safe and never blocks, the packet is output to the sink at send_ms(system time in ms).
+    //the packet is always queued, and it returns false when the sink turns full: the producer
+    //should stop pushing until OnPacingDrain() of the sink, which is called in the loop thread.
+    bool Push(PacingSinkI* sink, Media_Packet_Ptr pkt_ptr, int64_t send_ms) {
+        bool rearm = false;
+        bool full  = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            PacingItem item;
+
+            item.send_ms = send_ms;
+            item.seq     = seq_++;
+            item.sink    = sink;
+            item.pkt_ptr = pkt_ptr;
+            heap_.push(item);
+            sink->pacing_pending_++;
+            if (!sink->pacing_full_ && (sink->pacing_pending_ >= PACING_SINK_PENDING_MAX)) {
+                sink->pacing_full_ = true;
+                full = true;
+            }
+
+            //only wake up the loop when the packet is earlier than the armed timer
+            if ((armed_ms_ < 0) || (send_ms < armed_ms_)) {
+                armed_ms_ = send_ms;
+                rearm = true;
+            }
+        }
+        if (rearm) {
+            PostToLoop(loop_, [this]() {
+                Arm();
+            });
+        }
+        return !full;
+    }
+
+    //drop the packets of the sink, no packet is output to it after returning.
+    void Remove(PacingSinkI* sink) {
+        std::lock_guard<std::recursive_mutex> run_lock(run_mutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<PacingItem> items;
+
+        while (!heap_.empty()) {
+            if (heap_.top().sink != sink) {
+                items.push_back(heap_.top());
+            }
+            heap_.pop();
+        }
+        for (PacingItem& item : items) {
+            heap_.push(item);
+        }
+        //removed in the output callback of another sink
+        for (PacingItem& item : ready_items_) {
+            if (item.sink == sink) {
+                item.sink = nullptr;
+            }
+        }
+        sink->pacing_pending_ = 0;
+        sink->pacing_full_    = false;
+    }
+
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return heap_.size();
+    }
+
+private:
+    PacingScheduler(uv_loop_t* loop):loop_(loop)
+    {
+        uv_timer_init(loop, &timer_);
+        timer_.data = this;
+    }
+    ~PacingScheduler() {
+    }
+
+    //run in the loop thread
+    void Arm() {
+        int64_t delay_ms = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (heap_.empty()) {
+                armed_ms_ = -1;
+                return;
+            }
+            armed_ms_ = heap_.top().send_ms;
+            delay_ms  = armed_ms_ - now_millisec();
+        }
+        uv_timer_start(&timer_, OnPacingTimer, (delay_ms > 0) ? (uint64_t)delay_ms : 0, 0);
+    }
+
+    void OnTimer() {
+        std::lock_guard<std::recursive_mutex> run_lock(run_mutex_);
+        int64_t now_ms = now_millisec();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!heap_.empty() && (heap_.top().send_ms <= now_ms)) {
+                ready_items_.push_back(heap_.top());
+                heap_.pop();
+
+                PacingItem& item = ready_items_.back();
+                size_t pending = --item.sink->pacing_pending_;
+                if (item.sink->pacing_full_ && (pending <= PACING_SINK_PENDING_LOW)) {
+                    item.sink->pacing_full_ = false;
+                    item.drain = true;
+                }
+                item.empty = (pending == 0);
+            }
+            //the following pushes earlier than the next one have to rearm the timer
+            armed_ms_ = -1;
+        }
+        for (size_t i = 0; i < ready_items_.size(); i++) {
+            PacingItem& item = ready_items_[i];
+            if (!item.sink) {
+                continue;
+            }
+            item.sink->OnPacingOutput(item.pkt_ptr);
+            //the sink may be removed in the callbacks
+            if (item.sink && item.drain) {
+                item.sink->OnPacingDrain();
+            }
+            if (item.sink && item.empty) {
+                item.sink->OnPacingEmpty();
+            }
+        }
+        ready_items_.clear();
+
+        Arm();
+    }
+
+private:
+    static std::mutex& GetSchedulersMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+    static std::map<uv_loop_t*, PacingScheduler*>& GetSchedulers() {
+        static std::map<uv_loop_t*, PacingScheduler*> s_schedulers;
+        return s_schedulers;
+    }
+
+private:
+    class PacingItem
+    {
+    public:
+        int64_t send_ms = 0;
+        int64_t seq     = 0;//first in first out for the same send time
+        PacingSinkI* sink = nullptr;
+        Media_Packet_Ptr pkt_ptr;
+        bool drain = false;
+        bool empty = false;
+    };
+
+    class PacingItemLater
+    {
+    public:
+        bool operator()(const PacingItem& a, const PacingItem& b) const {
+            if (a.send_ms != b.send_ms) {
+                return a.send_ms > b.send_ms;
+            }
+            return a.seq > b.seq;
+        }
+    };
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    uv_timer_t timer_;
+    std::mutex mutex_;
+    std::recursive_mutex run_mutex_;//held while outputting the packets
+    std::priority_queue<PacingItem, std::vector<PacingItem>, PacingItemLater> heap_;
+    std::vector<PacingItem> ready_items_;
+    int64_t seq_      = 0;
+    int64_t armed_ms_ = -1;
+};
+
+inline void OnPacingTimer(uv_timer_t* handle) {
+    PacingScheduler* scheduler = (PacingScheduler*)handle->data;
+    scheduler->OnTimer();
+}
+
+inline void OnPacingTimerClose(uv_handle_t* handle) {
+    PacingScheduler* scheduler = (PacingScheduler*)handle->data;
+    delete scheduler;
+}
+
+}
+#endif
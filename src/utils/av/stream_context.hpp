@@ -0,0 +1,83 @@
+#ifndef STREAM_CONTEXT_HPP
+#define STREAM_CONTEXT_HPP
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <map>
+
+namespace cpp_streamer
+{
+
+class StreamContext;
+typedef std::shared_ptr<const StreamContext> StreamContextPtr;
+
+//immutable stream identity shared by all the packets of one stream,
+//packets of the same stream point to the same interned object.
+class StreamContext
+{
+public:
+    StreamContext() {
+    }
+    StreamContext(const std::string& key, const std::string& vhost,
+                const std::string& app, const std::string& streamname,
+                uint32_t streamid):key_(key)
+                                , vhost_(vhost)
+                                , app_(app)
+                                , streamname_(streamname)
+                                , streamid_(streamid)
+    {
+    }
+    ~StreamContext() {
+    }
+
+public:
+    //return the shared object which has the same identity, create it if not exist.
+    static StreamContextPtr Intern(const std::string& key, const std::string& vhost,
+                                const std::string& app, const std::string& streamname,
+                                uint32_t streamid = 0) {
+        std::string intern_key = key + "/" + vhost + "/" + app + "/" + streamname + "/" + std::to_string(streamid);
+        std::lock_guard<std::mutex> lock(GetMutex());
+        std::map<std::string, std::weak_ptr<const StreamContext>>& contexts = GetContexts();
+
+        auto iter = contexts.find(intern_key);
+        if (iter != contexts.end()) {
+            StreamContextPtr ctx_ptr = iter->second.lock();
+            if (ctx_ptr) {
+                return ctx_ptr;
+            }
+        }
+
+        //remove the expired contexts
+        for (auto it = contexts.begin(); it != contexts.end();) {
+            if (it->second.expired()) {
+                it = contexts.erase(it);
+            } else {
+                it++;
+            }
+        }
+        StreamContextPtr ctx_ptr = std::make_shared<const StreamContext>(key, vhost, app, streamname, streamid);
+        contexts[intern_key] = ctx_ptr;
+        return ctx_ptr;
+    }
+
+private:
+    static std::mutex& GetMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+    static std::map<std::string, std::weak_ptr<const StreamContext>>& GetContexts() {
+        static std::map<std::string, std::weak_ptr<const StreamContext>> s_contexts;
+        return s_contexts;
+    }
+
+public:
+    const std::string key_;//vhost(option)_appname_streamname
+    const std::string vhost_;
+    const std::string app_;
+    const std::string streamname_;
+    const uint32_t streamid_ = 0;
+};
+
+}
+#endif
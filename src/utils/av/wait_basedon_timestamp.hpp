@@ -6,12 +6,14 @@
 #include <stddef.h>
 #include <string>
 #include <thread>
+#include <chrono>
 #include <iostream>
 
 namespace cpp_streamer
 {
 
 #define PACKET_DIFF_MAX_MS (5 * 1000)
+#define PACKET_SEND_DELAY_MS 30
 
 class WaitBasedOnTimestamp
 {
@@ -24,15 +26,16 @@ public:
     }
 
 public:
-    void Wait(Media_Packet_Ptr pkt_ptr) {
-        int64_t now_ms = now_millisec();
+    //return the system time(ms) when the packet should be output.
+    int64_t GetSendMs(Media_Packet_Ptr pkt_ptr, int64_t now_ms) {
         int64_t pkt_ts = pkt_ptr->dts_;
 
         if (first_pkt_ts_ <= 0) {
             first_pkt_ts_ = pkt_ts;
             last_pkt_ts_  = pkt_ts;
             first_sys_ts_ = now_ms;
-            return;
+            last_send_ms_ = now_ms;
+            return now_ms;
         }
 
         int64_t diff_t = (pkt_ts > last_pkt_ts_) ? (pkt_ts - last_pkt_ts_) : (last_pkt_ts_ - pkt_ts);
@@ -42,15 +45,26 @@ public:
             first_pkt_ts_ = pkt_ts;
             last_pkt_ts_  = pkt_ts;
             first_sys_ts_ = now_ms;
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
-            return;
+            last_send_ms_ = now_ms;
+            return now_ms;
+        }
+
+        int64_t send_ms = first_sys_ts_ + (pkt_ts - first_pkt_ts_) + PACKET_SEND_DELAY_MS;
+        //keep the input order when the timestamp goes back
+        if (send_ms < last_send_ms_) {
+            send_ms = last_send_ms_;
         }
+        last_send_ms_ = send_ms;
+        return send_ms;
+    }
+
+    //block the current thread until the packet should be output.
+    void Wait(Media_Packet_Ptr pkt_ptr) {
+        int64_t now_ms  = now_millisec();
+        int64_t send_ms = GetSendMs(pkt_ptr, now_ms);
 
-        diff_t = (now_ms - first_sys_ts_) - (pkt_ts - first_pkt_ts_);
-        while(diff_t < 30) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            now_ms = now_millisec();
-            diff_t = (now_ms - first_sys_ts_) - (pkt_ts - first_pkt_ts_);
+        if (send_ms > now_ms) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(send_ms - now_ms));
         }
         return;
     }
@@ -59,12 +73,14 @@ public:
         first_pkt_ts_ = -1;
         first_sys_ts_ = -1;
         last_pkt_ts_ = -1;
+        last_send_ms_ = -1;
     }
 
 private:
     int64_t first_pkt_ts_ = -1;
     int64_t first_sys_ts_ = -1;
     int64_t last_pkt_ts_ = -1;
+    int64_t last_send_ms_ = -1;
 };
 
 }
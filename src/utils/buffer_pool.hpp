@@ -0,0 +1,143 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace cpp_streamer
+{
+
+#define BUFFER_POOL_CLASS_COUNT 5
+
+//size classes: 256B, 2KB, 12KB, 16KB, 256KB
+//the 12KB class takes the default DataBuffer(10KB + the reserved header).
+//blocks larger than the biggest class are allocated directly.
+static const size_t BUFFER_POOL_CLASS_SIZE[BUFFER_POOL_CLASS_COUNT] = {256, 2*1024, 12*1024, 16*1024, 256*1024};
+//max free blocks cached per thread in each class
+static const size_t BUFFER_POOL_CLASS_CACHE[BUFFER_POOL_CLASS_COUNT] = {2048, 1024, 256, 256, 16};
+
+typedef struct BUFFER_POOL_STATICS_S
+{
+    int64_t hit_count;
+    int64_t miss_count;
+    int64_t bytes_outstanding;
+} BUFFER_POOL_STATICS;
+
+//free lists of one thread(one uv loop runs in one thread).
+//a block freed in another thread goes to the free list of that thread.
+class BufferFreeList
+{
+public:
+    BufferFreeList() {
+    }
+    ~BufferFreeList() {
+        for (size_t i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+            for (char* p : free_list_[i]) {
+                delete[] p;
+            }
+            free_list_[i].clear();
+        }
+    }
+
+public:
+    std::vector<char*> free_list_[BUFFER_POOL_CLASS_COUNT];
+};
+
+class BufferPool
+{
+public:
+    //return the buffer whose size is real_size(>= size), the data is not zero filled.
+    static char* Malloc(size_t size, size_t& real_size) {
+        int index = GetClassIndex(size);
+        char* p = nullptr;
+
+        if (index < 0) {
+            real_size = size;
+            MissCount()++;
+            BytesOutstanding() += (int64_t)real_size;
+            return new char[real_size];
+        }
+        real_size = BUFFER_POOL_CLASS_SIZE[index];
+
+        std::vector<char*>& free_list = GetFreeList().free_list_[index];
+        if (!free_list.empty()) {
+            p = free_list.back();
+            free_list.pop_back();
+            HitCount()++;
+        } else {
+            p = new char[real_size];
+            MissCount()++;
+        }
+        BytesOutstanding() += (int64_t)real_size;
+        return p;
+    }
+
+    //real_size must be the value returned by Malloc
+    static void Free(char* p, size_t real_size) {
+        if (p == nullptr) {
+            return;
+        }
+        BytesOutstanding() -= (int64_t)real_size;
+
+        int index = GetClassIndex(real_size);
+        if ((index < 0) || (BUFFER_POOL_CLASS_SIZE[index] != real_size)) {
+            delete[] p;
+            return;
+        }
+        std::vector<char*>& free_list = GetFreeList().free_list_[index];
+        if (free_list.size() >= BUFFER_POOL_CLASS_CACHE[index]) {
+            delete[] p;
+            return;
+        }
+        free_list.push_back(p);
+    }
+
+    //the real size of the block which is returned by Malloc(size)
+    static size_t GetRealSize(size_t size) {
+        int index = GetClassIndex(size);
+        if (index < 0) {
+            return size;
+        }
+        return BUFFER_POOL_CLASS_SIZE[index];
+    }
+
+    static void GetStatics(BUFFER_POOL_STATICS& statics) {
+        statics.hit_count         = HitCount().load();
+        statics.miss_count        = MissCount().load();
+        statics.bytes_outstanding = BytesOutstanding().load();
+    }
+
+private:
+    static int GetClassIndex(size_t size) {
+        for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+            if (size <= BUFFER_POOL_CLASS_SIZE[i]) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static BufferFreeList& GetFreeList() {
+        static thread_local BufferFreeList s_free_list;
+        return s_free_list;
+    }
+
+    static std::atomic<int64_t>& HitCount() {
+        static std::atomic<int64_t> s_hit_count(0);
+        return s_hit_count;
+    }
+
+    static std::atomic<int64_t>& MissCount() {
+        static std::atomic<int64_t> s_miss_count(0);
+        return s_miss_count;
+    }
+
+    static std::atomic<int64_t>& BytesOutstanding() {
+        static std::atomic<int64_t> s_bytes_outstanding(0);
+        return s_bytes_outstanding;
+    }
+};
+
+}
+#endif
@@ -4,12 +4,14 @@
 #include <openssl/ssl.h>
 #include <chrono>
 #include <random>
+#include <thread>
+#include <functional>
 #include <cstring>
 
 namespace cpp_streamer
 {
-uint8_t ByteCrypto::hmac_sha1_buffer[20];
-HMAC_CTX* ByteCrypto::hmac_sha1_ctx = nullptr;
+thread_local uint8_t ByteCrypto::hmac_sha1_buffer[20];
+thread_local HMAC_CTX* ByteCrypto::hmac_sha1_ctx = nullptr;
 const uint32_t ByteCrypto::crc32_table[] =
 {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
@@ -46,8 +48,8 @@ const uint32_t ByteCrypto::crc32_table[] =
     0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-std::default_random_engine ByteCrypto::random;
-bool ByteCrypto::init_ = false;
+thread_local std::default_random_engine ByteCrypto::random;
+thread_local bool ByteCrypto::init_ = false;
 
 void ByteCrypto::Init() {
     if (init_) {
@@ -63,7 +65,10 @@ void ByteCrypto::Init() {
 
     std::chrono::milliseconds mil = std::chrono::duration_cast<std::chrono::milliseconds>(d);
 
-    random = std::default_random_engine((uint32_t)(mil.count() & 0xffffffff));
+    //the threads initialized in the same millisecond get different seeds
+    uint32_t seed = (uint32_t)(mil.count() & 0xffffffff);
+    seed ^= (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+    random = std::default_random_engine(seed);
 }
 
 void ByteCrypto::DeInit() {
@@ -79,6 +84,7 @@ void ByteCrypto::DeInit() {
 }
 
 uint32_t ByteCrypto::GetRandomUint(uint32_t min, uint32_t max) {
+    Init();
     std::uniform_int_distribution<uint32_t> dest(min, max);
 
     return dest(random);
@@ -98,6 +104,7 @@ uint32_t ByteCrypto::GetCrc32(const uint8_t* data, size_t size) {
 uint8_t* ByteCrypto::GetHmacSha1(const std::string& key, const uint8_t* data, size_t len) {
     int ret = 0;
 
+    Init();
     ret = HMAC_Init_ex(ByteCrypto::hmac_sha1_ctx, key.c_str(), key.length(), EVP_sha1(), nullptr);
     if (ret != 1) {
         throw CppStreamException("OpenSSL HMAC_Init_ex() failed with key");
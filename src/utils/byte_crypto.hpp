@@ -21,14 +21,14 @@ public:
     static uint8_t* GetHmacSha1(const std::string& key, const uint8_t* data, size_t len);
     static std::string GetRandomString(size_t len);
 
-public:
-    static std::default_random_engine random;
-    static HMAC_CTX* hmac_sha1_ctx;
-    static uint8_t hmac_sha1_buffer[20];
+public://per thread, the streamers may run in different loop threads
+    static thread_local std::default_random_engine random;
+    static thread_local HMAC_CTX* hmac_sha1_ctx;
+    static thread_local uint8_t hmac_sha1_buffer[20];
     static const uint32_t crc32_table[256];
 
 private:
-    static bool init_;
+    static thread_local bool init_;
 };
 
 }
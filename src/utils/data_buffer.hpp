@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include "buffer_pool.hpp"
 
 #define EXTRA_LEN (10*1024)
 
@@ -18,12 +19,26 @@ class DataBuffer
 public:
     DataBuffer(size_t data_size = EXTRA_LEN)
     {
-        buffer_      = new char[data_size + PRE_RESERVE_HEADER_SIZE];
-        buffer_size_ = data_size;
+        //the pooled buffer is not zero filled
+        buffer_      = BufferPool::Malloc(data_size + PRE_RESERVE_HEADER_SIZE, alloc_size_);
+        start_       = PRE_RESERVE_HEADER_SIZE;
+        end_         = PRE_RESERVE_HEADER_SIZE;
+        data_len_    = 0;
+    }
+
+    //use the caller's inline storage when it's big enough, the storage must outlive the DataBuffer.
+    DataBuffer(size_t data_size, char* inline_data, size_t inline_size)
+    {
+        if (inline_data && (data_size + PRE_RESERVE_HEADER_SIZE <= inline_size)) {
+            buffer_      = inline_data;
+            alloc_size_  = inline_size;
+            is_inline_   = true;
+        } else {
+            buffer_      = BufferPool::Malloc(data_size + PRE_RESERVE_HEADER_SIZE, alloc_size_);
+        }
         start_       = PRE_RESERVE_HEADER_SIZE;
         end_         = PRE_RESERVE_HEADER_SIZE;
         data_len_    = 0;
-        memset(buffer_, 0, data_size);
     }
 
     DataBuffer(const DataBuffer& input)//deep copy
@@ -32,33 +47,38 @@ public:
         dst_ip_        = input.dst_ip_;
         dst_port_      = input.dst_port_;
 
-        buffer_        = new char[input.buffer_size_ + PRE_RESERVE_HEADER_SIZE];
-        buffer_size_   = input.buffer_size_;
+        buffer_        = BufferPool::Malloc(input.alloc_size_, alloc_size_);
         data_len_      = input.data_len_;
         start_         = input.start_;
         end_           = input.end_;
 
-        memcpy(buffer_, input.buffer_, data_len_);
+        memcpy(buffer_ + start_, input.buffer_ + input.start_, data_len_);
     }
     DataBuffer& operator=(const DataBuffer& input)//deep copy
     {
+        if (this == &input) {
+            return *this;
+        }
         sent_flag_     = input.sent_flag_;
         dst_ip_        = input.dst_ip_;
         dst_port_      = input.dst_port_;
 
-        buffer_        = new char[input.buffer_size_ + PRE_RESERVE_HEADER_SIZE];
-        buffer_size_   = input.buffer_size_;
+        if (!is_inline_) {
+            BufferPool::Free(buffer_, alloc_size_);
+        }
+        is_inline_     = false;
+        buffer_        = BufferPool::Malloc(input.alloc_size_, alloc_size_);
         data_len_      = input.data_len_;
         start_         = input.start_;
         end_           = input.end_;
 
-        memcpy(buffer_, input.buffer_, data_len_);
+        memcpy(buffer_ + start_, input.buffer_ + input.start_, data_len_);
         return *this;
     }
     ~DataBuffer()
     {
-        if (buffer_) {
-            delete[] buffer_;
+        if (buffer_ && !is_inline_) {
+            BufferPool::Free(buffer_, alloc_size_);
         }
     }
 
@@ -67,30 +87,29 @@ public:
         if ((input_data == nullptr) || (input_len == 0)) {
             return 0;
         }
-        if ((size_t)end_ + input_len > (buffer_size_ - PRE_RESERVE_HEADER_SIZE)) {
-            if (data_len_ + input_len >= (buffer_size_ - PRE_RESERVE_HEADER_SIZE)) {
+        if ((size_t)end_ + input_len > alloc_size_) {
+            if (data_len_ + input_len > (alloc_size_ - PRE_RESERVE_HEADER_SIZE)) {
                 int new_len = data_len_ + (int)input_len + EXTRA_LEN;
 
+                size_t new_alloc_size = 0;
+
                 new_len = GetNewSize(new_len);
-                char* new_buffer = new char[new_len];
+                char* new_buffer = BufferPool::Malloc(new_len, new_alloc_size);
                 memcpy(new_buffer + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
                 memcpy(new_buffer + PRE_RESERVE_HEADER_SIZE + data_len_, input_data, input_len);
-                delete[] buffer_;
+                if (!is_inline_) {
+                    BufferPool::Free(buffer_, alloc_size_);
+                }
+                is_inline_   = false;
                 buffer_      = new_buffer;
-                buffer_size_ = new_len;
+                alloc_size_  = new_alloc_size;
                 data_len_    += input_len;
                 start_     = PRE_RESERVE_HEADER_SIZE;
                 end_       = start_ + data_len_;
                 return data_len_;
             }
-            if (data_len_ >= start_) {
-                char* temp_p = new char[data_len_];
-                memcpy(temp_p, buffer_ + start_, data_len_);
-                memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE, temp_p, data_len_);
-                delete[] temp_p;
-            } else {
-                memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
-            }
+            //the regions may overlap, no temporary buffer is needed for memmove
+            memmove(buffer_ + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
 
             memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE + data_len_, input_data, input_len);
 
@@ -151,7 +170,9 @@ private:
     static int GetNewSize(int new_len) {
         int ret = new_len;
     
-        if (new_len <= 50*1024) {
+        if (new_len <= 16*1024) {
+            ret = 16*1024;
+        } else if ((new_len > 16*1024) && (new_len <= 50*1024)) {
             ret = 50*1024;
         } else if ((new_len > 50*1024) && (new_len <= 100*1024)) {
             ret = 100*1024;
@@ -172,7 +193,8 @@ private:
 
 private:
     char* buffer_       = nullptr;
-    size_t buffer_size_ = 0;
+    size_t alloc_size_  = 0;
+    bool is_inline_     = false;
     int data_len_       = 0;
     int start_          = PRE_RESERVE_HEADER_SIZE;
     int end_            = 0;
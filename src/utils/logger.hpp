@@ -52,11 +52,13 @@ public:
     enum LOGGER_LEVEL GetLevel() {
         return level_;
     }
+    //the format buffer is per thread, the logger is shared by the streamers in different loops.
     char* GetBuffer() {
-        return buffer_;
+        static thread_local char s_buffer[LOGGER_BUFFER_SIZE];
+        return s_buffer;
     }
     size_t BufferSize() {
-        return sizeof(buffer_);
+        return LOGGER_BUFFER_SIZE;
     }
     void Logf(const char* level, const char* buffer) {
         std::stringstream ss;
@@ -82,7 +84,6 @@ public:
 private:
     std::string filename_;
     enum LOGGER_LEVEL level_;
-    char buffer_[LOGGER_BUFFER_SIZE];
     bool console_enable_ = false;
 };
 
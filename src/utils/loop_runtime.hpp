@@ -0,0 +1,172 @@
+#ifndef LOOP_RUNTIME_HPP
+#define LOOP_RUNTIME_HPP
+#include "loop_scheduler.hpp"
+#include "timer.hpp"
+#include "pacing_scheduler.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <functional>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpp_streamer
+{
+
+//one uv loop running in its own thread
+class LoopShard
+{
+public:
+    LoopShard(size_t index):index_(index)
+    {
+        uv_loop_init(&loop_);
+        //create the scheduler before the loop thread starts, PostToLoop is ready at once.
+        LoopScheduler::GetScheduler(&loop_);
+    }
+    //the streamers of the loop must be deleted before, their handles are closed here.
+    ~LoopShard() {
+        Stop();
+        LoopScheduler::Release(&loop_);
+        TimerWheel::Release(&loop_);
+        PacingScheduler::Release(&loop_);
+        //run the close callbacks
+        uv_run(&loop_, UV_RUN_NOWAIT);
+        uv_loop_close(&loop_);
+    }
+
+public:
+    void Start(bool pin_cpu) {
+        if (thread_ptr_) {
+            return;
+        }
+        thread_ptr_ = std::make_shared<std::thread>(&LoopShard::OnWork, this);
+        thread_id_  = thread_ptr_->get_id();
+        if (pin_cpu) {
+            PinCpu();
+        }
+    }
+
+    void Stop() {
+        if (!thread_ptr_) {
+            return;
+        }
+        uv_loop_t* loop = &loop_;
+        PostToLoop(loop, [loop]() {
+            uv_stop(loop);
+        });
+        thread_ptr_->join();
+        thread_ptr_ = nullptr;
+    }
+
+    uv_loop_t* GetLoop() { return &loop_; }
+    size_t GetIndex() { return index_; }
+    std::thread::id GetThreadId() { return thread_id_; }
+
+private:
+    void OnWork() {
+        //the async handle of the scheduler keeps the loop alive until uv_stop
+        uv_run(&loop_, UV_RUN_DEFAULT);
+    }
+
+    void PinCpu() {
+#if defined(__linux__)
+        unsigned int cpus = std::thread::hardware_concurrency();
+        if (cpus == 0) {
+            return;
+        }
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(index_ % cpus, &cpu_set);
+        pthread_setaffinity_np(thread_ptr_->native_handle(), sizeof(cpu_set), &cpu_set);
+#endif
+    }
+
+private:
+    size_t index_ = 0;
+    uv_loop_t loop_;
+    std::shared_ptr<std::thread> thread_ptr_;
+    std::thread::id thread_id_;
+};
+
+//N uv loops on N threads(pinned to the cpus on linux).
+//each streamer is assigned to one shard, and all its handles, timers and
+//callbacks live in the loop of that shard, so StartNetwork(url, loop) must
+//be called in the shard thread, eg: post it by PostToLoop().
+class LoopRuntime
+{
+public:
+    LoopRuntime(size_t shard_count, bool pin_cpu = true):pin_cpu_(pin_cpu)
+    {
+        if (shard_count == 0) {
+            shard_count = 1;
+        }
+        for (size_t i = 0; i < shard_count; i++) {
+            shards_.push_back(std::unique_ptr<LoopShard>(new LoopShard(i)));
+        }
+    }
+    //the loops are closed, delete the streamers after Stop() and before it.
+    ~LoopRuntime() {
+        Stop();
+    }
+
+public:
+    void Start() {
+        for (std::unique_ptr<LoopShard>& shard : shards_) {
+            shard->Start(pin_cpu_);
+        }
+    }
+
+    void Stop() {
+        for (std::unique_ptr<LoopShard>& shard : shards_) {
+            shard->Stop();
+        }
+    }
+
+    size_t ShardCount() {
+        return shards_.size();
+    }
+
+    uv_loop_t* GetLoop(size_t index) {
+        return shards_[index % shards_.size()]->GetLoop();
+    }
+
+    //round robin, thread safe
+    uv_loop_t* AssignLoop() {
+        return GetLoop(assign_index_++);
+    }
+
+    //the same key is always assigned to the same shard
+    uv_loop_t* AssignLoop(const std::string& key) {
+        return GetLoop(std::hash<std::string>()(key));
+    }
+
+    void PostToShard(size_t index, std::function<void()> func) {
+        PostToLoop(GetLoop(index), std::move(func));
+    }
+
+    //return true if it's called in the thread of the shard which runs the loop.
+    bool IsInLoopThread(uv_loop_t* loop) {
+        for (std::unique_ptr<LoopShard>& shard : shards_) {
+            if (shard->GetLoop() == loop) {
+                return shard->GetThreadId() == std::this_thread::get_id();
+            }
+        }
+        return false;
+    }
+
+private:
+    bool pin_cpu_ = true;
+    std::vector<std::unique_ptr<LoopShard>> shards_;
+    std::atomic<size_t> assign_index_{0};
+};
+
+}
+#endif
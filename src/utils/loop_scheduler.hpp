@@ -0,0 +1,239 @@
+#ifndef LOOP_SCHEDULER_HPP
+#define LOOP_SCHEDULER_HPP
+#include "timeex.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <map>
+#include <algorithm>
+
+namespace cpp_streamer
+{
+
+//max packets handled by one task in its turn
+#define LOOP_SCHEDULE_PACKET_BUDGET  64
+//max time of one loop iteration, the rest tasks run in the next iteration
+#define LOOP_SCHEDULE_TIME_BUDGET_US (5*1000)
+
+class LoopScheduler;
+
+//the task which hands data from other threads to the uv loop
+class LoopScheduleTaskI
+{
+friend class LoopScheduler;
+
+public:
+    LoopScheduleTaskI() = default;
+    virtual ~LoopScheduleTaskI() = default;
+
+public:
+    //run in the loop thread, handle at most budget items and return the handled count.
+    virtual size_t OnScheduleRun(size_t budget) = 0;
+    virtual bool HasScheduleData() = 0;
+
+private:
+    std::atomic<bool> schedule_pending_{false};
+};
+
+inline void OnLoopSchedulerAsync(uv_async_t* handle);
+inline void OnLoopSchedulerClose(uv_handle_t* handle);
+
+//one scheduler per uv loop: the producers only wake up the loop when the task
+//turns from idle to pending, and the loop runs the pending tasks round robin
+//with per task packet budget and per iteration time budget.
+class LoopScheduler
+{
+friend void OnLoopSchedulerAsync(uv_async_t* handle);
+friend void OnLoopSchedulerClose(uv_handle_t* handle);
+
+public:
+    //call it in the loop thread at the first time, uv_async_init is not thread safe.
+    static LoopScheduler* GetScheduler(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetSchedulersMutex());
+        std::map<uv_loop_t*, LoopScheduler*>& schedulers = GetSchedulers();
+
+        auto iter = schedulers.find(loop);
+        if (iter != schedulers.end()) {
+            return iter->second;
+        }
+        LoopScheduler* scheduler = new LoopScheduler(loop);
+        schedulers[loop] = scheduler;
+        return scheduler;
+    }
+
+    //call it in the loop thread or after the loop thread exits, before uv_loop_close.
+    //the scheduler is freed in the close callback, the tasks of the loop must be removed.
+    static void Release(uv_loop_t* loop) {
+        LoopScheduler* scheduler = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(GetSchedulersMutex());
+            std::map<uv_loop_t*, LoopScheduler*>& schedulers = GetSchedulers();
+
+            auto iter = schedulers.find(loop);
+            if (iter == schedulers.end()) {
+                return;
+            }
+            scheduler = iter->second;
+            schedulers.erase(iter);
+        }
+        uv_close((uv_handle_t*)&scheduler->async_, OnLoopSchedulerClose);
+    }
+
+public:
+    //thread safe, only the first notify of an idle task wakes up the loop.
+    void Notify(LoopScheduleTaskI* task) {
+        if (task->schedule_pending_.exchange(true)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            run_list_.push_back(task);
+        }
+        uv_async_send(&async_);
+    }
+
+    //thread safe, the function runs in the loop thread in the next iteration.
+    void Post(std::function<void()> func) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            post_list_.push_back(std::move(func));
+        }
+        uv_async_send(&async_);
+    }
+
+    //thread safe, the task is not touched by the scheduler after it returns.
+    //if the task is running in the loop thread, it waits for the end of the run,
+    //or it's only marked when the task removes itself in OnScheduleRun.
+    void Remove(LoopScheduleTaskI* task) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        run_list_.erase(std::remove(run_list_.begin(), run_list_.end(), task), run_list_.end());
+        task->schedule_pending_ = false;
+
+        if (running_task_ != task) {
+            return;
+        }
+        running_removed_ = true;
+        if (run_thread_id_ == std::this_thread::get_id()) {
+            return;
+        }
+        run_cond_.wait(lock, [this, task]() { return running_task_ != task; });
+    }
+
+private:
+    LoopScheduler(uv_loop_t* loop) {
+        uv_async_init(loop, &async_, OnLoopSchedulerAsync);
+        async_.data = this;
+    }
+    ~LoopScheduler() {
+    }
+
+    void OnRun() {
+        int64_t start_us = now_microsec();
+
+        RunPosts();
+
+        while (true) {
+            LoopScheduleTaskI* task = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (run_list_.empty()) {
+                    break;
+                }
+                task = run_list_.front();
+                run_list_.pop_front();
+                running_task_    = task;
+                running_removed_ = false;
+                run_thread_id_   = std::this_thread::get_id();
+            }
+
+            task->OnScheduleRun(LOOP_SCHEDULE_PACKET_BUDGET);
+
+            {
+                //Remove() of other threads waits until the task is done here
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_removed_) {
+                    bool again = task->HasScheduleData();
+                    if (!again) {
+                        //recheck after clearing the flag, the producer may push between them
+                        task->schedule_pending_ = false;
+                        again = task->HasScheduleData() && !task->schedule_pending_.exchange(true);
+                    }
+                    if (again) {
+                        run_list_.push_back(task);
+                    }
+                }
+                running_task_    = nullptr;
+                running_removed_ = false;
+            }
+            run_cond_.notify_all();
+
+            if (now_microsec() - start_us > LOOP_SCHEDULE_TIME_BUDGET_US) {
+                uv_async_send(&async_);
+                break;
+            }
+        }
+    }
+
+    void RunPosts() {
+        std::vector<std::function<void()>> posts;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (post_list_.empty()) {
+                return;
+            }
+            posts.swap(post_list_);
+        }
+        for (std::function<void()>& func : posts) {
+            func();
+        }
+    }
+
+private:
+    static std::mutex& GetSchedulersMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+    static std::map<uv_loop_t*, LoopScheduler*>& GetSchedulers() {
+        static std::map<uv_loop_t*, LoopScheduler*> s_schedulers;
+        return s_schedulers;
+    }
+
+private:
+    uv_async_t async_;
+    std::mutex mutex_;
+    std::deque<LoopScheduleTaskI*> run_list_;
+    std::vector<std::function<void()>> post_list_;
+
+private://the task in OnScheduleRun
+    std::condition_variable run_cond_;
+    LoopScheduleTaskI* running_task_ = nullptr;
+    bool running_removed_ = false;
+    std::thread::id run_thread_id_;
+};
+
+inline void OnLoopSchedulerAsync(uv_async_t* handle) {
+    LoopScheduler* scheduler = (LoopScheduler*)handle->data;
+    scheduler->OnRun();
+}
+
+inline void OnLoopSchedulerClose(uv_handle_t* handle) {
+    LoopScheduler* scheduler = (LoopScheduler*)handle->data;
+    delete scheduler;
+}
+
+//thread safe, run the function in the thread of the loop.
+//the scheduler of the loop must be created in the loop thread or before the loop runs.
+inline void PostToLoop(uv_loop_t* loop, std::function<void()> func) {
+    LoopScheduler::GetScheduler(loop)->Post(std::move(func));
+}
+
+}
+#endif
@@ -0,0 +1,104 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace cpp_streamer
+{
+
+//bounded lock free ring for one producer and one consumer.
+//each slot has its own sequence, so Pop() is safe to be called from the producer too,
+//which lets the producer evict the oldest item when the ring is full.
+template <typename T>
+class SpscQueue
+{
+public:
+    SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size = size << 1;
+        }
+        mask_  = size - 1;
+        slots_.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~SpscQueue() {
+    }
+
+public:
+    //called by the producer only, return false when it's full.
+    bool Push(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[pos & mask_];
+
+        if (slot.seq.load(std::memory_order_acquire) != pos) {
+            return false;
+        }
+        slot.value = value;
+        slot.seq.store(pos + 1, std::memory_order_release);
+        tail_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    //return false when it's empty.
+    bool Pop(T& value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        while (true) {
+            slot = &slots_[pos & mask_];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(slot->value);
+        slot->value = T();
+        slot->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t Size() {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t head = head_.load(std::memory_order_acquire);
+        return (tail > head) ? (tail - head) : 0;
+    }
+
+    size_t Capacity() {
+        return mask_ + 1;
+    }
+
+private:
+    class Slot
+    {
+    public:
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+private:
+    size_t mask_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+
+private://keep head and tail in different cache lines
+    char pad0_[64];
+    std::atomic<size_t> head_{0};
+    char pad1_[64];
+    std::atomic<size_t> tail_{0};
+};
+
+}
+#endif
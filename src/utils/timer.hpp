@@ -2,18 +2,203 @@
 #define TIMER_HPP
 #include <uv.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <mutex>
+
+//the tick of the timer wheel, the timers shorter than it have their own uv timer
+#define TIMER_WHEEL_TICK_MS 5
+//the slots of the wheel(power of 2), the longer timers wait for more rounds
+#define TIMER_WHEEL_SLOTS   512
+
+class TimerInterface;
+class TimerWheel;
 
 inline void OnUvTimerCallback(uv_timer_t *handle);
+inline void OnTimerWheelCallback(uv_timer_t *handle);
+inline void OnTimerWheelClose(uv_handle_t *handle);
+
+//the intrusive list node of the timer in the wheel slot,
+//the slot head is a sentinel which points to itself when it's empty.
+class TimerWheelNode
+{
+public:
+    void InitHead() {
+        prev = this;
+        next = this;
+    }
+    bool IsEmpty() { return next == this; }
+    bool IsLinked() { return prev != nullptr; }
+
+    void PushBack(TimerWheelNode* node) {
+        node->prev = prev;
+        node->next = this;
+        prev->next = node;
+        prev = node;
+    }
+
+    void Unlink() {
+        if (!prev) {
+            return;
+        }
+        prev->next = next;
+        next->prev = prev;
+        prev = nullptr;
+        next = nullptr;
+    }
+
+public:
+    TimerWheelNode* prev  = nullptr;
+    TimerWheelNode* next  = nullptr;
+    TimerInterface* timer = nullptr;
+    uint32_t rounds       = 0;
+};
+
+//one hashed timer wheel per uv loop: the timers of all the sessions in the loop
+//share one uv timer which runs only when there are active timers, start and stop
+//are O(1), and the expired timers of a tick are run in one batch.
+class TimerWheel
+{
+friend void OnTimerWheelCallback(uv_timer_t *handle);
+friend void OnTimerWheelClose(uv_handle_t *handle);
+
+public:
+    //call it in the loop thread at the first time, uv_timer_init is not thread safe.
+    static TimerWheel* GetWheel(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetWheelsMutex());
+        std::map<uv_loop_t*, TimerWheel*>& wheels = GetWheels();
+
+        auto iter = wheels.find(loop);
+        if (iter != wheels.end()) {
+            return iter->second;
+        }
+        TimerWheel* wheel = new TimerWheel(loop);
+        wheels[loop] = wheel;
+        return wheel;
+    }
+
+    //call it in the loop thread or after the loop thread exits, before uv_loop_close.
+    //the wheel is freed in the close callback, the timers of the loop must be deleted.
+    static void Release(uv_loop_t* loop) {
+        TimerWheel* wheel = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(GetWheelsMutex());
+            std::map<uv_loop_t*, TimerWheel*>& wheels = GetWheels();
+
+            auto iter = wheels.find(loop);
+            if (iter == wheels.end()) {
+                return;
+            }
+            wheel = iter->second;
+            wheels.erase(iter);
+        }
+        wheel->running_ = false;
+        uv_timer_stop(&wheel->timer_);
+        uv_close((uv_handle_t*)&wheel->timer_, OnTimerWheelClose);
+    }
+
+public:
+    void Add(TimerWheelNode* node, uint32_t timeout_ms) {
+        if (node->IsLinked()) {
+            return;
+        }
+        if (!running_) {
+            running_ = true;
+            base_ms_ = uv_now(loop_) - current_tick_ * TIMER_WHEEL_TICK_MS;
+            uv_timer_start(&timer_, OnTimerWheelCallback, TIMER_WHEEL_TICK_MS, TIMER_WHEEL_TICK_MS);
+        }
+        active_count_++;
+        Schedule(node, timeout_ms);
+    }
+
+    void Remove(TimerWheelNode* node) {
+        if (!node->IsLinked()) {
+            return;
+        }
+        node->Unlink();
+        active_count_--;
+    }
+
+    size_t GetActiveCount() { return active_count_; }
+
+private:
+    TimerWheel(uv_loop_t* loop):loop_(loop) {
+        uv_timer_init(loop, &timer_);
+        timer_.data = this;
+        for (size_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            slots_[i].InitHead();
+        }
+    }
+    ~TimerWheel() {
+    }
+
+    //the timeout is counted from the target tick of the current run, not from the tick
+    //which is being caught up, so a timer runs once after a loop stall instead of
+    //once per missed interval.
+    void Schedule(TimerWheelNode* node, uint32_t timeout_ms) {
+        uint64_t ticks = (timeout_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+        if (ticks == 0) {
+            ticks = 1;
+        }
+        ticks += target_tick_ - current_tick_;
+        node->rounds = (uint32_t)((ticks - 1) / TIMER_WHEEL_SLOTS);
+        slots_[(current_tick_ + ticks) & (TIMER_WHEEL_SLOTS - 1)].PushBack(node);
+    }
+
+    void OnTick() {
+        uint64_t now_tick = (uv_now(loop_) - base_ms_) / TIMER_WHEEL_TICK_MS;
+
+        if (now_tick > current_tick_) {
+            target_tick_ = now_tick;
+        }
+        while (current_tick_ < target_tick_) {
+            current_tick_++;
+            RunSlot(current_tick_ & (TIMER_WHEEL_SLOTS - 1));
+        }
+        if ((active_count_ == 0) && running_) {
+            running_ = false;
+            uv_timer_stop(&timer_);
+        }
+    }
+
+    void RunSlot(size_t index);
+
+private:
+    static std::mutex& GetWheelsMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+    static std::map<uv_loop_t*, TimerWheel*>& GetWheels() {
+        static std::map<uv_loop_t*, TimerWheel*> s_wheels;
+        return s_wheels;
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    uv_timer_t timer_;
+    bool running_          = false;
+    uint64_t base_ms_      = 0;//the loop time of tick 0
+    uint64_t current_tick_ = 0;//the last tick which is run
+    uint64_t target_tick_  = 0;//the tick which the current run catches up to
+    size_t active_count_   = 0;
+    TimerWheelNode slots_[TIMER_WHEEL_SLOTS];
+};
 
 class TimerInterface
 {
 friend void OnUvTimerCallback(uv_timer_t *handle);
+friend class TimerWheel;
 
 public:
     TimerInterface(uv_loop_t* loop, uint32_t timeout_ms):timeout_ms_(timeout_ms)
     {
-        uv_timer_init(loop, &timer_);
-        timer_.data = this;
+        if (timeout_ms < TIMER_WHEEL_TICK_MS) {
+            uv_timer_init(loop, &timer_);
+            timer_.data = this;
+        } else {
+            wheel_ = TimerWheel::GetWheel(loop);
+            node_.timer = this;
+        }
     }
 
     virtual ~TimerInterface() {
@@ -29,6 +214,10 @@ public:
             return;
         }
         running_ = true;
+        if (wheel_) {
+            wheel_->Add(&node_, timeout_ms_);
+            return;
+        }
         uv_timer_start(&timer_, OnUvTimerCallback, timeout_ms_, timeout_ms_);
     }
 
@@ -37,15 +226,63 @@ public:
             return;
         }
         running_ = false;
+        if (wheel_) {
+            wheel_->Remove(&node_);
+            return;
+        }
         uv_timer_stop(&timer_);
     }
 
 private:
     uv_timer_t timer_;
+    TimerWheel* wheel_ = nullptr;
+    TimerWheelNode node_;
     uint32_t timeout_ms_;
     bool running_ = false;
 };
 
+//the slot is moved to a local list before running, the timers which are
+//started again in the callbacks go to the next rounds. a timer may be
+//stopped or deleted in the callback of another one.
+inline void TimerWheel::RunSlot(size_t index) {
+    TimerWheelNode& head = slots_[index];
+    TimerWheelNode expired;
+
+    if (head.IsEmpty()) {
+        return;
+    }
+    expired.InitHead();
+    expired.next = head.next;
+    expired.prev = head.prev;
+    expired.next->prev = &expired;
+    expired.prev->next = &expired;
+    head.InitHead();
+
+    while (!expired.IsEmpty()) {
+        TimerWheelNode* node = expired.next;
+
+        node->Unlink();
+        if (node->rounds > 0) {
+            node->rounds--;
+            head.PushBack(node);
+            continue;
+        }
+        //repeat in the interval
+        Schedule(node, node->timer->timeout_ms_);
+        node->timer->OnTimer();
+    }
+}
+
+inline void OnTimerWheelCallback(uv_timer_t *handle) {
+    TimerWheel* wheel = (TimerWheel*)handle->data;
+    wheel->OnTick();
+}
+
+inline void OnTimerWheelClose(uv_handle_t *handle) {
+    TimerWheel* wheel = (TimerWheel*)handle->data;
+    delete wheel;
+}
+
 inline void OnUvTimerCallback(uv_timer_t *handle) {
     TimerInterface* timer = (TimerInterface*)handle->data;
     if (timer && timer->running_) {